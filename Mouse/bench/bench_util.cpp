@@ -0,0 +1,234 @@
+#include "bench_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "imgui.h"
+#include "scene.h"
+
+static std::vector<ImDrawVert> stagingVtx;
+static std::vector<ImDrawIdx> stagingIdx;
+static uint32_t rngState = 1;
+
+void BenchInitImGui(float width, float height)
+{
+	IMGUI_CHECKVERSION();
+	ImGui::CreateContext();
+	ImGuiIO& io = ImGui::GetIO();
+	io.IniFilename = nullptr;
+	io.DisplaySize = ImVec2(width, height);
+	io.DeltaTime = 1.0f / 60.0f;
+	// Large scenes overflow 16-bit indices; the GL backend handles VtxOffset too.
+	io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+
+	unsigned char* pixels;
+	int w, h;
+	io.Fonts->GetTexDataAsRGBA32(&pixels, &w, &h);
+}
+
+void BenchShutdownImGui()
+{
+	ImGui::DestroyContext();
+	stagingVtx.clear();
+	stagingVtx.shrink_to_fit();
+	stagingIdx.clear();
+	stagingIdx.shrink_to_fit();
+}
+
+SubmitStats BenchNullSubmit(ImDrawData* drawData)
+{
+	SubmitStats stats = {};
+	for (ImDrawList* list : drawData->CmdLists)
+	{
+		size_t vtxBytes = (size_t)list->VtxBuffer.Size * sizeof(ImDrawVert);
+		size_t idxBytes = (size_t)list->IdxBuffer.Size * sizeof(ImDrawIdx);
+		if (stagingVtx.size() < (size_t)list->VtxBuffer.Size)
+		{
+			stagingVtx.resize(list->VtxBuffer.Size);
+		}
+		if (stagingIdx.size() < (size_t)list->IdxBuffer.Size)
+		{
+			stagingIdx.resize(list->IdxBuffer.Size);
+		}
+		memcpy(stagingVtx.data(), list->VtxBuffer.Data, vtxBytes);
+		memcpy(stagingIdx.data(), list->IdxBuffer.Data, idxBytes);
+		for (const ImDrawCmd& cmd : list->CmdBuffer)
+		{
+			if (cmd.UserCallback == nullptr && cmd.ElemCount > 0)
+			{
+				++stats.drawCalls;
+			}
+		}
+		stats.vertices += list->VtxBuffer.Size;
+		stats.indices += list->IdxBuffer.Size;
+	}
+	return stats;
+}
+
+double BenchNowMs()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void BenchSeedRandom(uint32_t seed)
+{
+	rngState = seed ? seed : 1;
+}
+
+uint32_t BenchRandom()
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+float BenchRandomFloat(float lo, float hi)
+{
+	return lo + (hi - lo) * float(BenchRandom() & 0xFFFFFF) / float(0xFFFFFF);
+}
+
+void BenchBuildScene(std::vector<Rect>& out, int count)
+{
+	out.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		Rect& R = out[i];
+		R.x = BenchRandomFloat(0.0f, 1900.0f);
+		R.y = BenchRandomFloat(0.0f, 1060.0f);
+		R.w = BenchRandomFloat(1.0f, 20.0f);
+		R.h = BenchRandomFloat(1.0f, 20.0f);
+		R.color = ImVec4(BenchRandomFloat(0.0f, 1.0f), BenchRandomFloat(0.0f, 1.0f), BenchRandomFloat(0.0f, 1.0f), 1.0f);
+		R.sprite = (BenchRandom() & 7) == 0 ? (int)(BenchRandom() % 64) : -1;
+	}
+}
+
+bool BenchSameObjects(const std::vector<Rect>& a, const std::vector<Rect>& b)
+{
+	if (a.size() != b.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		const Rect& A = a[i];
+		const Rect& B = b[i];
+		if (A.x != B.x || A.y != B.y || A.w != B.w || A.h != B.h || A.sprite != B.sprite || memcmp(&A.color, &B.color, sizeof(ImVec4)) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+StageSummary BenchSummarize(std::vector<double> samples)
+{
+	StageSummary s = {};
+	if (samples.empty())
+	{
+		return s;
+	}
+	std::sort(samples.begin(), samples.end());
+	double sum = 0.0;
+	for (double v : samples)
+	{
+		sum += v;
+	}
+	size_t n = samples.size();
+	s.meanMs = sum / n;
+	s.p50Ms = samples[n / 2];
+	s.p95Ms = samples[std::min(n - 1, (n * 95) / 100)];
+	s.minMs = samples.front();
+	s.maxMs = samples.back();
+	return s;
+}
+
+static void CpuBrand(char* out, size_t size)
+{
+	snprintf(out, size, "unknown");
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	unsigned int regs[12] = {};
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0x80000000);
+	if ((unsigned int)info[0] < 0x80000004)
+	{
+		return;
+	}
+	for (int i = 0; i < 3; ++i)
+	{
+		__cpuid(info, 0x80000002 + i);
+		memcpy(&regs[i * 4], info, sizeof(info));
+	}
+#else
+	if (__get_cpuid_max(0x80000000, nullptr) < 0x80000004)
+	{
+		return;
+	}
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		__get_cpuid(0x80000002 + i, &regs[i * 4], &regs[i * 4 + 1], &regs[i * 4 + 2], &regs[i * 4 + 3]);
+	}
+#endif
+	char brand[49] = {};
+	memcpy(brand, regs, 48);
+	const char* start = brand;
+	while (*start == ' ')
+	{
+		++start;
+	}
+	snprintf(out, size, "%s", start);
+#endif
+}
+
+void BenchWriteHardwareJson(FILE* f, const char* indent)
+{
+	char cpu[64];
+	CpuBrand(cpu, sizeof(cpu));
+#if defined(_WIN32)
+	const char* os = "windows";
+#elif defined(__linux__)
+	const char* os = "linux";
+#elif defined(__APPLE__)
+	const char* os = "macos";
+#else
+	const char* os = "unknown";
+#endif
+	char compiler[64];
+#if defined(_MSC_VER)
+	snprintf(compiler, sizeof(compiler), "msvc %d", _MSC_VER);
+#elif defined(__clang__)
+	snprintf(compiler, sizeof(compiler), "clang %d.%d", __clang_major__, __clang_minor__);
+#elif defined(__GNUC__)
+	snprintf(compiler, sizeof(compiler), "gcc %d.%d", __GNUC__, __GNUC_MINOR__);
+#else
+	snprintf(compiler, sizeof(compiler), "unknown");
+#endif
+#if defined(NDEBUG)
+	const char* build = "release";
+#else
+	const char* build = "debug";
+#endif
+	fprintf(f, "%s\"hardware\": {\n", indent);
+	fprintf(f, "%s  \"cpu\": \"%s\",\n", indent, cpu);
+	fprintf(f, "%s  \"logical_cores\": %u,\n", indent, std::thread::hardware_concurrency());
+	fprintf(f, "%s  \"os\": \"%s\",\n", indent, os);
+	fprintf(f, "%s  \"compiler\": \"%s\",\n", indent, compiler);
+	fprintf(f, "%s  \"build\": \"%s\",\n", indent, build);
+	fprintf(f, "%s  \"pointer_bits\": %d\n", indent, (int)(sizeof(void*) * 8));
+	fprintf(f, "%s}", indent);
+}
+
+void BenchWriteStageJson(FILE* f, const char* name, const StageSummary& s, bool last)
+{
+	fprintf(f, "        \"%s\": { \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p95_ms\": %.4f, \"min_ms\": %.4f, \"max_ms\": %.4f }%s\n",
+		name, s.meanMs, s.p50Ms, s.p95Ms, s.minMs, s.maxMs, last ? "" : ",");
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+struct ImDrawData;
+struct Rect;
+
+// Shared pieces of the headless benchmark executables: an ImGui context with
+// no platform or renderer backend, a null renderer that performs the CPU side
+// of submission, a seeded random source, random scenes, and JSON helpers.
+
+void BenchInitImGui(float width, float height);
+void BenchShutdownImGui();
+
+struct SubmitStats {
+	int drawCalls;
+	int vertices;
+	int indices;
+};
+
+// Copies every vertex/index buffer into staging memory and walks the draw
+// commands, standing in for ImGui_ImplOpenGL3_RenderDrawData without a GPU.
+SubmitStats BenchNullSubmit(ImDrawData* drawData);
+
+double BenchNowMs();
+
+// xorshift32: deterministic across platforms and standard libraries. Seed 0
+// is replaced by 1.
+void BenchSeedRandom(uint32_t seed);
+uint32_t BenchRandom();
+float BenchRandomFloat(float lo, float hi);
+
+// Small objects scattered over a 1920x1080 view, one in eight a sprite.
+void BenchBuildScene(std::vector<Rect>& out, int count);
+// Field by field, colors bitwise.
+bool BenchSameObjects(const std::vector<Rect>& a, const std::vector<Rect>& b);
+
+struct StageSummary {
+	double meanMs;
+	double p50Ms;
+	double p95Ms;
+	double minMs;
+	double maxMs;
+};
+
+StageSummary BenchSummarize(std::vector<double> samples);
+
+void BenchWriteHardwareJson(FILE* f, const char* indent);
+void BenchWriteStageJson(FILE* f, const char* name, const StageSummary& s, bool last);
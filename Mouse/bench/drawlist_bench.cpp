@@ -0,0 +1,396 @@
+// ImDrawList primitive microbenchmarks. Each case fills a fresh draw list
+// with a batch of one primitive using the parameters the editor actually
+// draws with, and reports ns/primitive and vertices/s.
+//
+//   drawlist_bench [--count 10000] [--reps 15] [--out results.json]
+//                  [--baseline drawlist_baseline.json] [--threshold 10]
+//
+// With --baseline, every case is compared with the stored result and the
+// process exits with 2 if any case got slower by more than --threshold percent.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+#include "imgui.h"
+#include "bench_util.h"
+#include "draw_batch.h"
+
+static const int kInputCount = 4096;
+static const int kPolylinePoints = 16;
+static const int kMaxCases = 32;
+
+struct BenchInput {
+	ImVec2 min[kInputCount];
+	ImVec2 max[kInputCount];
+	ImU32 color[kInputCount];
+	ImVec2 polyline[kPolylinePoints];
+	char labels[kInputCount][16];
+};
+
+struct PrimCase {
+	const char* name;
+	ImDrawListFlags flags;
+	void (*run)(ImDrawList* dl, const BenchInput& in, int count);
+};
+
+struct CaseResult {
+	const char* name;
+	double nsPerPrim;       // best batch
+	double nsPerPrimMedian;
+	double vertsPerPrim;
+	double mvertsPerSec;
+};
+
+static void RunRectFilled(ImDrawList* dl, const BenchInput& in, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		int k = i & (kInputCount - 1);
+		dl->AddRectFilled(in.min[k], in.max[k], in.color[k]);
+	}
+}
+
+static void RunRectFilledRounded(ImDrawList* dl, const BenchInput& in, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		int k = i & (kInputCount - 1);
+		dl->AddRectFilled(in.min[k], in.max[k], in.color[k], 4.0f);
+	}
+}
+
+// The scene view's selection outline.
+static void RunRectOutline(ImDrawList* dl, const BenchInput& in, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		int k = i & (kInputCount - 1);
+		dl->AddRect(in.min[k], in.max[k], IM_COL32(255, 255, 0, 255), 0.0f, 0, 2.0f);
+	}
+}
+
+static void RunRectOutlineRounded(ImDrawList* dl, const BenchInput& in, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		int k = i & (kInputCount - 1);
+		dl->AddRect(in.min[k], in.max[k], in.color[k], 4.0f, 0, 1.0f);
+	}
+}
+
+static void RunText(ImDrawList* dl, const BenchInput& in, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		int k = i & (kInputCount - 1);
+		dl->AddText(in.min[k], in.color[k], in.labels[k]);
+	}
+}
+
+static void RunPolyline(ImDrawList* dl, const BenchInput& in, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		dl->AddPolyline(in.polyline, kPolylinePoints, in.color[i & (kInputCount - 1)], ImDrawFlags_None, 1.0f);
+	}
+}
+
+static void RunPolylineThick(ImDrawList* dl, const BenchInput& in, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		dl->AddPolyline(in.polyline, kPolylinePoints, in.color[i & (kInputCount - 1)], ImDrawFlags_Closed, 3.0f);
+	}
+}
+
+// Lower bound for a quad: reserve and write it without AddRectFilled's checks.
+static void RunPrimReserveRect(ImDrawList* dl, const BenchInput& in, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		int k = i & (kInputCount - 1);
+		dl->PrimReserve(6, 4);
+		dl->PrimRect(in.min[k], in.max[k], in.color[k]);
+	}
+}
+
+static void RunRectFilledBatch(ImDrawList* dl, const BenchInput& in, int count)
+{
+	for (int start = 0; start < count; start += kInputCount)
+	{
+		int n = count - start < kInputCount ? count - start : kInputCount;
+		AddRectFilledBatch(dl, in.min, in.max, in.color, n);
+	}
+}
+
+static const ImDrawListFlags kAA = ImDrawListFlags_AntiAliasedLines | ImDrawListFlags_AntiAliasedLinesUseTex | ImDrawListFlags_AntiAliasedFill;
+
+static const PrimCase kCases[] = {
+	{ "rect_filled", kAA, RunRectFilled },
+	{ "rect_filled_rounded4", kAA, RunRectFilledRounded },
+	{ "rect_outline_2px", kAA, RunRectOutline },
+	{ "rect_outline_rounded4_1px", kAA, RunRectOutlineRounded },
+	{ "text_label", kAA, RunText },
+	{ "polyline16_1px_aa", kAA, RunPolyline },
+	{ "polyline16_1px_aa_notex", ImDrawListFlags_AntiAliasedLines, RunPolyline },
+	{ "polyline16_1px_noaa", ImDrawListFlags_None, RunPolyline },
+	{ "polyline16_3px_closed_aa", kAA, RunPolylineThick },
+	{ "prim_reserve_rect", kAA, RunPrimReserveRect },
+	{ "rect_filled_batch", kAA, RunRectFilledBatch },
+};
+static const int kCaseCount = (int)(sizeof(kCases) / sizeof(kCases[0]));
+
+static void BuildInput(BenchInput& in)
+{
+	for (int i = 0; i < kInputCount; ++i)
+	{
+		float w = BenchRandomFloat(4.0f, 64.0f);
+		float h = BenchRandomFloat(4.0f, 64.0f);
+		in.min[i] = ImVec2(BenchRandomFloat(0.0f, 1800.0f), BenchRandomFloat(0.0f, 1000.0f));
+		in.max[i] = ImVec2(in.min[i].x + w, in.min[i].y + h);
+		in.color[i] = IM_COL32(BenchRandom() & 0xFF, BenchRandom() & 0xFF, BenchRandom() & 0xFF, 255);
+		snprintf(in.labels[i], sizeof(in.labels[i]), "Object %d", i);
+	}
+	for (int i = 0; i < kPolylinePoints; ++i)
+	{
+		in.polyline[i] = ImVec2(100.0f + i * 12.0f, 100.0f + BenchRandomFloat(-40.0f, 40.0f));
+	}
+}
+
+static CaseResult RunCase(const PrimCase& c, const BenchInput& in, int count, int reps)
+{
+	ImDrawList dl(ImGui::GetDrawListSharedData());
+	std::vector<double> samples;
+	samples.reserve(reps);
+	int vertices = 0;
+	// Two warmup batches grow the buffers so timed batches never reallocate.
+	for (int rep = -2; rep < reps; ++rep)
+	{
+		dl._ResetForNewFrame();
+		dl.Flags = c.flags | ImDrawListFlags_AllowVtxOffset;
+		dl.PushClipRectFullScreen();
+		dl.PushTexture(ImGui::GetIO().Fonts->TexRef);
+
+		double t0 = BenchNowMs();
+		c.run(&dl, in, count);
+		double t1 = BenchNowMs();
+
+		if (rep >= 0)
+		{
+			samples.push_back(t1 - t0);
+		}
+		vertices = dl.VtxBuffer.Size;
+	}
+	dl._ClearFreeMemory();
+
+	StageSummary s = BenchSummarize(samples);
+	CaseResult r;
+	r.name = c.name;
+	r.nsPerPrim = s.minMs * 1e6 / count;
+	r.nsPerPrimMedian = s.p50Ms * 1e6 / count;
+	r.vertsPerPrim = (double)vertices / count;
+	r.mvertsPerSec = s.minMs > 0.0 ? vertices / (s.minMs * 1e3) : 0.0;
+	return r;
+}
+
+static void WriteResults(FILE* f, const CaseResult* results, int count, int primitives, int reps)
+{
+	fprintf(f, "{\n");
+	fprintf(f, "  \"benchmark\": \"drawlist\",\n");
+	BenchWriteHardwareJson(f, "  ");
+	fprintf(f, ",\n");
+	fprintf(f, "  \"config\": { \"primitives_per_batch\": %d, \"reps\": %d },\n", primitives, reps);
+	fprintf(f, "  \"cases\": [\n");
+	for (int i = 0; i < count; ++i)
+	{
+		const CaseResult& r = results[i];
+		fprintf(f, "    { \"name\": \"%s\", \"ns_per_prim\": %.3f, \"ns_per_prim_median\": %.3f, \"vertices_per_prim\": %.2f, \"mvertices_per_sec\": %.1f }%s\n",
+			r.name, r.nsPerPrim, r.nsPerPrimMedian, r.vertsPerPrim, r.mvertsPerSec, i + 1 < count ? "," : "");
+	}
+	fprintf(f, "  ]\n");
+	fprintf(f, "}\n");
+}
+
+struct BaselineEntry {
+	char name[64];
+	double nsPerPrim;
+};
+
+// Reads the one-case-per-line layout written by WriteResults.
+static int LoadBaseline(const char* path, BaselineEntry* out, int maxEntries)
+{
+	FILE* f = fopen(path, "r");
+	if (!f)
+	{
+		return -1;
+	}
+	int count = 0;
+	char line[512];
+	while (fgets(line, sizeof(line), f) && count < maxEntries)
+	{
+		const char* name = strstr(line, "\"name\": \"");
+		const char* ns = strstr(line, "\"ns_per_prim\": ");
+		if (!name || !ns)
+		{
+			continue;
+		}
+		name += 9;
+		const char* end = strchr(name, '"');
+		if (!end || end - name >= (int)sizeof(out[count].name))
+		{
+			continue;
+		}
+		memcpy(out[count].name, name, end - name);
+		out[count].name[end - name] = '\0';
+		out[count].nsPerPrim = atof(ns + 15);
+		++count;
+	}
+	fclose(f);
+	return count;
+}
+
+static const BaselineEntry* FindBaseline(const BaselineEntry* baseline, int baselineCount, const char* name)
+{
+	for (int b = 0; b < baselineCount; ++b)
+	{
+		if (strcmp(baseline[b].name, name) == 0 && baseline[b].nsPerPrim > 0.0)
+		{
+			return &baseline[b];
+		}
+	}
+	return nullptr;
+}
+
+static double DeltaPercent(const CaseResult& r, const BaselineEntry& base)
+{
+	return 100.0 * (r.nsPerPrim - base.nsPerPrim) / base.nsPerPrim;
+}
+
+static int CompareWithBaseline(const CaseResult* results, int count, const BaselineEntry* baseline, int baselineCount, double threshold)
+{
+	int regressions = 0;
+	fprintf(stderr, "%-28s %10s %10s %8s\n", "case", "base ns", "ns", "delta");
+	for (int i = 0; i < count; ++i)
+	{
+		const CaseResult& r = results[i];
+		const BaselineEntry* base = FindBaseline(baseline, baselineCount, r.name);
+		if (!base)
+		{
+			fprintf(stderr, "%-28s %10s %10.2f %8s\n", r.name, "-", r.nsPerPrim, "new");
+			continue;
+		}
+		double delta = DeltaPercent(r, *base);
+		bool regressed = delta > threshold;
+		regressions += regressed;
+		fprintf(stderr, "%-28s %10.2f %10.2f %+7.1f%%%s\n", r.name, base->nsPerPrim, r.nsPerPrim, delta, regressed ? "  REGRESSION" : "");
+	}
+	return regressions;
+}
+
+int main(int argc, char** argv)
+{
+	int primitives = 10000;
+	int reps = 15;
+	double threshold = 10.0;
+	const char* outPath = nullptr;
+	const char* baselinePath = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+		{
+			primitives = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc)
+		{
+			reps = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+		{
+			outPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+		{
+			baselinePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+		{
+			threshold = atof(argv[++i]);
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--count N] [--reps N] [--out file.json] [--baseline file.json] [--threshold percent]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (primitives <= 0 || reps <= 0)
+	{
+		fprintf(stderr, "nothing to run\n");
+		return 1;
+	}
+
+	BaselineEntry baseline[kMaxCases];
+	int baselineCount = 0;
+	if (baselinePath)
+	{
+		baselineCount = LoadBaseline(baselinePath, baseline, kMaxCases);
+		if (baselineCount < 0)
+		{
+			fprintf(stderr, "failed to read baseline %s\n", baselinePath);
+			return 1;
+		}
+	}
+
+	static BenchInput input;
+	BuildInput(input);
+
+	// The shared draw list data (white pixel UVs, font, circle segments) is set up by NewFrame.
+	BenchInitImGui(1920.0f, 1080.0f);
+	ImGui::NewFrame();
+	CaseResult results[kCaseCount];
+	for (int i = 0; i < kCaseCount; ++i)
+	{
+		results[i] = RunCase(kCases[i], input, primitives, reps);
+		// Re-measure an apparent regression before reporting it; a busy machine only ever makes cases slower.
+		const BaselineEntry* base = FindBaseline(baseline, baselineCount, kCases[i].name);
+		for (int retry = 0; base && retry < 2 && DeltaPercent(results[i], *base) > threshold; ++retry)
+		{
+			CaseResult again = RunCase(kCases[i], input, primitives, reps);
+			if (again.nsPerPrim < results[i].nsPerPrim)
+			{
+				results[i] = again;
+			}
+		}
+	}
+	ImGui::EndFrame();
+	BenchShutdownImGui();
+
+	FILE* f = outPath ? fopen(outPath, "w") : (baselinePath ? nullptr : stdout);
+	if (outPath && !f)
+	{
+		fprintf(stderr, "failed to open %s\n", outPath);
+		return 1;
+	}
+	if (f)
+	{
+		WriteResults(f, results, kCaseCount, primitives, reps);
+		if (f != stdout)
+		{
+			fclose(f);
+		}
+	}
+
+	if (baselinePath)
+	{
+		int regressions = CompareWithBaseline(results, kCaseCount, baseline, baselineCount, threshold);
+		if (regressions > 0)
+		{
+			fprintf(stderr, "%d case(s) regressed by more than %.1f%%\n", regressions, threshold);
+			return 2;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,330 @@
+// Edit history benchmark. Runs a scripted editing session on random scenes
+// (a drag, scattered field edits, a duplicate, a delete and one last edit)
+// with the scene journal and the undo history both on, timing the journal
+// pump per frame. Then checks both for round trips:
+//   - the journal, replayed as after a crash, gives back the final scene;
+//   - with its tail torn off, or the last batch's checksum broken, it gives
+//     back the scene before the last edit;
+//   - a journal written for another scene is set aside, not replayed;
+//   - a Mark-all still reports the edits marked per object before it;
+//   - undoing every command walks back through each earlier scene, and
+//     redoing them ends at the final one.
+// Any difference makes the process exit with 2.
+//
+//   edit_bench [--objects 10000,100000,1000000] [--path bench.mjnl] [--out results.json]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "scene.h"
+#include "scene_changes.h"
+#include "scene_journal.h"
+#include "selection.h"
+#include "undo_history.h"
+#include "bench_util.h"
+
+static bool ReadBytes(const char* path, std::vector<uint8_t>& out)
+{
+	FILE* f = fopen(path, "rb");
+	if (!f)
+	{
+		return false;
+	}
+	fseek(f, 0, SEEK_END);
+	out.resize((size_t)ftell(f));
+	fseek(f, 0, SEEK_SET);
+	bool ok = fread(out.data(), 1, out.size(), f) == out.size();
+	fclose(f);
+	return ok;
+}
+
+static bool WriteBytes(const char* path, const uint8_t* data, size_t size)
+{
+	FILE* f = fopen(path, "wb");
+	if (!f)
+	{
+		return false;
+	}
+	bool ok = fwrite(data, 1, size, f) == size;
+	return fclose(f) == 0 && ok;
+}
+
+static void SelectRandom(int count)
+{
+	SelectionResize(selection, (int)objects.size());
+	SelectionClear(selection);
+	for (int k = 0; k < count; ++k)
+	{
+		SelectionAdd(selection, (int)(BenchRandom() % objects.size()));
+	}
+}
+
+static std::vector<double> pumpMs;
+
+static void Pump()
+{
+	double t0 = BenchNowMs();
+	SceneJournalPump();
+	pumpMs.push_back(BenchNowMs() - t0);
+}
+
+// A color edit followed by a Mark-all of positions (entering play mode) must
+// reach the consumer as both.
+static bool MarkAllKeepsPending(int count)
+{
+	SceneChangeChannel channel;
+	SceneChangesRegister(&channel);
+	ConsumeSceneChanges(channel, [](int, uint32_t) {});
+	MarkObjectChanged(count - 1, SceneChange_Color);
+	MarkAllObjectsChanged(SceneChange_Position);
+	uint32_t all = ConsumeSceneChanges(channel, [](int, uint32_t) {});
+	SceneChangesUnregister(&channel);
+	return all == (SceneChange_Color | SceneChange_Position);
+}
+
+// Replaces objects with what the journal at path recovers.
+static SceneJournalRecovery Replay(const char* path, const char* scenePath, double& ms)
+{
+	objects.assign(1, Rect{ 0.0f, 0.0f, 1.0f, 1.0f, ImVec4(1, 1, 1, 1) });
+	double t0 = BenchNowMs();
+	SceneJournalRecovery r = SceneJournalInit(path, scenePath);
+	ms = BenchNowMs() - t0;
+	SceneJournalShutdown();
+	return r;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<int> counts = { 10000, 100000, 1000000 };
+	const char* path = "edit_bench.mjnl";
+	uint32_t seed = 1;
+	const char* outPath = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+		{
+			counts.clear();
+			for (const char* p = argv[++i]; *p; )
+			{
+				counts.push_back(atoi(p));
+				while (*p && *p != ',') ++p;
+				if (*p == ',') ++p;
+			}
+		}
+		else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc)
+		{
+			path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+		{
+			outPath = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--objects N,N,...] [--path file.mjnl] [--seed N] [--out file.json]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (counts.empty())
+	{
+		fprintf(stderr, "nothing to run\n");
+		return 1;
+	}
+	BenchSeedRandom(seed);
+	std::string stalePath = std::string(path) + ".stale";
+	SceneJournalSetCompactInterval(1e9);
+
+	FILE* f = outPath ? fopen(outPath, "w") : stdout;
+	if (!f)
+	{
+		fprintf(stderr, "failed to open %s\n", outPath);
+		return 1;
+	}
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"benchmark\": \"edit\",\n");
+	BenchWriteHardwareJson(f, "  ");
+	fprintf(f, ",\n");
+	fprintf(f, "  \"config\": { \"seed\": %u },\n", seed);
+	fprintf(f, "  \"scenes\": [\n");
+
+	int failures = 0;
+	std::vector<uint8_t> journal;
+	for (size_t s = 0; s < counts.size(); ++s)
+	{
+		int count = counts[s] > 0 ? counts[s] : 1;
+		fprintf(stderr, "edit: %d objects\n", count);
+		BenchBuildScene(objects, count);
+		SelectionResize(selection, count);
+		UndoClear();
+		remove(path);
+		pumpMs.clear();
+		bool changesOk = MarkAllKeepsPending(count);
+		bool journalOk = SceneJournalInit(path, nullptr) == SceneJournalRecovery_None;
+
+		// Every command leaves one entry; undo walks back through them.
+		std::vector<std::vector<Rect>> states = { objects };
+
+		SelectRandom(count / 100 + 1);
+		UndoBeginEdit("Move");
+		SelectionForEach(selection, [](int i) { UndoCapture(i); });
+		for (int frame = 0; frame < 30; ++frame)
+		{
+			SelectionForEach(selection, [](int i)
+			{
+				objects[i].x += 1.0f;
+				MarkObjectChanged(i, SceneChange_Position);
+			});
+			Pump();
+		}
+		UndoEndEdit("Move");
+		states.push_back(objects);
+
+		UndoBeginEdit("Edit");
+		for (int frame = 0; frame < 20; ++frame)
+		{
+			for (int k = 0; k < count / 1000 + 1; ++k)
+			{
+				int i = (int)(BenchRandom() % objects.size());
+				UndoCapture(i);
+				Rect& R = objects[i];
+				switch (BenchRandom() % 3)
+				{
+				case 0: R.h = BenchRandomFloat(1.0f, 20.0f); MarkObjectChanged(i, SceneChange_Size); break;
+				case 1: R.color.z = BenchRandomFloat(0.0f, 1.0f); MarkObjectChanged(i, SceneChange_Color); break;
+				default: R.sprite = (int)(BenchRandom() % 64); MarkObjectChanged(i, SceneChange_Sprite); break;
+				}
+			}
+			Pump();
+		}
+		UndoEndEdit("Edit");
+		states.push_back(objects);
+
+		SelectRandom(count / 50 + 1);
+		DuplicateSelection();
+		Pump();
+		states.push_back(objects);
+
+		SelectRandom(count / 20 + 1);
+		DeleteSelection();
+		Pump();
+		states.push_back(objects);
+
+		// The last edit is a batch of its own at the end of the journal.
+		SceneJournalFlush();
+		UndoBeginEdit("Color");
+		UndoCapture(0);
+		objects[0].color = ImVec4(0.25f, 0.5f, 0.75f, 1.0f);
+		MarkObjectChanged(0, SceneChange_Color);
+		UndoEndEdit("Color");
+		Pump();
+		states.push_back(objects);
+		SceneJournalFlush();
+		journalOk = journalOk && ReadBytes(path, journal) && journal.size() > 4;
+		SceneJournalStats stats = SceneJournalGetStats();
+
+		// Undo to the start, then redo to the end.
+		bool undoMatch = true;
+		double t0 = BenchNowMs();
+		for (size_t k = states.size() - 1; k-- > 0; )
+		{
+			undoMatch = UndoLast() && BenchSameObjects(objects, states[k]) && undoMatch;
+		}
+		double undoMs = BenchNowMs() - t0;
+		undoMatch = !UndoLast() && undoMatch;
+		t0 = BenchNowMs();
+		for (size_t k = 1; k < states.size(); ++k)
+		{
+			undoMatch = RedoNext() && BenchSameObjects(objects, states[k]) && undoMatch;
+		}
+		double redoMs = BenchNowMs() - t0;
+		undoMatch = !RedoNext() && undoMatch;
+		size_t undoBytes = UndoGetStats().usedBytes;
+		SceneJournalShutdown();
+
+		const std::vector<Rect>& last = states.back();
+		const std::vector<Rect>& beforeLast = states[states.size() - 2];
+		double recoverMs = 0.0, ms;
+		bool recoverMatch = false, tornMatch = false, corruptMatch = false, foreignMatch = false;
+		if (journalOk)
+		{
+			recoverMatch = WriteBytes(path, journal.data(), journal.size()) && Replay(path, nullptr, recoverMs) == SceneJournalRecovery_Replayed && BenchSameObjects(objects, last);
+			tornMatch = WriteBytes(path, journal.data(), journal.size() - 3) && Replay(path, nullptr, ms) == SceneJournalRecovery_Replayed && BenchSameObjects(objects, beforeLast);
+			journal.back() ^= 0x5A;
+			corruptMatch = WriteBytes(path, journal.data(), journal.size()) && Replay(path, nullptr, ms) == SceneJournalRecovery_Replayed && BenchSameObjects(objects, beforeLast);
+			journal.back() ^= 0x5A;
+			// The single object Replay leaves must survive, and the journal must be kept.
+			std::vector<uint8_t> kept;
+			foreignMatch = WriteBytes(path, journal.data(), journal.size()) && Replay(path, "other.mscn", ms) == SceneJournalRecovery_SetAside && objects.size() == 1 && ReadBytes(stalePath.c_str(), kept) && kept == journal;
+			remove(stalePath.c_str());
+		}
+		else
+		{
+			fprintf(stderr, "%d objects: journal not written\n", count);
+		}
+		failures += !changesOk + !journalOk + !recoverMatch + !tornMatch + !corruptMatch + !foreignMatch + !undoMatch;
+		if (journalOk && !recoverMatch)
+		{
+			fprintf(stderr, "%d objects: replayed journal differs from the scene\n", count);
+		}
+		if (journalOk && !tornMatch)
+		{
+			fprintf(stderr, "%d objects: journal with a torn tail did not give back the scene before the last edit\n", count);
+		}
+		if (journalOk && !corruptMatch)
+		{
+			fprintf(stderr, "%d objects: journal with a bad checksum did not give back the scene before the last edit\n", count);
+		}
+		if (journalOk && !foreignMatch)
+		{
+			fprintf(stderr, "%d objects: journal for another scene was not set aside\n", count);
+		}
+		if (!changesOk)
+		{
+			fprintf(stderr, "%d objects: a Mark-all dropped the changes pending before it\n", count);
+		}
+		if (!undoMatch)
+		{
+			fprintf(stderr, "%d objects: undo or redo did not restore the scene\n", count);
+		}
+
+		double pumpSum = 0.0, pumpMax = 0.0;
+		for (double p : pumpMs)
+		{
+			pumpSum += p;
+			pumpMax = p > pumpMax ? p : pumpMax;
+		}
+		fprintf(f, "    {\n");
+		fprintf(f, "      \"objects\": %d,\n", count);
+		fprintf(f, "      \"frames\": %d,\n", (int)pumpMs.size());
+		fprintf(f, "      \"pump_ms_avg\": %.4f,\n", pumpMs.empty() ? 0.0 : pumpSum / pumpMs.size());
+		fprintf(f, "      \"pump_ms_max\": %.4f,\n", pumpMax);
+		fprintf(f, "      \"journal_mb\": %.2f,\n", journal.size() / (1024.0 * 1024.0));
+		fprintf(f, "      \"snapshot_ms\": %.3f,\n", stats.snapshotMs);
+		fprintf(f, "      \"recover_ms\": %.3f,\n", recoverMs);
+		fprintf(f, "      \"journal_round_trip\": %s,\n", journalOk && recoverMatch && tornMatch && corruptMatch && foreignMatch ? "true" : "false");
+		fprintf(f, "      \"undo_kb\": %.1f,\n", undoBytes / 1024.0);
+		fprintf(f, "      \"undo_all_ms\": %.3f,\n", undoMs);
+		fprintf(f, "      \"redo_all_ms\": %.3f,\n", redoMs);
+		fprintf(f, "      \"undo_round_trip\": %s\n", undoMatch ? "true" : "false");
+		fprintf(f, "    }%s\n", s + 1 < counts.size() ? "," : "");
+	}
+	remove(path);
+
+	fprintf(f, "  ]\n");
+	fprintf(f, "}\n");
+	if (f != stdout)
+	{
+		fclose(f);
+	}
+	return failures > 0 ? 2 : 0;
+}
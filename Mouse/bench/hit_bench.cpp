@@ -0,0 +1,239 @@
+// Hit-test kernel benchmark. Runs every query type on every ISA the CPU
+// supports over random scenes and reports objects tested per nanosecond.
+// Results from each ISA, and rect queries through the spatial grid, are
+// checked against the scalar kernels; any difference makes the process exit
+// with 2.
+//
+//   hit_bench [--objects 10000,100000,1000000] [--queries 64] [--seed 1] [--out results.json]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+#include "hit_test.h"
+#include "spatial_grid.h"
+#include "bench_util.h"
+
+enum Query {
+	Query_PointTopmost,
+	Query_PointMask,
+	Query_RectOverlap,
+	Query_RectContain,
+	Query_Count
+};
+
+static const char* const kQueryNames[Query_Count] = { "point_topmost", "point_mask", "rect_overlap", "rect_contain" };
+
+struct QueryInput {
+	float x0, y0, x1, y1;
+};
+
+static void BuildColumns(HitColumns& cols, int count)
+{
+	HitColumnsResize(cols, count);
+	for (int i = 0; i < count; ++i)
+	{
+		float x = BenchRandomFloat(0.0f, 1900.0f), y = BenchRandomFloat(0.0f, 1060.0f);
+		HitColumnsSet(cols, i, x, y, x + BenchRandomFloat(1.0f, 20.0f), y + BenchRandomFloat(1.0f, 20.0f));
+	}
+}
+
+// Folds the hit indices into a checksum that must not depend on how they were found.
+static uint64_t MaskChecksum(const uint64_t* mask, int count, int* indices)
+{
+	int n = HitMaskToIndices(mask, count, indices);
+	uint64_t sum = (uint64_t)n;
+	for (int i = 0; i < n; ++i)
+	{
+		sum = sum * 1000003u + (uint64_t)indices[i];
+	}
+	return sum;
+}
+
+// Runs one query and returns its checksum.
+static uint64_t RunQuery(Query q, const HitColumns& cols, const QueryInput& in, uint64_t* mask, int* indices)
+{
+	switch (q)
+	{
+	case Query_PointTopmost:
+		return (uint64_t)(int64_t)HitTestPointTopmost(cols, in.x0, in.y0);
+	case Query_PointMask:
+		HitTestPointMask(cols, in.x0, in.y0, mask);
+		break;
+	case Query_RectOverlap:
+		HitTestRectMask(cols, in.x0, in.y0, in.x1, in.y1, HitRectMode_Overlap, mask);
+		break;
+	case Query_RectContain:
+		HitTestRectMask(cols, in.x0, in.y0, in.x1, in.y1, HitRectMode_Contain, mask);
+		break;
+	default:
+		break;
+	}
+	return MaskChecksum(mask, cols.count, indices);
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<int> counts = { 10000, 100000, 1000000 };
+	int queries = 64;
+	uint32_t seed = 1;
+	const char* outPath = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+		{
+			counts.clear();
+			for (const char* p = argv[++i]; *p; )
+			{
+				counts.push_back(atoi(p));
+				while (*p && *p != ',') ++p;
+				if (*p == ',') ++p;
+			}
+		}
+		else if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc)
+		{
+			queries = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+		{
+			outPath = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--objects N,N,...] [--queries N] [--seed N] [--out file.json]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (queries <= 0 || counts.empty())
+	{
+		fprintf(stderr, "nothing to run\n");
+		return 1;
+	}
+	BenchSeedRandom(seed);
+
+	FILE* f = outPath ? fopen(outPath, "w") : stdout;
+	if (!f)
+	{
+		fprintf(stderr, "failed to open %s\n", outPath);
+		return 1;
+	}
+
+	HitTestIsa best = HitTestGetIsa();
+	fprintf(f, "{\n");
+	fprintf(f, "  \"benchmark\": \"hit_test\",\n");
+	BenchWriteHardwareJson(f, "  ");
+	fprintf(f, ",\n");
+	fprintf(f, "  \"config\": { \"queries\": %d, \"seed\": %u, \"dispatch\": \"%s\" },\n", queries, seed, HitTestIsaName(best));
+	fprintf(f, "  \"scenes\": [\n");
+
+	int mismatches = 0;
+	HitColumns cols;
+	for (size_t s = 0; s < counts.size(); ++s)
+	{
+		int count = counts[s];
+		BuildColumns(cols, count);
+		std::vector<uint64_t> mask(HitMaskWords(count) + 1);
+		std::vector<int> indices(count + 1);
+		std::vector<QueryInput> inputs(queries);
+		for (QueryInput& in : inputs)
+		{
+			in.x0 = BenchRandomFloat(0.0f, 1900.0f);
+			in.y0 = BenchRandomFloat(0.0f, 1060.0f);
+			in.x1 = in.x0 + BenchRandomFloat(10.0f, 400.0f);
+			in.y1 = in.y0 + BenchRandomFloat(10.0f, 300.0f);
+		}
+
+		fprintf(stderr, "hit: %d objects\n", count);
+		fprintf(f, "    {\n");
+		fprintf(f, "      \"objects\": %d,\n", count);
+		fprintf(f, "      \"results\": [\n");
+		std::vector<uint64_t> reference(Query_Count * queries);
+		bool firstLine = true;
+		for (int isa = HitTestIsa_Scalar; isa < HitTestIsa_Count; ++isa)
+		{
+			if (!HitTestIsaSupported((HitTestIsa)isa))
+			{
+				continue;
+			}
+			HitTestSetIsa((HitTestIsa)isa);
+			for (int q = 0; q < Query_Count; ++q)
+			{
+				bool match = true;
+				std::vector<double> samples;
+				for (int k = 0; k < queries; ++k)
+				{
+					double t0 = BenchNowMs();
+					uint64_t sum = RunQuery((Query)q, cols, inputs[k], mask.data(), indices.data());
+					samples.push_back(BenchNowMs() - t0);
+					uint64_t& ref = reference[q * queries + k];
+					if (isa == HitTestIsa_Scalar)
+					{
+						ref = sum;
+					}
+					else if (ref != sum)
+					{
+						match = false;
+					}
+				}
+				mismatches += !match;
+				StageSummary summary = BenchSummarize(samples);
+				double objectsPerNs = summary.p50Ms > 0.0 ? count / (summary.p50Ms * 1e6) : 0.0;
+				fprintf(f, "%s        { \"isa\": \"%s\", \"query\": \"%s\", \"p50_ms\": %.4f, \"objects_per_ns\": %.3f, \"matches_scalar\": %s }",
+					firstLine ? "" : ",\n", HitTestIsaName((HitTestIsa)isa), kQueryNames[q], summary.p50Ms, objectsPerNs, match ? "true" : "false");
+				firstLine = false;
+				if (!match)
+				{
+					fprintf(stderr, "%s %s differs from scalar at %d objects\n", HitTestIsaName((HitTestIsa)isa), kQueryNames[q], count);
+				}
+			}
+		}
+
+		SpatialGrid grid;
+		double buildStart = BenchNowMs();
+		SpatialGridBuild(grid, cols, 64.0f);
+		double buildMs = BenchNowMs() - buildStart;
+		for (int q = Query_RectOverlap; q <= Query_RectContain; ++q)
+		{
+			HitRectMode mode = q == Query_RectContain ? HitRectMode_Contain : HitRectMode_Overlap;
+			bool match = true;
+			std::vector<double> samples;
+			for (int k = 0; k < queries; ++k)
+			{
+				const QueryInput& in = inputs[k];
+				double t0 = BenchNowMs();
+				memset(mask.data(), 0, mask.size() * sizeof(uint64_t));
+				SpatialGridQueryRect(grid, cols, in.x0, in.y0, in.x1, in.y1, mode, mask.data());
+				uint64_t sum = MaskChecksum(mask.data(), count, indices.data());
+				samples.push_back(BenchNowMs() - t0);
+				match &= sum == reference[q * queries + k];
+			}
+			mismatches += !match;
+			StageSummary summary = BenchSummarize(samples);
+			fprintf(f, ",\n        { \"isa\": \"grid\", \"query\": \"%s\", \"p50_ms\": %.4f, \"build_ms\": %.4f, \"matches_scalar\": %s }",
+				kQueryNames[q], summary.p50Ms, buildMs, match ? "true" : "false");
+			if (!match)
+			{
+				fprintf(stderr, "grid %s differs from scalar at %d objects\n", kQueryNames[q], count);
+			}
+		}
+		fprintf(f, "\n      ]\n");
+		fprintf(f, "    }%s\n", s + 1 < counts.size() ? "," : "");
+	}
+	HitTestSetIsa(best);
+	HitColumnsFree(cols);
+
+	fprintf(f, "  ]\n");
+	fprintf(f, "}\n");
+	if (f != stdout)
+	{
+		fclose(f);
+	}
+	return mismatches > 0 ? 2 : 0;
+}
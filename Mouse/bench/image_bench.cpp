@@ -0,0 +1,476 @@
+// Image decoder benchmark. Encodes a random image in every supported format
+// variant (TGA raw and RLE, true color and grayscale; PPM and PGM; BMP 24 bit
+// and 32 bit bitfields) and reports decode throughput. Every decode must give
+// back the source pixels. Each file is then cut short at several points,
+// which must fail, and given known-bad headers, which must fail as well. The
+// header alone, claiming the largest size, must fail before the decoder
+// allocates the pixels.
+// Randomly damaged copies may decode or fail, but a decoded one must have a
+// valid size. Any difference makes the process exit with 2.
+//
+//   image_bench [--size 1024] [--reps 5] [--fuzz 200] [--seed 1] [--out results.json]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "image_decode.h"
+#include "bench_util.h"
+
+// A header field overwritten with a value the decoder must reject.
+struct BadField {
+	size_t at;
+	uint32_t value;
+	int bytes;
+};
+
+struct Encoded {
+	std::string name;
+	std::vector<uint8_t> bytes;
+	size_t pixelOffset; // where the header ends
+	DecodedImage expected;
+	std::vector<BadField> badFields;
+	std::vector<uint8_t> hugeHeader; // no pixels, kMaxImageDimension squared
+};
+
+static void PatchField(std::vector<uint8_t>& bytes, const BadField& field)
+{
+	for (int k = 0; k < field.bytes; ++k)
+	{
+		bytes[field.at + k] = (uint8_t)(field.value >> (8 * k));
+	}
+}
+
+static void PutU16(std::vector<uint8_t>& out, uint32_t v)
+{
+	out.push_back((uint8_t)v);
+	out.push_back((uint8_t)(v >> 8));
+}
+
+static void PutU32(std::vector<uint8_t>& out, uint32_t v)
+{
+	PutU16(out, v & 0xFFFF);
+	PutU16(out, v >> 16);
+}
+
+// Random pixels in short runs of one color, so RLE gets both packet kinds.
+// Gray images have r = g = b.
+static void BuildImage(DecodedImage& img, int w, int h, bool gray, bool alpha, int maxValue)
+{
+	img.width = w;
+	img.height = h;
+	img.rgba.resize((size_t)w * h * 4);
+	uint8_t c[4] = {};
+	for (size_t i = 0, run = 0; i < (size_t)w * h; ++i)
+	{
+		if (run == 0)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				c[k] = (uint8_t)(BenchRandom() % (maxValue + 1));
+			}
+			if (gray)
+			{
+				c[1] = c[2] = c[0];
+			}
+			c[3] = alpha ? (uint8_t)BenchRandom() : 255;
+			run = BenchRandom() % 4 == 0 ? 1 + BenchRandom() % 200 : 1;
+		}
+		--run;
+		memcpy(&img.rgba[i * 4], c, 4);
+	}
+}
+
+static void PutTgaPixel(std::vector<uint8_t>& out, const uint8_t* p, int bytes)
+{
+	if (bytes == 1)
+	{
+		out.push_back(p[0]);
+		return;
+	}
+	out.push_back(p[2]);
+	out.push_back(p[1]);
+	out.push_back(p[0]);
+	if (bytes == 4)
+	{
+		out.push_back(p[3]);
+	}
+}
+
+static Encoded EncodeTga(int w, int h, bool gray, bool alpha, bool rle, bool topDown)
+{
+	Encoded e;
+	e.name = std::string("tga_") + (gray ? "gray" : alpha ? "32" : "24") + (rle ? "_rle" : "") + (topDown ? "_topdown" : "");
+	BuildImage(e.expected, w, h, gray, alpha, 255);
+	int bytes = gray ? 1 : alpha ? 4 : 3;
+	std::vector<uint8_t>& out = e.bytes;
+	const char id[] = "mouse";
+	out.push_back((uint8_t)(sizeof(id) - 1));
+	out.push_back(0);
+	out.push_back((uint8_t)(gray ? (rle ? 11 : 3) : (rle ? 10 : 2)));
+	out.insert(out.end(), 5, 0);
+	PutU16(out, 0);
+	PutU16(out, 0);
+	PutU16(out, w);
+	PutU16(out, h);
+	out.push_back((uint8_t)(bytes * 8));
+	out.push_back((uint8_t)((topDown ? 0x20 : 0) | (alpha ? 8 : 0)));
+	out.insert(out.end(), id, id + sizeof(id) - 1);
+	e.pixelOffset = out.size();
+	// Color-mapped, unknown type, zero width, oversized height, 16 bit.
+	e.badFields = { { 2, 1, 1 }, { 2, 0x7F, 1 }, { 12, 0, 2 }, { 14, 0xFFFF, 2 }, { 16, 16, 1 } };
+	e.hugeHeader = out;
+	PatchField(e.hugeHeader, { 12, kMaxImageDimension, 2 });
+	PatchField(e.hugeHeader, { 14, kMaxImageDimension, 2 });
+
+	// Pixels in file order.
+	std::vector<const uint8_t*> order((size_t)w * h);
+	for (int y = 0; y < h; ++y)
+	{
+		int row = topDown ? y : h - 1 - y;
+		for (int x = 0; x < w; ++x)
+		{
+			order[(size_t)y * w + x] = &e.expected.rgba[((size_t)row * w + x) * 4];
+		}
+	}
+	auto same = [&](size_t a, size_t b) { return memcmp(order[a], order[b], 4) == 0; };
+	for (size_t i = 0; i < order.size(); )
+	{
+		if (!rle)
+		{
+			PutTgaPixel(out, order[i++], bytes);
+			continue;
+		}
+		size_t run = 1;
+		while (run < 128 && i + run < order.size() && same(i, i + run))
+		{
+			++run;
+		}
+		if (run > 1)
+		{
+			out.push_back((uint8_t)(0x80 | (run - 1)));
+			PutTgaPixel(out, order[i], bytes);
+			i += run;
+			continue;
+		}
+		size_t raw = 1;
+		while (raw < 128 && i + raw < order.size() && !(i + raw + 1 < order.size() && same(i + raw, i + raw + 1)))
+		{
+			++raw;
+		}
+		out.push_back((uint8_t)(raw - 1));
+		for (size_t k = 0; k < raw; ++k)
+		{
+			PutTgaPixel(out, order[i + k], bytes);
+		}
+		i += raw;
+	}
+	return e;
+}
+
+static Encoded EncodePnm(int w, int h, bool gray, int maxValue)
+{
+	Encoded e;
+	e.name = std::string(gray ? "pgm" : "ppm") + (maxValue != 255 ? "_max" + std::to_string(maxValue) : "");
+	BuildImage(e.expected, w, h, gray, false, maxValue);
+	char header[96];
+	snprintf(header, sizeof(header), "P%c\n# mouse\n%d %d\n%d\n", gray ? '5' : '6', w, h, maxValue);
+	std::vector<uint8_t>& out = e.bytes;
+	out.assign(header, header + strlen(header));
+	e.pixelOffset = out.size();
+	// A width that is not a number, and a 16 bit maximum value.
+	size_t maxAt = e.pixelOffset - std::to_string(maxValue).size() - 1;
+	e.badFields = { { 11, '-', 1 }, { maxAt, '6' | '5' << 8 | '5' << 16 | '3' << 24, 4 } };
+	snprintf(header, sizeof(header), "P%c\n%d %d\n%d\n", gray ? '5' : '6', kMaxImageDimension, kMaxImageDimension, maxValue);
+	e.hugeHeader.assign(header, header + strlen(header));
+	for (size_t i = 0; i < (size_t)w * h; ++i)
+	{
+		uint8_t* p = &e.expected.rgba[i * 4];
+		for (int c = 0; c < (gray ? 1 : 3); ++c)
+		{
+			out.push_back(p[c]);
+		}
+		for (int c = 0; c < 3; ++c)
+		{
+			p[c] = (uint8_t)(p[c] * 255 / maxValue);
+		}
+	}
+	return e;
+}
+
+// 24 bit: BITMAPINFOHEADER, bottom-up. 32 bit: BITMAPV3INFOHEADER with an
+// alpha mask, top-down, with the channels in an unusual order.
+static Encoded EncodeBmp(int w, int h, bool bitfields)
+{
+	Encoded e;
+	e.name = bitfields ? "bmp_32_bitfields" : "bmp_24";
+	BuildImage(e.expected, w, h, false, bitfields, 255);
+	int bytes = bitfields ? 4 : 3;
+	uint32_t infoSize = bitfields ? 56 : 40;
+	size_t stride = ((size_t)w * bytes + 3) & ~(size_t)3;
+	uint32_t offset = 14 + infoSize;
+	std::vector<uint8_t>& out = e.bytes;
+	out.push_back('B');
+	out.push_back('M');
+	PutU32(out, (uint32_t)(offset + stride * h));
+	PutU32(out, 0);
+	PutU32(out, offset);
+	PutU32(out, infoSize);
+	PutU32(out, (uint32_t)w);
+	PutU32(out, bitfields ? (uint32_t)-h : (uint32_t)h);
+	PutU16(out, 1);
+	PutU16(out, bytes * 8);
+	PutU32(out, bitfields ? 3 : 0);
+	PutU32(out, (uint32_t)(stride * h));
+	PutU32(out, 2835);
+	PutU32(out, 2835);
+	PutU32(out, 0);
+	PutU32(out, 0);
+	// R, G, B, A masks.
+	static const uint32_t masks[4] = { 0x0000FF00, 0xFF000000, 0x000000FF, 0x00FF0000 };
+	if (bitfields)
+	{
+		for (uint32_t m : masks)
+		{
+			PutU32(out, m);
+		}
+	}
+	e.pixelOffset = out.size();
+	uint32_t fileSize = (uint32_t)(offset + stride * h);
+	// Pixels past the end, an OS/2 header, oversized width, zero height,
+	// 8 bit, RLE8.
+	e.badFields = { { 10, fileSize, 4 }, { 14, 12, 4 }, { 18, 20000, 4 }, { 22, 0, 4 }, { 28, 8, 2 }, { 30, 1, 4 } };
+	e.hugeHeader = out;
+	PatchField(e.hugeHeader, { 18, kMaxImageDimension, 4 });
+	PatchField(e.hugeHeader, { 22, kMaxImageDimension, 4 });
+	for (int y = 0; y < h; ++y)
+	{
+		const uint8_t* row = &e.expected.rgba[(size_t)(bitfields ? y : h - 1 - y) * w * 4];
+		for (int x = 0; x < w; ++x)
+		{
+			const uint8_t* p = row + x * 4;
+			if (bitfields)
+			{
+				uint32_t v = 0;
+				for (int c = 0; c < 4; ++c)
+				{
+					uint32_t shift = masks[c] == 0xFF000000 ? 24 : masks[c] == 0x00FF0000 ? 16 : masks[c] == 0x0000FF00 ? 8 : 0;
+					v |= (uint32_t)p[c] << shift;
+				}
+				PutU32(out, v);
+			}
+			else
+			{
+				out.push_back(p[2]);
+				out.push_back(p[1]);
+				out.push_back(p[0]);
+			}
+		}
+		out.insert(out.end(), stride - (size_t)w * bytes, 0);
+	}
+	return e;
+}
+
+static bool SameImage(const DecodedImage& a, const DecodedImage& b)
+{
+	return a.width == b.width && a.height == b.height && a.rgba == b.rgba;
+}
+
+int main(int argc, char** argv)
+{
+	int size = 1024;
+	int reps = 5;
+	int fuzz = 200;
+	uint32_t seed = 1;
+	const char* outPath = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+		{
+			size = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc)
+		{
+			reps = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--fuzz") == 0 && i + 1 < argc)
+		{
+			fuzz = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+		{
+			outPath = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--size N] [--reps N] [--fuzz N] [--seed N] [--out file.json]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (size < 2 || size > kMaxImageDimension || reps < 1)
+	{
+		fprintf(stderr, "size must be in [2, %d] and reps at least 1\n", kMaxImageDimension);
+		return 1;
+	}
+	BenchSeedRandom(seed);
+
+	FILE* f = outPath ? fopen(outPath, "w") : stdout;
+	if (!f)
+	{
+		fprintf(stderr, "failed to open %s\n", outPath);
+		return 1;
+	}
+
+	// Odd widths give BMP rows padding.
+	int w = size + 1, h = size * 3 / 4;
+	std::vector<Encoded> files;
+	files.push_back(EncodeTga(w, h, false, false, false, false));
+	files.push_back(EncodeTga(w, h, false, true, false, true));
+	files.push_back(EncodeTga(w, h, false, false, true, false));
+	files.push_back(EncodeTga(w, h, false, true, true, false));
+	files.push_back(EncodeTga(w, h, true, false, false, false));
+	files.push_back(EncodeTga(w, h, true, false, true, true));
+	files.push_back(EncodePnm(w, h, false, 255));
+	files.push_back(EncodePnm(w, h, true, 255));
+	files.push_back(EncodePnm(w, h, false, 100));
+	files.push_back(EncodeBmp(w, h, false));
+	files.push_back(EncodeBmp(w, h, true));
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"benchmark\": \"image_decode\",\n");
+	BenchWriteHardwareJson(f, "  ");
+	fprintf(f, ",\n");
+	fprintf(f, "  \"config\": { \"width\": %d, \"height\": %d, \"reps\": %d, \"fuzz\": %d, \"seed\": %u },\n", w, h, reps, fuzz, seed);
+	fprintf(f, "  \"formats\": [\n");
+
+	int failures = 0;
+	DecodedImage image;
+	for (size_t s = 0; s < files.size(); ++s)
+	{
+		Encoded& e = files[s];
+		fprintf(stderr, "image: %s\n", e.name.c_str());
+
+		double bestMs = 0.0;
+		bool match = true;
+		for (int r = 0; r < reps; ++r)
+		{
+			const char* error = nullptr;
+			double t0 = BenchNowMs();
+			bool ok = DecodeImage(e.bytes.data(), e.bytes.size(), image, &error);
+			double ms = BenchNowMs() - t0;
+			bestMs = r == 0 || ms < bestMs ? ms : bestMs;
+			if (!ok)
+			{
+				fprintf(stderr, "%s: %s\n", e.name.c_str(), error);
+			}
+			match = ok && SameImage(image, e.expected) && match;
+		}
+		if (!match)
+		{
+			fprintf(stderr, "%s: decoded pixels differ from the source\n", e.name.c_str());
+		}
+
+		// Cut inside the header, at its end and inside the pixels.
+		size_t header = e.pixelOffset, total = e.bytes.size();
+		size_t cuts[] = { 0, 1, 2, header / 2, header - 1, header, header + 1, header + (total - header) / 2, total - 1 };
+		int truncatedFailed = 0;
+		for (size_t cut : cuts)
+		{
+			const char* error = nullptr;
+			truncatedFailed += !DecodeImage(e.bytes.data(), cut, image, &error) && error;
+		}
+		int truncatedCount = (int)(sizeof(cuts) / sizeof(cuts[0]));
+
+		int corruptFailed = 0, corruptCount = (int)e.badFields.size();
+		for (const BadField& field : e.badFields)
+		{
+			std::vector<uint8_t> bad = e.bytes;
+			PatchField(bad, field);
+			const char* error = nullptr;
+			corruptFailed += !DecodeImage(bad.data(), bad.size(), image, &error) && error;
+		}
+
+		bool hugeRejected;
+		{
+			DecodedImage huge;
+			const char* error = nullptr;
+			hugeRejected = !DecodeImage(e.hugeHeader.data(), e.hugeHeader.size(), huge, &error) && error && huge.rgba.capacity() == 0;
+		}
+
+		// Random damage, mostly in the header, may decode or not, but must
+		// never give back an image of the wrong size.
+		int fuzzDecoded = 0;
+		bool fuzzSane = true;
+		for (int k = 0; k < fuzz; ++k)
+		{
+			std::vector<uint8_t> bad = e.bytes;
+			int flips = 1 + BenchRandom() % 4;
+			for (int j = 0; j < flips; ++j)
+			{
+				size_t at = BenchRandom() % 2 ? BenchRandom() % (header + 16) : BenchRandom() % bad.size();
+				bad[at % bad.size()] ^= (uint8_t)(1 + BenchRandom() % 255);
+			}
+			size_t length = BenchRandom() % 4 == 0 ? BenchRandom() % bad.size() : bad.size();
+			const char* error = nullptr;
+			if (DecodeImage(bad.data(), length, image, &error))
+			{
+				++fuzzDecoded;
+				fuzzSane = fuzzSane && image.width > 0 && image.height > 0 && image.width <= kMaxImageDimension && image.height <= kMaxImageDimension && image.rgba.size() == (size_t)image.width * image.height * 4;
+			}
+			else
+			{
+				fuzzSane = fuzzSane && error;
+			}
+		}
+
+		bool truncatedOk = truncatedFailed == truncatedCount;
+		bool corruptOk = corruptFailed == corruptCount;
+		failures += !match + !truncatedOk + !corruptOk + !hugeRejected + !fuzzSane;
+		if (!truncatedOk)
+		{
+			fprintf(stderr, "%s: %d of %d truncated files decoded\n", e.name.c_str(), truncatedCount - truncatedFailed, truncatedCount);
+		}
+		if (!corruptOk)
+		{
+			fprintf(stderr, "%s: %d of %d bad headers accepted\n", e.name.c_str(), corruptCount - corruptFailed, corruptCount);
+		}
+		if (!hugeRejected)
+		{
+			fprintf(stderr, "%s: a header without pixels was not rejected before allocating\n", e.name.c_str());
+		}
+		if (!fuzzSane)
+		{
+			fprintf(stderr, "%s: a damaged file decoded to an invalid image\n", e.name.c_str());
+		}
+
+		double mb = e.expected.rgba.size() / (1024.0 * 1024.0);
+		fprintf(f, "    {\n");
+		fprintf(f, "      \"format\": \"%s\",\n", e.name.c_str());
+		fprintf(f, "      \"file_kb\": %.1f,\n", e.bytes.size() / 1024.0);
+		fprintf(f, "      \"decode_ms\": %.3f,\n", bestMs);
+		fprintf(f, "      \"decode_mb_per_s\": %.1f,\n", bestMs > 0.0 ? mb * 1000.0 / bestMs : 0.0);
+		fprintf(f, "      \"round_trip\": %s,\n", match ? "true" : "false");
+		fprintf(f, "      \"truncated_rejected\": %d,\n", truncatedFailed);
+		fprintf(f, "      \"bad_headers_rejected\": %d,\n", corruptFailed);
+		fprintf(f, "      \"huge_header_rejected\": %s,\n", hugeRejected ? "true" : "false");
+		fprintf(f, "      \"fuzz_decoded\": %d,\n", fuzzDecoded);
+		fprintf(f, "      \"checks_passed\": %s\n", truncatedOk && corruptOk && hugeRejected && fuzzSane ? "true" : "false");
+		fprintf(f, "    }%s\n", s + 1 < files.size() ? "," : "");
+	}
+
+	fprintf(f, "  ]\n");
+	fprintf(f, "}\n");
+	if (f != stdout)
+	{
+		fclose(f);
+	}
+	return failures > 0 ? 2 : 0;
+}
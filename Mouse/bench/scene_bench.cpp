@@ -0,0 +1,360 @@
+// Headless stress-scene benchmark. Builds synthetic scenes of Rect objects,
+// runs a fixed number of frames with a fixed delta and times each stage of
+// the editor frame separately. No window, GL context or vsync is involved.
+//
+//   scene_bench [--objects 10000,100000,1000000] [--frames 120] [--dt 0.016]
+//               [--zoom 1] [--edit] [--sprites 0] [--seed 1] [--out results.json]
+//
+// --zoom below 1 views the scene from further out, where most objects go
+// through the scene view's LOD tiles instead of being drawn one by one.
+// --edit runs editor frames instead of play frames: nothing moves, a random
+// object is selected every kEditClickFrames frames (a click rate of about 4/s
+// at 60 Hz), and unselected objects come from the layer cache through its
+// CPU raster backend.
+// --sprites N packs N distinct procedural images into the texture atlas and
+// turns every object into a sprite; consecutive objects share an image, the
+// way a level groups its props, so draw calls follow the number of pages.
+//
+// The frame arena starts at the editor's size. Once it has grown to fit, a
+// frame that still falls back to the heap makes the process exit with 2.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+#include "imgui.h"
+#include "scene.h"
+#include "layer_cache.h"
+#include "frame_arena.h"
+#include "texture_atlas.h"
+#include "bench_util.h"
+
+static const float kDisplayWidth = 1920.0f;
+static const float kDisplayHeight = 1080.0f;
+static const int kPickQueries = 256;
+static const int kEditClickFrames = 15;
+// The editor's starting size; the arena grows to fit the scene.
+static const size_t kFrameArenaBytes = 256 * 1024;
+// Frames before the arena has grown to fit and heap fallbacks must stop.
+static const int kArenaWarmupFrames = 4;
+
+enum Stage {
+	Stage_Simulation,
+	Stage_Picking,
+	Stage_Marquee,
+	Stage_SceneGeometry,
+	Stage_Render,
+	Stage_Submit,
+	Stage_Count
+};
+
+static const char* const kStageNames[Stage_Count] = {
+	"simulation", "picking", "marquee_select", "scene_geometry", "imgui_render", "backend_submit"
+};
+
+struct SceneResult {
+	int objects;
+	SubmitStats submit;
+	SceneViewStats view;
+	int tilesRedrawn;
+	int fallbackFrames;
+	unsigned int arenaOverflows; // heap fallbacks after warmup
+	size_t arenaBytes;
+	StageSummary stages[Stage_Count];
+	double frameMeanMs;
+};
+
+static int spriteImages = 0;
+static int atlasPages = 0;
+
+// Small images with a per-image gradient, so no two are alike.
+static void BuildSpriteImages(int count)
+{
+	std::vector<ImU32> pixels;
+	for (int i = 0; i < count; ++i)
+	{
+		int w = 8 + (int)(BenchRandom() % 25), h = 8 + (int)(BenchRandom() % 25);
+		uint32_t c0 = BenchRandom(), c1 = BenchRandom();
+		pixels.resize(w * h);
+		for (int y = 0; y < h; ++y)
+		{
+			for (int x = 0; x < w; ++x)
+			{
+				pixels[y * w + x] = ((x + y) & 1 ? c0 : c1) | IM_COL32_A_MASK;
+			}
+		}
+		if (AtlasAddImage(pixels.data(), w, h) < 0)
+		{
+			fprintf(stderr, "sprite %d did not fit the atlas\n", i);
+		}
+	}
+}
+
+// Mostly small objects with a tail of larger ones, scattered across the display.
+static void BuildStressScene(int count)
+{
+	objects.clear();
+	objects.reserve(count);
+	for (int i = 0; i < count; ++i)
+	{
+		uint32_t kind = BenchRandom() % 100;
+		float size = kind < 70 ? BenchRandomFloat(1.0f, 8.0f) : (kind < 95 ? BenchRandomFloat(8.0f, 64.0f) : BenchRandomFloat(64.0f, 256.0f));
+		float w = size * BenchRandomFloat(0.5f, 1.5f);
+		float h = size * BenchRandomFloat(0.5f, 1.5f);
+		Rect R;
+		R.x = BenchRandomFloat(0.0f, kDisplayWidth - w);
+		R.y = BenchRandomFloat(0.0f, kDisplayHeight - h);
+		R.w = w;
+		R.h = h;
+		R.color = ImVec4(BenchRandomFloat(0.0f, 1.0f), BenchRandomFloat(0.0f, 1.0f), BenchRandomFloat(0.0f, 1.0f), 1.0f);
+		if (spriteImages > 0)
+		{
+			R.sprite = (int)((int64_t)i * spriteImages / count);
+		}
+		objects.push_back(R);
+	}
+	SelectionResize(selection, count);
+	SelectionClear(selection);
+	selectedIndex = -1;
+	MarkAllObjectsChanged(SceneChange_All);
+}
+
+static SceneResult RunScene(int count, int frames, float dt, float zoom, bool edit)
+{
+	BuildStressScene(count);
+	playMode = !edit;
+	sceneCamera = SceneCamera();
+	sceneCamera.zoom = zoom;
+
+	std::vector<double> samples[Stage_Count];
+	std::vector<double> frameTimes;
+	for (auto& s : samples)
+	{
+		s.reserve(frames);
+	}
+	frameTimes.reserve(frames);
+
+	ImGuiIO& io = ImGui::GetIO();
+	io.DeltaTime = dt;
+	SceneResult result = {};
+	result.objects = count;
+	volatile int pickSink = 0;
+	SelectionSet marquee;
+	int fallbackStart = LayerCacheGetStats().fallbackFrames;
+	unsigned int overflowStart = 0;
+
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		double frameStart = BenchNowMs();
+		FrameArenaReset();
+		if (frame == kArenaWarmupFrames)
+		{
+			overflowStart = FrameArenaGetStats().overflows;
+		}
+		ImGui::NewFrame();
+
+		double t0 = BenchNowMs();
+		if (edit && frame % kEditClickFrames == 0)
+		{
+			SelectionClear(selection);
+			SelectionAdd(selection, (int)(BenchRandom() % (uint32_t)count));
+		}
+		else if (!edit)
+		{
+			UpdateScene(dt, ImVec2(kDisplayWidth, kDisplayHeight));
+		}
+		double t1 = BenchNowMs();
+
+		int hits = 0;
+		for (int q = 0; q < kPickQueries; ++q)
+		{
+			hits += PickObject(BenchRandomFloat(0.0f, kDisplayWidth), BenchRandomFloat(0.0f, kDisplayHeight)) >= 0;
+		}
+		pickSink = pickSink + hits;
+		double t2 = BenchNowMs();
+
+		// One marquee update: a region query plus the merge with the selection.
+		// The result goes to a scratch set so scene geometry stays comparable.
+		{
+			float mx = BenchRandomFloat(0.0f, kDisplayWidth), my = BenchRandomFloat(0.0f, kDisplayHeight);
+			uint64_t* mask = (uint64_t*)FrameAlloc(HitMaskWords(count) * sizeof(uint64_t));
+			QuerySceneRect(mx, my, mx + BenchRandomFloat(10.0f, 400.0f), my + BenchRandomFloat(10.0f, 300.0f), HitRectMode_Overlap, mask);
+			SelectionCombine(marquee, selection, mask, SelectionOp_Add);
+			pickSink = pickSink + marquee.count;
+		}
+		double t2m = BenchNowMs();
+
+		ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
+		ImGui::SetNextWindowSize(ImVec2(kDisplayWidth, kDisplayHeight));
+		DrawSceneView();
+		double t3 = BenchNowMs();
+		result.tilesRedrawn += LayerCacheGetStats().rasterized;
+
+		ImGui::Render();
+		double t4 = BenchNowMs();
+
+		result.submit = BenchNullSubmit(ImGui::GetDrawData());
+		result.view = GetSceneViewStats();
+		double t5 = BenchNowMs();
+
+		samples[Stage_Simulation].push_back(t1 - t0);
+		samples[Stage_Picking].push_back(t2 - t1);
+		samples[Stage_Marquee].push_back(t2m - t2);
+		samples[Stage_SceneGeometry].push_back(t3 - t2m);
+		samples[Stage_Render].push_back(t4 - t3);
+		samples[Stage_Submit].push_back(t5 - t4);
+		frameTimes.push_back(t5 - frameStart);
+	}
+
+	for (int s = 0; s < Stage_Count; ++s)
+	{
+		result.stages[s] = BenchSummarize(samples[s]);
+	}
+	result.frameMeanMs = BenchSummarize(frameTimes).meanMs;
+	result.fallbackFrames = LayerCacheGetStats().fallbackFrames - fallbackStart;
+	FrameArenaStats arena = FrameArenaGetStats();
+	result.arenaOverflows = frames > kArenaWarmupFrames ? arena.overflows - overflowStart : 0;
+	result.arenaBytes = arena.capacity;
+	return result;
+}
+
+static void WriteResults(FILE* f, const std::vector<SceneResult>& results, int frames, float dt, float zoom, bool edit, uint32_t seed)
+{
+	fprintf(f, "{\n");
+	fprintf(f, "  \"benchmark\": \"scene\",\n");
+	BenchWriteHardwareJson(f, "  ");
+	fprintf(f, ",\n");
+	fprintf(f, "  \"config\": { \"frames\": %d, \"delta_time\": %.6f, \"zoom\": %.4f, \"mode\": \"%s\", \"seed\": %u, \"display\": [%.0f, %.0f], \"pick_queries\": %d, \"sprite_images\": %d, \"atlas_pages\": %d },\n",
+		frames, dt, zoom, edit ? "edit" : "play", seed, kDisplayWidth, kDisplayHeight, kPickQueries, spriteImages, atlasPages);
+	fprintf(f, "  \"scenes\": [\n");
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const SceneResult& r = results[i];
+		fprintf(f, "    {\n");
+		fprintf(f, "      \"objects\": %d,\n", r.objects);
+		fprintf(f, "      \"vertices\": %d,\n", r.submit.vertices);
+		fprintf(f, "      \"indices\": %d,\n", r.submit.indices);
+		fprintf(f, "      \"draw_calls\": %d,\n", r.submit.drawCalls);
+		fprintf(f, "      \"objects_drawn\": %d,\n", r.view.drawn);
+		fprintf(f, "      \"objects_aggregated\": %d,\n", r.view.aggregated);
+		fprintf(f, "      \"lod_quads\": %d,\n", r.view.lodQuads);
+		fprintf(f, "      \"layer_tiles_redrawn\": %d,\n", r.tilesRedrawn);
+		fprintf(f, "      \"layer_fallback_frames\": %d,\n", r.fallbackFrames);
+		fprintf(f, "      \"arena_kb\": %.0f,\n", r.arenaBytes / 1024.0);
+		fprintf(f, "      \"arena_overflows\": %u,\n", r.arenaOverflows);
+		fprintf(f, "      \"frame_mean_ms\": %.4f,\n", r.frameMeanMs);
+		fprintf(f, "      \"stages\": {\n");
+		for (int s = 0; s < Stage_Count; ++s)
+		{
+			BenchWriteStageJson(f, kStageNames[s], r.stages[s], s == Stage_Count - 1);
+		}
+		fprintf(f, "      }\n");
+		fprintf(f, "    }%s\n", i + 1 < results.size() ? "," : "");
+	}
+	fprintf(f, "  ]\n");
+	fprintf(f, "}\n");
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<int> counts = { 10000, 100000, 1000000 };
+	int frames = 120;
+	float dt = 1.0f / 60.0f;
+	float zoom = 1.0f;
+	bool edit = false;
+	uint32_t seed = 1;
+	const char* outPath = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+		{
+			counts.clear();
+			for (const char* p = argv[++i]; *p; )
+			{
+				counts.push_back(atoi(p));
+				while (*p && *p != ',') ++p;
+				if (*p == ',') ++p;
+			}
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+		{
+			frames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--dt") == 0 && i + 1 < argc)
+		{
+			dt = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--zoom") == 0 && i + 1 < argc)
+		{
+			zoom = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--edit") == 0)
+		{
+			edit = true;
+		}
+		else if (strcmp(argv[i], "--sprites") == 0 && i + 1 < argc)
+		{
+			spriteImages = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+		{
+			outPath = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--objects N,N,...] [--frames N] [--dt S] [--zoom Z] [--edit] [--sprites N] [--seed N] [--out file.json]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (frames <= 0 || counts.empty() || zoom <= 0.0f)
+	{
+		fprintf(stderr, "nothing to run\n");
+		return 1;
+	}
+	BenchSeedRandom(seed);
+
+	BenchInitImGui(kDisplayWidth, kDisplayHeight);
+	FrameArenaInit(kFrameArenaBytes);
+	LayerCacheSetBackend(LayerCacheCpuBackend());
+	BuildSpriteImages(spriteImages);
+	std::vector<SceneResult> results;
+	for (int count : counts)
+	{
+		fprintf(stderr, "scene: %d objects x %d frames\n", count, frames);
+		results.push_back(RunScene(count, frames, dt, zoom, edit));
+	}
+	LayerCacheShutdown();
+	FrameArenaShutdown();
+	atlasPages = AtlasPageCount();
+	AtlasShutdown();
+	BenchShutdownImGui();
+
+	FILE* f = outPath ? fopen(outPath, "w") : stdout;
+	if (!f)
+	{
+		fprintf(stderr, "failed to open %s\n", outPath);
+		return 1;
+	}
+	WriteResults(f, results, frames, dt, zoom, edit, seed);
+	if (f != stdout)
+	{
+		fclose(f);
+	}
+	int failures = 0;
+	for (const SceneResult& r : results)
+	{
+		if (r.arenaOverflows > 0)
+		{
+			fprintf(stderr, "%d objects: %u frame arena overflows after warmup\n", r.objects, r.arenaOverflows);
+			++failures;
+		}
+	}
+	return failures > 0 ? 2 : 0;
+}
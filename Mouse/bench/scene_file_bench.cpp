@@ -0,0 +1,222 @@
+// Scene file benchmark. Saves random scenes, then times opening the file
+// (mapping plus header checks), a rect query run directly on the mapped
+// bounds, and loading into the editable object list. The same scene then
+// goes through the text format. The query must match the same query on
+// columns built in memory, and the loaded objects must match the saved ones
+// in both formats, and a header whose column table runs past the end of the
+// file must be refused; any difference makes the process exit with 2.
+//
+//   scene_file_bench [--objects 100000,1000000,10000000] [--path bench.mscn] [--out results.json]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+#include "hit_test.h"
+#include "scene.h"
+#include "scene_file.h"
+#include "scene_text.h"
+#include "bench_util.h"
+
+static double FileSizeMb(const char* path)
+{
+	FILE* f = fopen(path, "rb");
+	if (!f)
+	{
+		return 0.0;
+	}
+	fseek(f, 0, SEEK_END);
+	double mb = ftell(f) / (1024.0 * 1024.0);
+	fclose(f);
+	return mb;
+}
+
+// Overwrites the header size and column count (bytes 8 to 15 in version 1)
+// so the column table reaches past the end of the file.
+static bool RejectsOversizedHeader(const char* path)
+{
+	FILE* f = fopen(path, "r+b");
+	if (!f)
+	{
+		return false;
+	}
+	uint32_t fields[2] = { 0xFFFFFFF0u, 64 };
+	bool ok = fseek(f, 8, SEEK_SET) == 0 && fwrite(fields, 1, sizeof(fields), f) == sizeof(fields);
+	ok = fclose(f) == 0 && ok;
+	SceneFileView view;
+	const char* error = nullptr;
+	return ok && !SceneFileOpen(path, view, &error) && error;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<int> counts = { 100000, 1000000, 10000000 };
+	const char* path = "scene_file_bench.mscn";
+	uint32_t seed = 1;
+	const char* outPath = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+		{
+			counts.clear();
+			for (const char* p = argv[++i]; *p; )
+			{
+				counts.push_back(atoi(p));
+				while (*p && *p != ',') ++p;
+				if (*p == ',') ++p;
+			}
+		}
+		else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc)
+		{
+			path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+		{
+			outPath = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--objects N,N,...] [--path file.mscn] [--seed N] [--out file.json]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (counts.empty())
+	{
+		fprintf(stderr, "nothing to run\n");
+		return 1;
+	}
+	BenchSeedRandom(seed);
+	char textPath[1024];
+	snprintf(textPath, sizeof(textPath), "%s.mtxt", path);
+
+	FILE* f = outPath ? fopen(outPath, "w") : stdout;
+	if (!f)
+	{
+		fprintf(stderr, "failed to open %s\n", outPath);
+		return 1;
+	}
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"benchmark\": \"scene_file\",\n");
+	BenchWriteHardwareJson(f, "  ");
+	fprintf(f, ",\n");
+	fprintf(f, "  \"config\": { \"seed\": %u, \"version\": %u },\n", seed, kSceneFileVersion);
+	fprintf(f, "  \"scenes\": [\n");
+
+	int failures = 0;
+	std::vector<Rect> scene;
+	HitColumns cols;
+	for (size_t s = 0; s < counts.size(); ++s)
+	{
+		int count = counts[s];
+		fprintf(stderr, "scene_file: %d objects\n", count);
+		BenchBuildScene(scene, count);
+		const char* error = nullptr;
+
+		double t0 = BenchNowMs();
+		bool ok = SceneFileSave(path, scene, &error);
+		double saveMs = BenchNowMs() - t0;
+
+		SceneFileView view;
+		t0 = BenchNowMs();
+		ok = ok && SceneFileOpen(path, view, &error);
+		double openMs = BenchNowMs() - t0;
+		if (!ok)
+		{
+			fprintf(stderr, "%d objects: %s\n", count, error);
+			++failures;
+			continue;
+		}
+		double fileMb = view.size / (1024.0 * 1024.0);
+
+		// The first query on the mapping also pays for faulting the bounds in.
+		HitColumnsResize(cols, count);
+		for (int i = 0; i < count; ++i)
+		{
+			const Rect& R = scene[i];
+			HitColumnsSet(cols, i, R.x, R.y, R.x + R.w, R.y + R.h);
+		}
+		std::vector<uint64_t> mask(HitMaskWords(count) + 1), expected(HitMaskWords(count) + 1);
+		t0 = BenchNowMs();
+		HitTestRectMask(view.bounds, 500.0f, 300.0f, 900.0f, 600.0f, HitRectMode_Overlap, mask.data());
+		int hits = HitMaskPopCount(mask.data(), count);
+		double queryMs = BenchNowMs() - t0;
+		HitTestRectMask(cols, 500.0f, 300.0f, 900.0f, 600.0f, HitRectMode_Overlap, expected.data());
+		bool queryMatch = memcmp(mask.data(), expected.data(), HitMaskWords(count) * sizeof(uint64_t)) == 0;
+		SceneFileClose(view);
+
+		t0 = BenchNowMs();
+		ok = SceneFileLoad(path, &error);
+		double loadMs = BenchNowMs() - t0;
+		bool loadMatch = ok && BenchSameObjects(scene, objects);
+		bool rejected = RejectsOversizedHeader(path);
+		failures += !queryMatch + !loadMatch + !rejected;
+		if (!queryMatch)
+		{
+			fprintf(stderr, "%d objects: mapped query differs from in-memory columns\n", count);
+		}
+		if (!loadMatch)
+		{
+			fprintf(stderr, "%d objects: loaded objects differ from saved ones\n", count);
+		}
+		if (!rejected)
+		{
+			fprintf(stderr, "%d objects: header with an oversized column table was accepted\n", count);
+		}
+
+		std::vector<Rect> parsed;
+		t0 = BenchNowMs();
+		bool textOk = SceneTextSave(textPath, scene, &error);
+		double textSaveMs = BenchNowMs() - t0;
+		double textMb = FileSizeMb(textPath);
+		t0 = BenchNowMs();
+		textOk = textOk && SceneTextRead(textPath, parsed, &error);
+		double textLoadMs = BenchNowMs() - t0;
+		bool textMatch = textOk && BenchSameObjects(scene, parsed);
+		failures += !textMatch;
+		if (!textOk)
+		{
+			fprintf(stderr, "%d objects: text: %s\n", count, error);
+		}
+		else if (!textMatch)
+		{
+			fprintf(stderr, "%d objects: text objects differ from saved ones\n", count);
+		}
+
+		fprintf(f, "    {\n");
+		fprintf(f, "      \"objects\": %d,\n", count);
+		fprintf(f, "      \"file_mb\": %.2f,\n", fileMb);
+		fprintf(f, "      \"save_ms\": %.3f,\n", saveMs);
+		fprintf(f, "      \"save_mb_per_s\": %.1f,\n", saveMs > 0.0 ? fileMb * 1000.0 / saveMs : 0.0);
+		fprintf(f, "      \"open_ms\": %.4f,\n", openMs);
+		fprintf(f, "      \"mapped_query_ms\": %.3f,\n", queryMs);
+		fprintf(f, "      \"mapped_query_hits\": %d,\n", hits);
+		fprintf(f, "      \"load_ms\": %.3f,\n", loadMs);
+		fprintf(f, "      \"round_trip\": %s,\n", queryMatch && loadMatch ? "true" : "false");
+		fprintf(f, "      \"rejects_bad_header\": %s,\n", rejected ? "true" : "false");
+		fprintf(f, "      \"text_mb\": %.2f,\n", textMb);
+		fprintf(f, "      \"text_save_ms\": %.3f,\n", textSaveMs);
+		fprintf(f, "      \"text_load_ms\": %.3f,\n", textLoadMs);
+		fprintf(f, "      \"text_load_mb_per_s\": %.1f,\n", textLoadMs > 0.0 ? textMb * 1000.0 / textLoadMs : 0.0);
+		fprintf(f, "      \"text_round_trip\": %s\n", textMatch ? "true" : "false");
+		fprintf(f, "    }%s\n", s + 1 < counts.size() ? "," : "");
+	}
+	HitColumnsFree(cols);
+	remove(path);
+	remove(textPath);
+
+	fprintf(f, "  ]\n");
+	fprintf(f, "}\n");
+	if (f != stdout)
+	{
+		fclose(f);
+	}
+	return failures > 0 ? 2 : 0;
+}
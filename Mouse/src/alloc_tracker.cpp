@@ -0,0 +1,294 @@
+#include "alloc_tracker.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+#include "imgui.h"
+
+// Every tracked block carries its size in a 16-byte header so frees can be
+// subtracted from the live total and user pointers stay 16-byte aligned.
+static const size_t kHeaderSize = 16;
+
+struct TagSlot {
+	std::atomic<const char*> name;
+	std::atomic<unsigned int> count;
+	std::atomic<size_t> bytes;
+};
+
+static TagSlot tagSlots[kMaxAllocTags];
+static std::atomic<unsigned int> frameCount{ 0 };
+static std::atomic<size_t> frameBytes{ 0 };
+static std::atomic<size_t> liveBytes{ 0 };
+static std::atomic<size_t> peakLiveBytes{ 0 };
+static thread_local const char* currentTag = nullptr;
+
+static AllocFrameStats lastFrame;
+static int frameIndex = 0;
+static int steadyStateWarmup = -1;
+static unsigned int violations = 0;
+
+static const char* const kUntagged = "untagged";
+static const char* const kImGuiTag = "ImGui";
+
+static TagSlot* FindTag(const char* tag)
+{
+	for (TagSlot& slot : tagSlots)
+	{
+		const char* name = slot.name.load(std::memory_order_acquire);
+		if (name == tag)
+		{
+			return &slot;
+		}
+		if (!name)
+		{
+			const char* expected = nullptr;
+			if (slot.name.compare_exchange_strong(expected, tag) || expected == tag)
+			{
+				return &slot;
+			}
+		}
+	}
+	return nullptr;
+}
+
+static void Track(size_t size, const char* tag)
+{
+	frameCount.fetch_add(1, std::memory_order_relaxed);
+	frameBytes.fetch_add(size, std::memory_order_relaxed);
+	size_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+	size_t peak = peakLiveBytes.load(std::memory_order_relaxed);
+	while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+	{
+	}
+	if (TagSlot* slot = FindTag(tag ? tag : kUntagged))
+	{
+		slot->count.fetch_add(1, std::memory_order_relaxed);
+		slot->bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+}
+
+static void* MallocBacking(size_t size, void*)
+{
+	return malloc(size);
+}
+
+static void FreeBacking(void* ptr, void*)
+{
+	free(ptr);
+}
+
+static void* (*imguiBackingAlloc)(size_t, void*) = MallocBacking;
+static void (*imguiBackingFree)(void*, void*) = FreeBacking;
+static size_t (*imguiBackingSize)(void*) = nullptr;
+
+static void* TrackedAlloc(size_t size, const char* tag, void* (*backingAlloc)(size_t, void*) = MallocBacking)
+{
+	char* block = (char*)backingAlloc(size + kHeaderSize, nullptr);
+	if (!block)
+	{
+		return nullptr;
+	}
+	*(size_t*)block = size;
+	Track(size, tag);
+	return block + kHeaderSize;
+}
+
+static void TrackedFree(void* ptr, void (*backingFree)(void*, void*) = FreeBacking)
+{
+	if (!ptr)
+	{
+		return;
+	}
+	char* block = (char*)ptr - kHeaderSize;
+	liveBytes.fetch_sub(*(size_t*)block, std::memory_order_relaxed);
+	backingFree(block, nullptr);
+}
+
+AllocTagScope::AllocTagScope(const char* tag) : prev(currentTag)
+{
+	currentTag = tag;
+}
+
+AllocTagScope::~AllocTagScope()
+{
+	currentTag = prev;
+}
+
+// A backing allocator that records block sizes already carries a header, so
+// the tracker skips its own.
+static void* ImGuiTrackedAlloc(size_t size, void*)
+{
+	if (!imguiBackingSize)
+	{
+		return TrackedAlloc(size, kImGuiTag, imguiBackingAlloc);
+	}
+	void* block = imguiBackingAlloc(size, nullptr);
+	if (block)
+	{
+		Track(size, kImGuiTag);
+	}
+	return block;
+}
+
+static void ImGuiTrackedFree(void* ptr, void*)
+{
+	if (!imguiBackingSize)
+	{
+		TrackedFree(ptr, imguiBackingFree);
+		return;
+	}
+	if (ptr)
+	{
+		liveBytes.fetch_sub(imguiBackingSize(ptr), std::memory_order_relaxed);
+		imguiBackingFree(ptr, nullptr);
+	}
+}
+
+void AllocTrackerInstallImGuiHooks(void* (*backingAlloc)(size_t, void*), void (*backingFree)(void*, void*), size_t (*backingSize)(void*))
+{
+	imguiBackingAlloc = backingAlloc ? backingAlloc : MallocBacking;
+	imguiBackingFree = backingFree ? backingFree : FreeBacking;
+	imguiBackingSize = backingAlloc ? backingSize : nullptr;
+	ImGui::SetAllocatorFunctions(ImGuiTrackedAlloc, ImGuiTrackedFree);
+}
+
+void AllocTrackerBeginFrame()
+{
+	frameCount.store(0, std::memory_order_relaxed);
+	frameBytes.store(0, std::memory_order_relaxed);
+	peakLiveBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	for (TagSlot& slot : tagSlots)
+	{
+		slot.count.store(0, std::memory_order_relaxed);
+		slot.bytes.store(0, std::memory_order_relaxed);
+	}
+}
+
+void AllocTrackerEndFrame()
+{
+	lastFrame.count = frameCount.load(std::memory_order_relaxed);
+	lastFrame.bytes = frameBytes.load(std::memory_order_relaxed);
+	lastFrame.peakLiveBytes = peakLiveBytes.load(std::memory_order_relaxed);
+	lastFrame.liveBytes = liveBytes.load(std::memory_order_relaxed);
+	lastFrame.tagCount = 0;
+	for (TagSlot& slot : tagSlots)
+	{
+		const char* name = slot.name.load(std::memory_order_acquire);
+		unsigned int count = slot.count.load(std::memory_order_relaxed);
+		if (name && count > 0)
+		{
+			AllocTagStats& t = lastFrame.tags[lastFrame.tagCount++];
+			t.name = name;
+			t.count = count;
+			t.bytes = slot.bytes.load(std::memory_order_relaxed);
+		}
+	}
+	std::sort(lastFrame.tags, lastFrame.tags + lastFrame.tagCount, [](const AllocTagStats& a, const AllocTagStats& b) {
+		return a.bytes > b.bytes;
+	});
+
+	if (steadyStateWarmup >= 0 && frameIndex >= steadyStateWarmup && lastFrame.count > 0)
+	{
+		++violations;
+		fprintf(stderr, "[alloc] frame %d allocated %u times (%zu bytes), top tag: %s\n",
+			frameIndex, lastFrame.count, lastFrame.bytes, lastFrame.tagCount > 0 ? lastFrame.tags[0].name : kUntagged);
+	}
+	++frameIndex;
+}
+
+const AllocFrameStats& AllocTrackerGetLastFrame()
+{
+	return lastFrame;
+}
+
+void AllocTrackerEnableSteadyStateCheck(int warmupFrames)
+{
+	steadyStateWarmup = warmupFrames;
+}
+
+unsigned int AllocTrackerGetViolations()
+{
+	return violations;
+}
+
+void DrawAllocTrackerUI()
+{
+	if (!ImGui::CollapsingHeader("Allocations"))
+	{
+		return;
+	}
+#if MOUSE_ALLOC_TRACKER
+	const AllocFrameStats& s = lastFrame;
+	ImGui::Text("Per frame: %u allocs, %.1f KB", s.count, s.bytes / 1024.0);
+	ImGui::Text("Live: %.1f KB (frame peak %.1f KB)", s.liveBytes / 1024.0, s.peakLiveBytes / 1024.0);
+	if (steadyStateWarmup >= 0)
+	{
+		ImGui::Text("Steady-state violations: %u", violations);
+	}
+
+	if (s.tagCount > 0 && ImGui::BeginTable("AllocTags", 3, ImGuiTableFlags_BordersV | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Tag", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_WidthFixed, 50.0f);
+		ImGui::TableSetupColumn("Bytes", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+		ImGui::TableHeadersRow();
+		for (int i = 0; i < s.tagCount && i < 8; ++i)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(s.tags[i].name);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", s.tags[i].count);
+			ImGui::TableNextColumn();
+			ImGui::Text("%zu", s.tags[i].bytes);
+		}
+		ImGui::EndTable();
+	}
+#else
+	ImGui::TextDisabled("Allocation tracking disabled (MOUSE_ALLOC_TRACKER=0)");
+#endif
+}
+
+#if MOUSE_ALLOC_TRACKER
+
+void* operator new(size_t size)
+{
+	void* p = TrackedAlloc(size, currentTag);
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	void* p = TrackedAlloc(size, currentTag);
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return TrackedAlloc(size, currentTag);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return TrackedAlloc(size, currentTag);
+}
+
+void operator delete(void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+
+// Set MOUSE_ALLOC_TRACKER to 0 to keep the default global operator new/delete.
+#ifndef MOUSE_ALLOC_TRACKER
+#define MOUSE_ALLOC_TRACKER 1
+#endif
+
+static const int kMaxAllocTags = 64;
+
+struct AllocTagStats {
+	const char* name;
+	unsigned int count;
+	size_t bytes;
+};
+
+struct AllocFrameStats {
+	unsigned int count;
+	size_t bytes;
+	size_t peakLiveBytes;
+	size_t liveBytes;
+	int tagCount;
+	AllocTagStats tags[kMaxAllocTags]; // sorted by bytes, largest first
+};
+
+// Routes ImGui's IM_ALLOC/IM_FREE through the tracker, which takes its memory
+// from the backing functions (malloc/free by default). If backingSize reports
+// the size a block was allocated with, the tracker adds no header of its own.
+// Call before ImGui::CreateContext.
+void AllocTrackerInstallImGuiHooks(void* (*backingAlloc)(size_t, void*) = nullptr, void (*backingFree)(void*, void*) = nullptr, size_t (*backingSize)(void*) = nullptr);
+
+void AllocTrackerBeginFrame();
+void AllocTrackerEndFrame();
+const AllocFrameStats& AllocTrackerGetLastFrame();
+
+// After warmupFrames, every frame that allocates counts as a violation.
+void AllocTrackerEnableSteadyStateCheck(int warmupFrames);
+unsigned int AllocTrackerGetViolations();
+
+void DrawAllocTrackerUI();
+
+// Attributes allocations on this thread to a tag until the scope ends.
+struct AllocTagScope {
+	const char* prev;
+	explicit AllocTagScope(const char* tag);
+	~AllocTagScope();
+};
+
+#if MOUSE_ALLOC_TRACKER
+#define ALLOC_TAG_CONCAT_INNER(a, b) a##b
+#define ALLOC_TAG_CONCAT(a, b) ALLOC_TAG_CONCAT_INNER(a, b)
+#define ALLOC_TAG(name) AllocTagScope ALLOC_TAG_CONCAT(allocTag, __LINE__)(name)
+#else
+#define ALLOC_TAG(name) ((void)0)
+#endif
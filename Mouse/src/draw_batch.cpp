@@ -0,0 +1,193 @@
+#include "draw_batch.h"
+
+#include <cstddef>
+
+#include "imgui_internal.h"
+
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(IMGUI_OVERRIDE_DRAWVERT_STRUCT_LAYOUT)
+#define MOUSE_DRAW_BATCH_SSE2 1
+#include <emmintrin.h>
+#else
+#define MOUSE_DRAW_BATCH_SSE2 0
+#endif
+
+// 4 vertices per rect keeps each chunk inside one 16-bit index range;
+// PrimReserve starts a new VtxOffset between chunks when needed.
+static const int kChunkRects = 8192;
+
+#if MOUSE_DRAW_BATCH_SSE2
+
+static_assert(sizeof(ImDrawVert) == 20 && offsetof(ImDrawVert, uv) == 8 && offsetof(ImDrawVert, col) == 16,
+	"SSE2 path writes the default ImDrawVert layout");
+
+// Each rect is 4 vertices = 20 dwords = 5 unaligned stores:
+// [x0 y0 u v] [c x1 y0 u] [v c x1 y1] [u v c x0] [y1 u v c]
+// Culled rects are still stored but the write pointer does not advance past them.
+static int WriteRectVertices(ImDrawVert* out, const ImVec2* mins, const ImVec2* maxs, const ImU32* colors, int count, const ImVec4& clip, const ImVec2& uv)
+{
+	float* dst = (float*)out;
+	const __m128 clipEdges = _mm_setr_ps(clip.x, clip.y, -clip.z, -clip.w);
+	const __m128 negateMin = _mm_castsi128_ps(_mm_setr_epi32(0, 0, (int)0x80000000, (int)0x80000000));
+	const __m128 uvuv = _mm_setr_ps(uv.x, uv.y, uv.x, uv.y);
+	int written = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		__m128 a = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)&mins[i]);
+		a = _mm_loadh_pi(a, (const __m64*)&maxs[i]);                                  // x0 y0 x1 y1
+		__m128 c = _mm_castsi128_ps(_mm_set1_epi32((int)colors[i]));
+		__m128 uvc = _mm_shuffle_ps(uvuv, c, _MM_SHUFFLE(0, 0, 1, 0));                 // u v c c
+
+		// Visible when x1 > clip.x, y1 > clip.y, x0 < clip.z and y0 < clip.w.
+		__m128 edges = _mm_xor_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)), negateMin);
+		int visible = _mm_movemask_ps(_mm_cmpgt_ps(edges, clipEdges)) == 0xF;
+
+		__m128 s0 = _mm_shuffle_ps(a, uvc, _MM_SHUFFLE(1, 0, 1, 0));
+		__m128 t1 = _mm_shuffle_ps(uvc, a, _MM_SHUFFLE(1, 2, 2, 2));                   // c c x1 y0
+		__m128 t2 = _mm_shuffle_ps(a, uvc, _MM_SHUFFLE(0, 0, 1, 1));                   // y0 y0 u u
+		__m128 s1 = _mm_shuffle_ps(t1, t2, _MM_SHUFFLE(2, 1, 2, 0));
+		__m128 s2 = _mm_shuffle_ps(uvc, a, _MM_SHUFFLE(3, 2, 2, 1));
+		__m128 t3 = _mm_shuffle_ps(uvc, a, _MM_SHUFFLE(0, 0, 2, 2));                   // c c x0 x0
+		__m128 s3 = _mm_shuffle_ps(uvc, t3, _MM_SHUFFLE(2, 0, 1, 0));
+		__m128 t4 = _mm_shuffle_ps(a, uvc, _MM_SHUFFLE(0, 0, 3, 3));                   // y1 y1 u u
+		__m128 s4 = _mm_shuffle_ps(t4, uvc, _MM_SHUFFLE(2, 1, 2, 0));
+		_mm_storeu_ps(dst, s0);
+		_mm_storeu_ps(dst + 4, s1);
+		_mm_storeu_ps(dst + 8, s2);
+		_mm_storeu_ps(dst + 12, s3);
+		_mm_storeu_ps(dst + 16, s4);
+		dst += visible * 20;
+		written += visible;
+	}
+	return written;
+}
+
+static void WriteRectIndices(ImDrawIdx* out, unsigned int first, int count)
+{
+	int i = 0;
+	if (sizeof(ImDrawIdx) == 2)
+	{
+		// 4 rects = 24 indices = 3 stores of a fixed pattern plus the base vertex.
+		const __m128i p0 = _mm_setr_epi16(0, 1, 2, 0, 2, 3, 4, 5);
+		const __m128i p1 = _mm_setr_epi16(6, 4, 6, 7, 8, 9, 10, 8);
+		const __m128i p2 = _mm_setr_epi16(10, 11, 12, 13, 14, 12, 14, 15);
+		const __m128i step = _mm_set1_epi16(16);
+		__m128i base = _mm_set1_epi16((short)first);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i* dst = (__m128i*)(out + i * 6);
+			_mm_storeu_si128(dst, _mm_add_epi16(base, p0));
+			_mm_storeu_si128(dst + 1, _mm_add_epi16(base, p1));
+			_mm_storeu_si128(dst + 2, _mm_add_epi16(base, p2));
+			base = _mm_add_epi16(base, step);
+		}
+	}
+	for (; i < count; ++i)
+	{
+		ImDrawIdx idx = (ImDrawIdx)(first + i * 4);
+		ImDrawIdx* dst = out + i * 6;
+		dst[0] = idx; dst[1] = (ImDrawIdx)(idx + 1); dst[2] = (ImDrawIdx)(idx + 2);
+		dst[3] = idx; dst[4] = (ImDrawIdx)(idx + 2); dst[5] = (ImDrawIdx)(idx + 3);
+	}
+}
+
+#else
+
+static int WriteRectVertices(ImDrawVert* out, const ImVec2* mins, const ImVec2* maxs, const ImU32* colors, int count, const ImVec4& clip, const ImVec2& uv)
+{
+	ImDrawVert* dst = out;
+	for (int i = 0; i < count; ++i)
+	{
+		const ImVec2 a = mins[i], c = maxs[i];
+		if (!(c.x > clip.x && c.y > clip.y && a.x < clip.z && a.y < clip.w))
+		{
+			continue;
+		}
+		ImU32 col = colors[i];
+		dst[0].pos = a;                dst[0].uv = uv; dst[0].col = col;
+		dst[1].pos = ImVec2(c.x, a.y); dst[1].uv = uv; dst[1].col = col;
+		dst[2].pos = c;                dst[2].uv = uv; dst[2].col = col;
+		dst[3].pos = ImVec2(a.x, c.y); dst[3].uv = uv; dst[3].col = col;
+		dst += 4;
+	}
+	return (int)(dst - out) / 4;
+}
+
+static void WriteRectIndices(ImDrawIdx* out, unsigned int first, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		ImDrawIdx idx = (ImDrawIdx)(first + i * 4);
+		ImDrawIdx* dst = out + i * 6;
+		dst[0] = idx; dst[1] = (ImDrawIdx)(idx + 1); dst[2] = (ImDrawIdx)(idx + 2);
+		dst[3] = idx; dst[4] = (ImDrawIdx)(idx + 2); dst[5] = (ImDrawIdx)(idx + 3);
+	}
+}
+
+#endif
+
+void AddRectFilledBatch(ImDrawList* draw, const ImVec2* mins, const ImVec2* maxs, const ImU32* colors, int count)
+{
+	const ImVec4 clip = draw->_CmdHeader.ClipRect;
+	const ImVec2 uv = draw->_Data->TexUvWhitePixel;
+	for (int start = 0; start < count; start += kChunkRects)
+	{
+		int n = count - start < kChunkRects ? count - start : kChunkRects;
+		draw->PrimReserve(n * 6, n * 4);
+		int written = WriteRectVertices(draw->_VtxWritePtr, mins + start, maxs + start, colors + start, n, clip, uv);
+		WriteRectIndices(draw->_IdxWritePtr, draw->_VtxCurrentIdx, written);
+		draw->_VtxWritePtr += written * 4;
+		draw->_IdxWritePtr += written * 6;
+		draw->_VtxCurrentIdx += written * 4;
+		draw->PrimUnreserve((n - written) * 6, (n - written) * 4);
+	}
+}
+
+// Same chunking as AddRectFilledBatch with per-rect UVs. Rare enough next to
+// solid rects that the scalar writer is fine.
+void AddImageBatch(ImDrawList* draw, const ImVec2* mins, const ImVec2* maxs, const ImVec2* uvMins, const ImVec2* uvMaxs, const ImU32* colors, int count)
+{
+	const ImVec4 clip = draw->_CmdHeader.ClipRect;
+	for (int start = 0; start < count; start += kChunkRects)
+	{
+		int n = count - start < kChunkRects ? count - start : kChunkRects;
+		draw->PrimReserve(n * 6, n * 4);
+		ImDrawVert* dst = draw->_VtxWritePtr;
+		for (int i = start; i < start + n; ++i)
+		{
+			const ImVec2 a = mins[i], c = maxs[i];
+			if (!(c.x > clip.x && c.y > clip.y && a.x < clip.z && a.y < clip.w))
+			{
+				continue;
+			}
+			const ImVec2 ua = uvMins[i], uc = uvMaxs[i];
+			ImU32 col = colors[i];
+			dst[0].pos = a;                dst[0].uv = ua;                 dst[0].col = col;
+			dst[1].pos = ImVec2(c.x, a.y); dst[1].uv = ImVec2(uc.x, ua.y); dst[1].col = col;
+			dst[2].pos = c;                dst[2].uv = uc;                 dst[2].col = col;
+			dst[3].pos = ImVec2(a.x, c.y); dst[3].uv = ImVec2(ua.x, uc.y); dst[3].col = col;
+			dst += 4;
+		}
+		int written = (int)(dst - draw->_VtxWritePtr) / 4;
+		WriteRectIndices(draw->_IdxWritePtr, draw->_VtxCurrentIdx, written);
+		draw->_VtxWritePtr += written * 4;
+		draw->_IdxWritePtr += written * 6;
+		draw->_VtxCurrentIdx += written * 4;
+		draw->PrimUnreserve((n - written) * 6, (n - written) * 4);
+	}
+}
+
+ImU32 PackColorU32(const ImVec4& color, float styleAlpha)
+{
+#if MOUSE_DRAW_BATCH_SSE2 && !defined(IMGUI_USE_BGRA_PACKED_COLOR)
+	// Same rounding as IM_F32_TO_INT8_SAT: saturate, scale by 255, add 0.5, truncate.
+	__m128 v = _mm_mul_ps(_mm_loadu_ps(&color.x), _mm_setr_ps(1.0f, 1.0f, 1.0f, styleAlpha));
+	v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	v = _mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f));
+	__m128i i = _mm_cvttps_epi32(v);
+	i = _mm_packs_epi32(i, i);
+	i = _mm_packus_epi16(i, i);
+	return (ImU32)_mm_cvtsi128_si32(i);
+#else
+	return ImGui::ColorConvertFloat4ToU32(ImVec4(color.x, color.y, color.z, color.w * styleAlpha));
+#endif
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "imgui.h"
+
+// Bulk primitives for ImDrawList. One reservation covers a whole chunk of
+// rects, the vertices and indices are written with SSE2 and rects that fall
+// entirely outside the current clip rect are dropped on the way.
+
+// Filled axis-aligned rects from parallel spans of min/max corners and packed colors.
+// Equivalent to calling AddRectFilled(mins[i], maxs[i], colors[i]) for each i with no rounding.
+void AddRectFilledBatch(ImDrawList* draw, const ImVec2* mins, const ImVec2* maxs, const ImU32* colors, int count);
+
+// Textured rects: AddImage(texture, mins[i], maxs[i], uvMins[i], uvMaxs[i], colors[i])
+// for each i, in whatever texture is current on the draw list.
+void AddImageBatch(ImDrawList* draw, const ImVec2* mins, const ImVec2* maxs, const ImVec2* uvMins, const ImVec2* uvMaxs, const ImU32* colors, int count);
+
+// ImGui::GetColorU32(color) for a context-free caller: alpha is scaled by styleAlpha.
+ImU32 PackColorU32(const ImVec4& color, float styleAlpha);
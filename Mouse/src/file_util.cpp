@@ -0,0 +1,25 @@
+#include "file_util.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+bool Fail(const char** error, const char* message)
+{
+	*error = message;
+	return false;
+}
+
+bool FileReplace(const char* from, const char* to)
+{
+	// rename() refuses to replace an existing file on Windows.
+#ifdef _WIN32
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from, to) == 0;
+#endif
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// Helpers shared by the file formats and decoders.
+
+// Points error at a static message and returns false, so loaders can write
+// `return Fail(error, "...");`.
+bool Fail(const char** error, const char* message);
+
+// Renames from to to, replacing an existing file. Savers write a temporary
+// file and swap it in with this, so a crash leaves the old or the new file.
+bool FileReplace(const char* from, const char* to);
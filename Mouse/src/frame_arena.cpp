@@ -0,0 +1,166 @@
+#include "frame_arena.h"
+
+#include <cstdio>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+#include "imgui.h"
+
+struct OverflowBlock {
+	OverflowBlock* next;
+};
+
+static const size_t kArenaGrowStep = 64 * 1024;
+
+struct ArenaBuffer {
+	char* base = nullptr;
+	size_t size = 0;
+	size_t used = 0;
+	size_t overflowBytes = 0;
+	OverflowBlock* overflow = nullptr; // heap fallbacks, freed with the buffer
+};
+
+static ArenaBuffer buffers[2];
+static int current = 0;
+static size_t capacity = 0;
+static size_t lastFrameUsed = 0;
+static size_t highWater = 0;
+static unsigned int overflows = 0;
+
+static void ReleaseOverflow(ArenaBuffer& buf)
+{
+	while (buf.overflow)
+	{
+		OverflowBlock* next = buf.overflow->next;
+		free(buf.overflow);
+		buf.overflow = next;
+	}
+}
+
+void FrameArenaInit(size_t bytesPerFrame)
+{
+	FrameArenaShutdown();
+	capacity = bytesPerFrame;
+	for (ArenaBuffer& buf : buffers)
+	{
+		buf.base = (char*)malloc(capacity);
+		buf.size = buf.base ? capacity : 0;
+		buf.used = 0;
+	}
+}
+
+void FrameArenaShutdown()
+{
+	for (ArenaBuffer& buf : buffers)
+	{
+		ReleaseOverflow(buf);
+		free(buf.base);
+		buf.base = nullptr;
+		buf.size = 0;
+		buf.used = 0;
+	}
+	capacity = 0;
+}
+
+void FrameArenaReset()
+{
+	lastFrameUsed = buffers[current].used;
+	current ^= 1;
+	ArenaBuffer& buf = buffers[current];
+	ReleaseOverflow(buf);
+	buf.used = 0;
+	buf.overflowBytes = 0;
+
+	// Nothing in this buffer is live any more, so it can be replaced. A
+	// quarter of headroom keeps a slowly growing scene from regrowing it
+	// every few frames.
+	if (highWater > capacity)
+	{
+		capacity = (highWater + highWater / 4 + kArenaGrowStep - 1) / kArenaGrowStep * kArenaGrowStep;
+	}
+	if (buf.base && buf.size < capacity)
+	{
+		free(buf.base);
+		buf.base = (char*)malloc(capacity);
+		buf.size = buf.base ? capacity : 0;
+	}
+}
+
+void* FrameAlloc(size_t size, size_t align)
+{
+	ArenaBuffer& buf = buffers[current];
+	size_t offset = (buf.used + align - 1) & ~(align - 1);
+	if (buf.base && offset + size <= buf.size)
+	{
+		buf.used = offset + size;
+		highWater = std::max(highWater, buf.used + buf.overflowBytes);
+		return buf.base + offset;
+	}
+
+	// Over budget: hand out a heap block that lives as long as this buffer would.
+	// The high-water mark includes it, so it reads as the size the arena should have been.
+	++overflows;
+	buf.overflowBytes += size;
+	highWater = std::max(highWater, buf.used + buf.overflowBytes);
+	size_t header = (sizeof(OverflowBlock) + align - 1) & ~(align - 1);
+	char* block = (char*)malloc(header + size + align);
+	if (!block)
+	{
+		return nullptr;
+	}
+	OverflowBlock* node = (OverflowBlock*)block;
+	node->next = buf.overflow;
+	buf.overflow = node;
+	uintptr_t p = ((uintptr_t)block + header + align - 1) & ~(uintptr_t)(align - 1);
+	return (void*)p;
+}
+
+const char* FrameFormat(const char* fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	va_list copy;
+	va_copy(copy, args);
+	int len = vsnprintf(nullptr, 0, fmt, copy);
+	va_end(copy);
+	if (len < 0)
+	{
+		va_end(args);
+		return "";
+	}
+	char* text = (char*)FrameAlloc((size_t)len + 1, 1);
+	if (text)
+	{
+		vsnprintf(text, (size_t)len + 1, fmt, args);
+	}
+	va_end(args);
+	return text ? text : "";
+}
+
+FrameArenaStats FrameArenaGetStats()
+{
+	FrameArenaStats s;
+	s.capacity = capacity;
+	s.used = buffers[current].used;
+	s.lastFrameUsed = lastFrameUsed;
+	s.highWater = highWater;
+	s.overflows = overflows;
+	return s;
+}
+
+void DrawFrameArenaUI()
+{
+	if (!ImGui::CollapsingHeader("Frame Arena"))
+	{
+		return;
+	}
+	FrameArenaStats s = FrameArenaGetStats();
+	ImGui::Text("Last frame: %.1f / %.1f KB", s.lastFrameUsed / 1024.0, s.capacity / 1024.0);
+	ImGui::ProgressBar(s.capacity ? float(s.highWater) / float(s.capacity) : 0.0f, ImVec2(-1.0f, 0.0f), FrameFormat("High water %.1f KB", s.highWater / 1024.0));
+	if (s.overflows > 0)
+	{
+		ImGui::TextColored(ImVec4(1.0f, 0.35f, 0.35f, 1.0f), "Overflows: %u (arena grown to fit)", s.overflows);
+	}
+}
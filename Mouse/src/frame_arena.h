@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Double-buffered bump allocator for main-thread transient data. Memory from
+// frame N stays valid through frame N+1 and is recycled by the reset at the
+// top of frame N+2. Requests that do not fit fall back to the heap and are
+// counted as overflows; each buffer then grows past the high-water mark when
+// it is next recycled, so a larger scene costs a couple of heap frames rather
+// than one every frame.
+
+void FrameArenaInit(size_t bytesPerFrame);
+void FrameArenaShutdown();
+void FrameArenaReset(); // top of the frame loop
+
+void* FrameAlloc(size_t size, size_t align = 16);
+const char* FrameFormat(const char* fmt, ...);
+
+struct FrameArenaStats {
+	size_t capacity;      // grows with the high-water mark
+	size_t used;          // current frame
+	size_t lastFrameUsed;
+	size_t highWater;
+	unsigned int overflows;
+};
+
+FrameArenaStats FrameArenaGetStats();
+void DrawFrameArenaUI();
+
+template <typename T>
+struct FrameAllocator {
+	typedef T value_type;
+
+	FrameAllocator() = default;
+	template <typename U>
+	FrameAllocator(const FrameAllocator<U>&) {}
+
+	T* allocate(size_t n) { return (T*)FrameAlloc(n * sizeof(T), alignof(T) > 16 ? alignof(T) : 16); }
+	void deallocate(T*, size_t) {}
+
+	template <typename U>
+	bool operator==(const FrameAllocator<U>&) const { return true; }
+	template <typename U>
+	bool operator!=(const FrameAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+typedef std::basic_string<char, std::char_traits<char>, FrameAllocator<char>> ScratchString;
@@ -0,0 +1,293 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <GLFW/glfw3.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+#include "imgui.h"
+#include "profiler.h"
+#include "frame_arena.h"
+
+static const int kWorkHistory = 32;
+static const int kErrorHistory = 128;
+// Extra time left on top of the slowest recent frame when sampling input late.
+static const double kLateInputSafety = 0.0005;
+static const double kMinSleepMargin = 0.00025;
+static const double kMaxSleepMargin = 0.008;
+
+static GLFWwindow* window = nullptr;
+static double targetHz = 0.0;
+static double interval = 0.0;
+static bool vsync = true;
+static bool lateInput = false;
+// Settings change on the main thread; with the render thread running the
+// waits and the swap interval happen there.
+static std::mutex pacerMutex;
+static bool swapIntervalDirty = true;
+static bool resyncRequested = false;
+
+static double deadline = 0.0; // release time of the current frame, 0 when unsynced
+static double frameStart = 0.0;
+static std::atomic<double> sleepMargin{ 0.001 }; // updated by whichever thread waits
+static double workTimes[kWorkHistory];
+static int workHead = 0;
+static double errors[kErrorHistory];
+static int errorHead = 0;
+static int errorCount = 0;
+static unsigned long long missedDeadlines = 0;
+
+#ifdef _WIN32
+// Sleep() rounds up to the 15.6 ms system tick; a high resolution waitable
+// timer wakes within a fraction of a millisecond (Windows 10 1803+).
+static HANDLE sleepTimer = nullptr;
+
+static void SleepSeconds(double s)
+{
+	if (!sleepTimer)
+	{
+		Sleep((DWORD)(s * 1000.0));
+		return;
+	}
+	LARGE_INTEGER due;
+	due.QuadPart = -(LONGLONG)(s * 1e7); // relative, 100 ns units
+	SetWaitableTimer(sleepTimer, &due, 0, nullptr, nullptr, FALSE);
+	WaitForSingleObject(sleepTimer, INFINITE);
+}
+#else
+static void SleepSeconds(double s)
+{
+	std::this_thread::sleep_for(std::chrono::duration<double>(s));
+}
+#endif
+
+// Needs the GL context, so it runs from FramePacerEndFrame.
+static void ApplySwapInterval()
+{
+	if (window && swapIntervalDirty)
+	{
+		glfwSwapInterval(targetHz > 0.0 ? 0 : (vsync ? 1 : 0));
+		swapIntervalDirty = false;
+	}
+}
+
+void FramePacerInit(GLFWwindow* w)
+{
+	window = w;
+#ifdef _WIN32
+	sleepTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+}
+
+void FramePacerShutdown()
+{
+#ifdef _WIN32
+	if (sleepTimer)
+	{
+		CloseHandle(sleepTimer);
+		sleepTimer = nullptr;
+	}
+#endif
+	window = nullptr;
+}
+
+void FramePacerSetTargetHz(double hz)
+{
+	std::lock_guard<std::mutex> lock(pacerMutex);
+	targetHz = std::max(hz, 0.0);
+	interval = targetHz > 0.0 ? 1.0 / targetHz : 0.0;
+	resyncRequested = true;
+	errorCount = 0;
+	swapIntervalDirty = true;
+}
+
+void FramePacerSetVSync(bool v)
+{
+	std::lock_guard<std::mutex> lock(pacerMutex);
+	vsync = v;
+	swapIntervalDirty = true;
+}
+
+void FramePacerSetLateInput(bool l)
+{
+	lateInput = l;
+}
+
+// Sleeps to within sleepMargin of t, then spins. The margin follows the
+// worst recent oversleep and decays slowly while the OS wakes us on time.
+static void WaitUntil(double t)
+{
+	double margin = sleepMargin.load();
+	double sleepUntil = t - margin;
+	double now = glfwGetTime();
+	if (sleepUntil > now)
+	{
+		SleepSeconds(sleepUntil - now);
+		double oversleep = glfwGetTime() - sleepUntil;
+		margin = std::max(margin * 0.99, oversleep * 1.25);
+		sleepMargin.store(std::min(std::max(margin, kMinSleepMargin), kMaxSleepMargin));
+	}
+	while (glfwGetTime() < t)
+	{
+	}
+}
+
+static double PredictedWork()
+{
+	double worst = 0.0;
+	for (double w : workTimes)
+	{
+		worst = std::max(worst, w);
+	}
+	return worst + kLateInputSafety;
+}
+
+void FramePacerBeginFrame()
+{
+	double wakeAt = 0.0;
+	{
+		std::lock_guard<std::mutex> lock(pacerMutex);
+		if (targetHz <= 0.0)
+		{
+			return;
+		}
+		if (lateInput && deadline > 0.0 && !resyncRequested)
+		{
+			wakeAt = deadline - PredictedWork();
+		}
+	}
+	if (wakeAt > 0.0)
+	{
+		WaitUntil(wakeAt);
+	}
+	std::lock_guard<std::mutex> lock(pacerMutex);
+	frameStart = glfwGetTime();
+}
+
+void FramePacerResync()
+{
+	std::lock_guard<std::mutex> lock(pacerMutex);
+	resyncRequested = true;
+	frameStart = glfwGetTime();
+}
+
+void FramePacerEndFrame()
+{
+	PROFILE_FUNCTION();
+	double now = glfwGetTime();
+	double wakeAt = 0.0;
+	{
+		std::lock_guard<std::mutex> lock(pacerMutex);
+		ApplySwapInterval();
+		if (targetHz <= 0.0)
+		{
+			return;
+		}
+		if (resyncRequested)
+		{
+			deadline = 0.0;
+			resyncRequested = false;
+		}
+		workTimes[workHead] = now - frameStart;
+		workHead = (workHead + 1) % kWorkHistory;
+		wakeAt = deadline;
+	}
+
+	double release = now;
+	if (wakeAt > now)
+	{
+		WaitUntil(wakeAt);
+		release = glfwGetTime();
+	}
+
+	std::lock_guard<std::mutex> lock(pacerMutex);
+	if (deadline > 0.0)
+	{
+		if (now > deadline)
+		{
+			++missedDeadlines;
+		}
+		errors[errorHead] = std::fabs(release - deadline);
+		errorHead = (errorHead + 1) % kErrorHistory;
+		errorCount = std::min(errorCount + 1, kErrorHistory);
+	}
+	// A late frame restarts the cadence from its own release instead of
+	// rushing the following frames to catch up.
+	deadline = (deadline > 0.0 && release <= deadline + interval ? deadline : release) + interval;
+}
+
+FramePacerStats FramePacerGetStats()
+{
+	std::lock_guard<std::mutex> lock(pacerMutex);
+	FramePacerStats s = {};
+	s.targetHz = targetHz;
+	for (int i = 0; i < errorCount; ++i)
+	{
+		s.meanErrorMs += errors[i] * 1000.0;
+		s.maxErrorMs = std::max(s.maxErrorMs, errors[i] * 1000.0);
+	}
+	s.meanErrorMs = errorCount ? s.meanErrorMs / errorCount : 0.0;
+	s.sleepMarginMs = sleepMargin * 1000.0;
+	s.predictedWorkMs = PredictedWork() * 1000.0;
+	s.missedDeadlines = missedDeadlines;
+	return s;
+}
+
+void DrawFramePacerUI()
+{
+	if (!ImGui::CollapsingHeader("Frame Pacing"))
+	{
+		return;
+	}
+	static const double presets[] = { 0.0, 30.0, 60.0, 120.0, 144.0, 240.0 };
+	static const char* presetNames[] = { "Uncapped", "30 Hz", "60 Hz", "120 Hz", "144 Hz", "240 Hz" };
+	int current = -1;
+	for (int i = 0; i < IM_ARRAYSIZE(presets); ++i)
+	{
+		if (presets[i] == targetHz)
+		{
+			current = i;
+		}
+	}
+	if (ImGui::BeginCombo("Frame cap", current >= 0 ? presetNames[current] : FrameFormat("%.0f Hz", targetHz)))
+	{
+		for (int i = 0; i < IM_ARRAYSIZE(presets); ++i)
+		{
+			if (ImGui::Selectable(presetNames[i], i == current))
+			{
+				FramePacerSetTargetHz(presets[i]);
+			}
+		}
+		ImGui::EndCombo();
+	}
+	ImGui::BeginDisabled(targetHz > 0.0);
+	bool v = vsync;
+	if (ImGui::Checkbox("VSync", &v))
+	{
+		FramePacerSetVSync(v);
+	}
+	ImGui::EndDisabled();
+	ImGui::Checkbox("Late input sampling", &lateInput);
+
+	if (targetHz <= 0.0)
+	{
+		ImGui::TextDisabled("%s", vsync ? "Paced by vsync" : "Unpaced");
+		return;
+	}
+	FramePacerStats s = FramePacerGetStats();
+	ImGui::Text("Pacing error: %.3f ms mean, %.3f ms max", s.meanErrorMs, s.maxErrorMs);
+	ImGui::Text("Sleep margin: %.2f ms, predicted work: %.2f ms", s.sleepMarginMs, s.predictedWorkMs);
+	ImGui::Text("Missed deadlines: %llu", s.missedDeadlines);
+}
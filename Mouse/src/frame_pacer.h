@@ -0,0 +1,38 @@
+#pragma once
+
+struct GLFWwindow;
+
+// Releases frames at exact intervals for a target rate (e.g. 144 Hz, or 30 Hz
+// for power tests). Waiting sleeps coarsely up to a margin before the
+// deadline and spins the rest; the margin tracks how late the OS wakes us.
+// With late input sampling the slack moves to the start of the frame, so
+// events are polled just in time to finish the frame by its deadline.
+
+void FramePacerInit(GLFWwindow* window);
+void FramePacerShutdown();
+
+// 0 leaves pacing to vsync. A cap turns vsync off so the pacer owns timing.
+void FramePacerSetTargetHz(double hz);
+void FramePacerSetVSync(bool vsync);
+void FramePacerSetLateInput(bool lateInput);
+
+// Before polling events: with late input sampling, waits until the predicted
+// frame cost before the deadline.
+void FramePacerBeginFrame();
+// After an idle wait the old deadline means nothing; the next frame is
+// released as soon as it is ready.
+void FramePacerResync();
+// Right before glfwSwapBuffers: waits for the frame's deadline.
+void FramePacerEndFrame();
+
+struct FramePacerStats {
+	double targetHz;
+	double meanErrorMs; // mean |release - deadline| over the recent window
+	double maxErrorMs;
+	double sleepMarginMs;
+	double predictedWorkMs;
+	unsigned long long missedDeadlines;
+};
+
+FramePacerStats FramePacerGetStats();
+void DrawFramePacerUI();
@@ -0,0 +1,220 @@
+#include "frame_stats.h"
+
+#include <cstdio>
+#include <algorithm>
+
+#include "imgui.h"
+
+static const double kBucketMs = 0.1;
+static const int kBucketCount = 1000; // 0..100 ms; the last bucket also takes anything slower
+
+static float ring[kFrameStatsWindow];        // frame times in ms
+static int histogram[kBucketCount];
+static unsigned long long maxQueue[kFrameStatsWindow]; // sample numbers with decreasing times
+static int maxQueueHead = 0;
+static int maxQueueSize = 0;
+
+static unsigned long long sampleCount = 0;   // samples pushed into the ring
+static unsigned long long totalHitches = 0;
+static double windowSum = 0.0;
+static int windowHitches = 0;
+static double worstMs = 0.0;
+static double hitchBudgetMs = 1000.0 / 30.0;
+static bool skippedFirst = false;
+
+static int BucketOf(float ms)
+{
+	int b = int(ms / kBucketMs);
+	return b < 0 ? 0 : (b >= kBucketCount ? kBucketCount - 1 : b);
+}
+
+static float SampleAt(unsigned long long n)
+{
+	return ring[n % kFrameStatsWindow];
+}
+
+void FrameStatsRecord(float deltaTime)
+{
+	// The first delta spans window creation and startup, not a frame.
+	if (!skippedFirst)
+	{
+		skippedFirst = true;
+		return;
+	}
+
+	float ms = deltaTime * 1000.0f;
+	unsigned long long n = sampleCount++;
+
+	if (n >= (unsigned long long)kFrameStatsWindow)
+	{
+		float old = SampleAt(n);
+		--histogram[BucketOf(old)];
+		windowSum -= old;
+		if (old > hitchBudgetMs)
+		{
+			--windowHitches;
+		}
+	}
+	ring[n % kFrameStatsWindow] = ms;
+	++histogram[BucketOf(ms)];
+	windowSum += ms;
+	if (ms > hitchBudgetMs)
+	{
+		++windowHitches;
+		++totalHitches;
+	}
+	worstMs = std::max(worstMs, double(ms));
+
+	// Sliding-window max: drop the expired front, then every smaller sample at the back.
+	if (maxQueueSize > 0 && maxQueue[maxQueueHead] + kFrameStatsWindow <= n)
+	{
+		maxQueueHead = (maxQueueHead + 1) % kFrameStatsWindow;
+		--maxQueueSize;
+	}
+	while (maxQueueSize > 0)
+	{
+		int back = (maxQueueHead + maxQueueSize - 1) % kFrameStatsWindow;
+		if (SampleAt(maxQueue[back]) > ms)
+		{
+			break;
+		}
+		--maxQueueSize;
+	}
+	maxQueue[(maxQueueHead + maxQueueSize) % kFrameStatsWindow] = n;
+	++maxQueueSize;
+}
+
+void FrameStatsSetHitchBudget(double ms)
+{
+	hitchBudgetMs = ms;
+	windowHitches = 0;
+	int samples = (int)std::min<unsigned long long>(sampleCount, kFrameStatsWindow);
+	for (int i = 0; i < samples; ++i)
+	{
+		if (ring[i] > hitchBudgetMs)
+		{
+			++windowHitches;
+		}
+	}
+}
+
+static double Percentile(int samples, double maxMs, double p)
+{
+	int target = std::max(1, int(p * samples + 0.5));
+	int cumulative = 0;
+	for (int b = 0; b < kBucketCount; ++b)
+	{
+		cumulative += histogram[b];
+		if (cumulative >= target)
+		{
+			return std::min((b + 1) * kBucketMs, maxMs);
+		}
+	}
+	return maxMs;
+}
+
+FrameStatsSummary FrameStatsGetSummary()
+{
+	FrameStatsSummary s = {};
+	s.samples = (int)std::min<unsigned long long>(sampleCount, kFrameStatsWindow);
+	s.hitchBudgetMs = hitchBudgetMs;
+	s.windowHitches = windowHitches;
+	s.totalFrames = sampleCount;
+	s.totalHitches = totalHitches;
+	s.worstMs = worstMs;
+	if (s.samples == 0)
+	{
+		return s;
+	}
+	s.avgMs = windowSum / s.samples;
+	s.maxMs = SampleAt(maxQueue[maxQueueHead]);
+	s.p50Ms = Percentile(s.samples, s.maxMs, 0.50);
+	s.p90Ms = Percentile(s.samples, s.maxMs, 0.90);
+	s.p99Ms = Percentile(s.samples, s.maxMs, 0.99);
+	return s;
+}
+
+bool FrameStatsWriteJson(const char* path)
+{
+	FILE* f = fopen(path, "w");
+	if (!f)
+	{
+		return false;
+	}
+	FrameStatsSummary s = FrameStatsGetSummary();
+	fprintf(f, "{\n");
+	fprintf(f, "  \"frames\": %llu,\n", s.totalFrames);
+	fprintf(f, "  \"hitch_budget_ms\": %.3f,\n", s.hitchBudgetMs);
+	fprintf(f, "  \"hitches\": %llu,\n", s.totalHitches);
+	fprintf(f, "  \"worst_ms\": %.3f,\n", s.worstMs);
+	fprintf(f, "  \"window\": {\n");
+	fprintf(f, "    \"samples\": %d,\n", s.samples);
+	fprintf(f, "    \"hitches\": %d,\n", s.windowHitches);
+	fprintf(f, "    \"avg_ms\": %.3f,\n", s.avgMs);
+	fprintf(f, "    \"p50_ms\": %.3f,\n", s.p50Ms);
+	fprintf(f, "    \"p90_ms\": %.3f,\n", s.p90Ms);
+	fprintf(f, "    \"p99_ms\": %.3f,\n", s.p99Ms);
+	fprintf(f, "    \"max_ms\": %.3f\n", s.maxMs);
+	fprintf(f, "  }\n");
+	fprintf(f, "}\n");
+	fclose(f);
+	return true;
+}
+
+static void DrawFrameTimeGraph(const FrameStatsSummary& s)
+{
+	ImVec2 p0 = ImGui::GetCursorScreenPos();
+	ImVec2 size(ImGui::GetContentRegionAvail().x, 80.0f);
+	ImGui::InvisibleButton("FrameTimeGraph", ImVec2(std::max(size.x, 1.0f), size.y));
+	ImDrawList* draw = ImGui::GetWindowDrawList();
+	draw->AddRectFilled(p0, ImVec2(p0.x + size.x, p0.y + size.y), IM_COL32(30, 30, 30, 255));
+	if (s.samples == 0)
+	{
+		return;
+	}
+
+	double scaleMax = std::max(s.maxMs, s.hitchBudgetMs * 1.25);
+	float budgetY = p0.y + size.y - float(s.hitchBudgetMs / scaleMax) * size.y;
+	float barWidth = size.x / kFrameStatsWindow;
+
+	// Oldest sample on the left so new frames scroll in from the right.
+	unsigned long long first = sampleCount - s.samples;
+	for (int i = 0; i < s.samples; ++i)
+	{
+		float ms = SampleAt(first + i);
+		float x = p0.x + size.x - (s.samples - i) * barWidth;
+		float y = p0.y + size.y - float(ms / scaleMax) * size.y;
+		ImU32 col = ms > s.hitchBudgetMs ? IM_COL32(230, 60, 60, 255) : IM_COL32(90, 180, 90, 255);
+		draw->AddRectFilled(ImVec2(x, y), ImVec2(x + std::max(barWidth, 1.0f), p0.y + size.y), col);
+	}
+	draw->AddLine(ImVec2(p0.x, budgetY), ImVec2(p0.x + size.x, budgetY), IM_COL32(255, 200, 0, 255));
+
+	if (ImGui::IsItemHovered())
+	{
+		int i = int((ImGui::GetMousePos().x - (p0.x + size.x - s.samples * barWidth)) / barWidth);
+		if (i >= 0 && i < s.samples)
+		{
+			ImGui::SetTooltip("%.2f ms", SampleAt(first + i));
+		}
+	}
+}
+
+void DrawFrameStatsUI()
+{
+	if (!ImGui::CollapsingHeader("Frame Times", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		return;
+	}
+	FrameStatsSummary s = FrameStatsGetSummary();
+	ImGui::Text("avg %.2f  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f ms", s.avgMs, s.p50Ms, s.p90Ms, s.p99Ms, s.maxMs);
+
+	float budget = float(hitchBudgetMs);
+	if (ImGui::DragFloat("Hitch Budget (ms)", &budget, 0.1f, 1.0f, 1000.0f, "%.1f"))
+	{
+		FrameStatsSetHitchBudget(budget);
+	}
+	ImVec4 hitchColor = s.windowHitches > 0 ? ImVec4(1.0f, 0.35f, 0.35f, 1.0f) : ImGui::GetStyleColorVec4(ImGuiCol_Text);
+	ImGui::TextColored(hitchColor, "Hitches: %d in window, %llu total (worst %.2f ms)", s.windowHitches, s.totalHitches, s.worstMs);
+
+	DrawFrameTimeGraph(s);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+// Rolling frame-time statistics over the last kFrameStatsWindow frames.
+// Recording a frame is O(1): the ring keeps a bucketed histogram and a
+// monotonic max queue in step with the samples it holds.
+static const int kFrameStatsWindow = 1024;
+
+struct FrameStatsSummary {
+	int samples;
+	double avgMs;
+	double p50Ms;
+	double p90Ms;
+	double p99Ms;
+	double maxMs;
+	double hitchBudgetMs;
+	int windowHitches;
+	unsigned long long totalFrames;
+	unsigned long long totalHitches;
+	double worstMs;
+};
+
+void FrameStatsRecord(float deltaTime);
+void FrameStatsSetHitchBudget(double ms);
+FrameStatsSummary FrameStatsGetSummary();
+
+bool FrameStatsWriteJson(const char* path);
+void DrawFrameStatsUI();
@@ -0,0 +1,302 @@
+#include "gpu_timer.h"
+
+#include <cstring>
+#include <glad/glad.h>
+
+#include "imgui.h"
+
+static const int kGpuFrameLatency = 4;
+static const int kMaxGpuZones = 32;
+
+struct GpuZone {
+	const char* name;
+	int depth;
+	bool begun;
+	bool ended;
+};
+
+struct GpuFrameSlot {
+	GLuint timestamps[kMaxGpuZones * 2];
+	GLuint elapsed;
+	GpuZone zones[kMaxGpuZones];
+	int zoneCount;
+	bool pending;
+};
+
+struct GpuResult {
+	const char* name;
+	int depth;
+	double ms;
+	GLuint64 start;
+};
+
+static GpuFrameSlot slots[kGpuFrameLatency];
+static GpuFrameSlot* current = nullptr;
+static int frameIndex = 0;
+static bool initialized = false;
+
+static int zoneStackDepth = 0;
+static int drawListZones[kMaxGpuZones];
+static int drawListZoneCount = 0;
+
+static GpuResult results[kMaxGpuZones];
+static int resultCount = 0;
+static double frameGpuMs = 0.0;
+static unsigned int skippedFrames = 0;
+
+void GpuTimerInit()
+{
+	for (auto& slot : slots)
+	{
+		glGenQueries(kMaxGpuZones * 2, slot.timestamps);
+		glGenQueries(1, &slot.elapsed);
+		slot.zoneCount = 0;
+		slot.pending = false;
+	}
+	initialized = true;
+}
+
+void GpuTimerShutdown()
+{
+	if (!initialized)
+	{
+		return;
+	}
+	for (auto& slot : slots)
+	{
+		glDeleteQueries(kMaxGpuZones * 2, slot.timestamps);
+		glDeleteQueries(1, &slot.elapsed);
+	}
+	initialized = false;
+}
+
+static void ResolveSlot(GpuFrameSlot& slot)
+{
+	if (!slot.pending)
+	{
+		return;
+	}
+	slot.pending = false;
+
+	// The elapsed query ends after every timestamp in the slot, so once it is
+	// available the rest are too. If the GPU is still behind, drop the frame.
+	GLint available = 0;
+	glGetQueryObjectiv(slot.elapsed, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+	{
+		++skippedFrames;
+		return;
+	}
+
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(slot.elapsed, GL_QUERY_RESULT, &elapsed);
+	frameGpuMs = double(elapsed) / 1e6;
+
+	resultCount = 0;
+	for (int i = 0; i < slot.zoneCount; ++i)
+	{
+		const GpuZone& z = slot.zones[i];
+		if (!z.begun || !z.ended)
+		{
+			continue;
+		}
+		GLuint64 t0 = 0, t1 = 0;
+		glGetQueryObjectui64v(slot.timestamps[i * 2], GL_QUERY_RESULT, &t0);
+		glGetQueryObjectui64v(slot.timestamps[i * 2 + 1], GL_QUERY_RESULT, &t1);
+		GpuResult r = { z.name, z.depth, t1 > t0 ? double(t1 - t0) / 1e6 : 0.0, t0 };
+
+		// Zones are allocated in recording order; list them in GPU execution order.
+		int j = resultCount++;
+		for (; j > 0 && results[j - 1].start > r.start; --j)
+		{
+			results[j] = results[j - 1];
+		}
+		results[j] = r;
+	}
+}
+
+void GpuTimerBeginFrame()
+{
+	if (!initialized)
+	{
+		return;
+	}
+	current = &slots[frameIndex % kGpuFrameLatency];
+	ResolveSlot(*current);
+	current->zoneCount = 0;
+	zoneStackDepth = 0;
+	drawListZoneCount = 0;
+	glBeginQuery(GL_TIME_ELAPSED, current->elapsed);
+}
+
+void GpuTimerEndFrame()
+{
+	if (!current)
+	{
+		return;
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+	current->pending = true;
+	current = nullptr;
+	++frameIndex;
+}
+
+static int AllocZone(const char* name)
+{
+	if (!current || current->zoneCount >= kMaxGpuZones)
+	{
+		return -1;
+	}
+	int zone = current->zoneCount++;
+	GpuZone& z = current->zones[zone];
+	z.name = name;
+	z.depth = 0;
+	z.begun = false;
+	z.ended = false;
+	return zone;
+}
+
+static void IssueBegin(int zone)
+{
+	if (zone < 0 || !current)
+	{
+		return;
+	}
+	GpuZone& z = current->zones[zone];
+	glQueryCounter(current->timestamps[zone * 2], GL_TIMESTAMP);
+	z.depth = zoneStackDepth;
+	z.begun = true;
+	++zoneStackDepth;
+}
+
+static void IssueEnd(int zone)
+{
+	if (zone < 0 || !current || !current->zones[zone].begun)
+	{
+		return;
+	}
+	glQueryCounter(current->timestamps[zone * 2 + 1], GL_TIMESTAMP);
+	current->zones[zone].ended = true;
+	if (zoneStackDepth > 0)
+	{
+		--zoneStackDepth;
+	}
+}
+
+int GpuZoneBegin(const char* name)
+{
+	int zone = AllocZone(name);
+	IssueBegin(zone);
+	return zone;
+}
+
+void GpuZoneEnd(int zone)
+{
+	IssueEnd(zone);
+}
+
+// The callback data packs the zone index with a begin/end bit.
+static void DrawListZoneCallback(const ImDrawList*, const ImDrawCmd* cmd)
+{
+	intptr_t data = (intptr_t)cmd->UserCallbackData;
+	int zone = int(data >> 1);
+	if (data & 1)
+	{
+		IssueEnd(zone);
+	}
+	else
+	{
+		IssueBegin(zone);
+	}
+}
+
+void GpuDrawListZoneBegin(ImDrawList* draw, const char* name)
+{
+	int zone = AllocZone(name);
+	if (drawListZoneCount < kMaxGpuZones)
+	{
+		drawListZones[drawListZoneCount++] = zone;
+	}
+	if (zone >= 0)
+	{
+		draw->AddCallback(DrawListZoneCallback, (void*)(intptr_t)(zone << 1));
+	}
+}
+
+void GpuDrawListZoneEnd(ImDrawList* draw)
+{
+	if (drawListZoneCount == 0)
+	{
+		return;
+	}
+	int zone = drawListZones[--drawListZoneCount];
+	if (zone >= 0)
+	{
+		draw->AddCallback(DrawListZoneCallback, (void*)(intptr_t)((zone << 1) | 1));
+	}
+}
+
+double GpuTimerGetFrameMs()
+{
+	return frameGpuMs;
+}
+
+static double FindCpuZoneMs(const char* name)
+{
+	int count = 0;
+	const ProfileZone* zones = ProfilerGetLastFrame(&count, nullptr, nullptr);
+	for (int i = 0; i < count; ++i)
+	{
+		if (zones[i].thread == 0 && strcmp(zones[i].name, name) == 0)
+		{
+			return ProfilerTicksToMs(zones[i].end - zones[i].start);
+		}
+	}
+	return -1.0;
+}
+
+void DrawGpuTimerUI()
+{
+	if (!ImGui::CollapsingHeader("GPU Timing", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		return;
+	}
+	if (!initialized)
+	{
+		ImGui::TextDisabled("GPU timer queries not initialized");
+		return;
+	}
+	ImGui::Text("GPU Frame: %.3f ms (%d frame latency, %u skipped)", frameGpuMs, kGpuFrameLatency, skippedFrames);
+
+	if (!ImGui::BeginTable("GpuZones", 3, ImGuiTableFlags_BordersV | ImGuiTableFlags_RowBg))
+	{
+		return;
+	}
+	ImGui::TableSetupColumn("Pass", ImGuiTableColumnFlags_WidthStretch);
+	ImGui::TableSetupColumn("GPU ms", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+	ImGui::TableSetupColumn("CPU ms", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+	ImGui::TableHeadersRow();
+	for (int i = 0; i < resultCount; ++i)
+	{
+		const GpuResult& r = results[i];
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		float indent = r.depth * ImGui::GetStyle().IndentSpacing;
+		if (indent > 0.0f) ImGui::Indent(indent);
+		ImGui::TextUnformatted(r.name);
+		if (indent > 0.0f) ImGui::Unindent(indent);
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", r.ms);
+		ImGui::TableNextColumn();
+		double cpuMs = FindCpuZoneMs(r.name);
+		if (cpuMs >= 0.0)
+		{
+			ImGui::Text("%.3f", cpuMs);
+		}
+		else
+		{
+			ImGui::TextDisabled("-");
+		}
+	}
+	ImGui::EndTable();
+}
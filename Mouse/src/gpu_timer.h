@@ -0,0 +1,39 @@
+#pragma once
+
+#include "profiler.h"
+
+struct ImDrawList;
+
+// GL_TIMESTAMP queries are kept in a ring of kGpuFrameLatency frames and read
+// back only once the GPU has finished with them, so timing never stalls the CPU.
+void GpuTimerInit();
+void GpuTimerShutdown();
+void GpuTimerBeginFrame();
+void GpuTimerEndFrame();
+
+int GpuZoneBegin(const char* name);
+void GpuZoneEnd(int zone);
+
+// Times the draw commands of one ImDrawList through draw callbacks, for passes
+// that the ImGui backend submits on our behalf.
+void GpuDrawListZoneBegin(ImDrawList* draw, const char* name);
+void GpuDrawListZoneEnd(ImDrawList* draw);
+
+double GpuTimerGetFrameMs();
+void DrawGpuTimerUI();
+
+#if MOUSE_PROFILER
+
+struct GpuScope {
+	int zone;
+	explicit GpuScope(const char* name) : zone(GpuZoneBegin(name)) {}
+	~GpuScope() { GpuZoneEnd(zone); }
+};
+
+#define GPU_SCOPE(name) GpuScope PROFILE_CONCAT(gpuScope, __LINE__)(name)
+
+#else
+
+#define GPU_SCOPE(name) ((void)0)
+
+#endif
@@ -0,0 +1,480 @@
+#include "hit_test.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "imgui.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MOUSE_HIT_TEST_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define MOUSE_TARGET(isa)
+#else
+#include <cpuid.h>
+#define MOUSE_TARGET(isa) __attribute__((target(isa)))
+#endif
+#else
+#define MOUSE_HIT_TEST_X86 0
+#endif
+
+static int PaddedCount(int count)
+{
+	return (count + 15) & ~15;
+}
+
+static int HighestBit32(uint32_t v)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse(&index, v);
+	return (int)index;
+#else
+	return 31 - __builtin_clz(v);
+#endif
+}
+
+static int PopCount64(uint64_t v)
+{
+	v = v - ((v >> 1) & 0x5555555555555555ull);
+	v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+	v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+	return (int)((v * 0x0101010101010101ull) >> 56);
+}
+
+void HitColumnsResize(HitColumns& cols, int count)
+{
+	int padded = PaddedCount(count);
+	if (padded > cols.capacity)
+	{
+		int capacity = PaddedCount(cols.capacity + cols.capacity / 2);
+		capacity = capacity > padded ? capacity : padded;
+		size_t column = (size_t)capacity * sizeof(float);
+		char* block = (char*)malloc(column * 4 + 64);
+		if (!block)
+		{
+			return;
+		}
+		float* base = (float*)(((uintptr_t)block + 63) & ~(uintptr_t)63);
+		float* columns[4] = { base, base + capacity, base + capacity * 2, base + capacity * 3 };
+		if (cols.count > 0)
+		{
+			memcpy(columns[0], cols.minX, cols.count * sizeof(float));
+			memcpy(columns[1], cols.minY, cols.count * sizeof(float));
+			memcpy(columns[2], cols.maxX, cols.count * sizeof(float));
+			memcpy(columns[3], cols.maxY, cols.count * sizeof(float));
+		}
+		free(cols.block);
+		cols.block = block;
+		cols.minX = columns[0];
+		cols.minY = columns[1];
+		cols.maxX = columns[2];
+		cols.maxY = columns[3];
+		cols.capacity = capacity;
+	}
+	cols.count = count;
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	for (int i = count; i < padded; ++i)
+	{
+		HitColumnsSet(cols, i, nan, nan, nan, nan);
+	}
+}
+
+void HitColumnsFree(HitColumns& cols)
+{
+	free(cols.block);
+	cols = HitColumns();
+}
+
+// Each ISA provides 16-wide block tests; these loops turn them into queries.
+// Padding is NaN, so blocks past count never report hits.
+#define HIT_TOPMOST_LOOP(BLOCK) \
+	for (int i = PaddedCount(c.count) - 16; i >= 0; i -= 16) \
+	{ \
+		uint32_t bits = BLOCK; \
+		if (bits) \
+		{ \
+			return i + HighestBit32(bits); \
+		} \
+	} \
+	return -1
+
+#define HIT_MASK_LOOP(BLOCK) \
+	for (int i = 0, padded = PaddedCount(c.count); i < padded; i += 16) \
+	{ \
+		uint64_t bits = BLOCK; \
+		if ((i & 63) == 0) \
+		{ \
+			mask[i >> 6] = 0; \
+		} \
+		mask[i >> 6] |= bits << (i & 63); \
+	}
+
+static uint32_t PointBlockScalar(const HitColumns& c, int i, float x, float y)
+{
+	uint32_t bits = 0;
+	for (int k = 0; k < 16; ++k)
+	{
+		bool in = c.minX[i + k] <= x && x <= c.maxX[i + k] && c.minY[i + k] <= y && y <= c.maxY[i + k];
+		bits |= (uint32_t)in << k;
+	}
+	return bits;
+}
+
+static uint32_t RectBlockScalar(const HitColumns& c, int i, float x0, float y0, float x1, float y1, bool contain)
+{
+	uint32_t bits = 0;
+	for (int k = 0; k < 16; ++k)
+	{
+		bool in = contain
+			? x0 <= c.minX[i + k] && c.maxX[i + k] <= x1 && y0 <= c.minY[i + k] && c.maxY[i + k] <= y1
+			: c.minX[i + k] <= x1 && x0 <= c.maxX[i + k] && c.minY[i + k] <= y1 && y0 <= c.maxY[i + k];
+		bits |= (uint32_t)in << k;
+	}
+	return bits;
+}
+
+static int PointTopmostScalar(const HitColumns& c, float x, float y)
+{
+	HIT_TOPMOST_LOOP(PointBlockScalar(c, i, x, y));
+}
+
+static void PointMaskScalar(const HitColumns& c, float x, float y, uint64_t* mask)
+{
+	HIT_MASK_LOOP(PointBlockScalar(c, i, x, y));
+}
+
+static void RectMaskScalar(const HitColumns& c, float x0, float y0, float x1, float y1, bool contain, uint64_t* mask)
+{
+	HIT_MASK_LOOP(RectBlockScalar(c, i, x0, y0, x1, y1, contain));
+}
+
+#if MOUSE_HIT_TEST_X86
+
+// SSE2: four lanes, four blocks per 16.
+MOUSE_TARGET("sse2") static inline uint32_t PointBlockSSE2(const HitColumns& c, int i, __m128 px, __m128 py)
+{
+	uint32_t bits = 0;
+	for (int k = 0; k < 16; k += 4)
+	{
+		__m128 inX = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(c.minX + i + k), px), _mm_cmple_ps(px, _mm_load_ps(c.maxX + i + k)));
+		__m128 inY = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(c.minY + i + k), py), _mm_cmple_ps(py, _mm_load_ps(c.maxY + i + k)));
+		bits |= (uint32_t)_mm_movemask_ps(_mm_and_ps(inX, inY)) << k;
+	}
+	return bits;
+}
+
+// Overlap tests (lo <= max && min <= hi); containment tests (lo <= min && max <= hi).
+MOUSE_TARGET("sse2") static inline uint32_t RectBlockSSE2(const HitColumns& c, int i, __m128 x0, __m128 y0, __m128 x1, __m128 y1, bool contain)
+{
+	uint32_t bits = 0;
+	for (int k = 0; k < 16; k += 4)
+	{
+		__m128 minX = _mm_load_ps(c.minX + i + k), maxX = _mm_load_ps(c.maxX + i + k);
+		__m128 minY = _mm_load_ps(c.minY + i + k), maxY = _mm_load_ps(c.maxY + i + k);
+		__m128 in = contain
+			? _mm_and_ps(_mm_and_ps(_mm_cmple_ps(x0, minX), _mm_cmple_ps(maxX, x1)), _mm_and_ps(_mm_cmple_ps(y0, minY), _mm_cmple_ps(maxY, y1)))
+			: _mm_and_ps(_mm_and_ps(_mm_cmple_ps(minX, x1), _mm_cmple_ps(x0, maxX)), _mm_and_ps(_mm_cmple_ps(minY, y1), _mm_cmple_ps(y0, maxY)));
+		bits |= (uint32_t)_mm_movemask_ps(in) << k;
+	}
+	return bits;
+}
+
+MOUSE_TARGET("sse2") static int PointTopmostSSE2(const HitColumns& c, float x, float y)
+{
+	const __m128 px = _mm_set1_ps(x), py = _mm_set1_ps(y);
+	HIT_TOPMOST_LOOP(PointBlockSSE2(c, i, px, py));
+}
+
+MOUSE_TARGET("sse2") static void PointMaskSSE2(const HitColumns& c, float x, float y, uint64_t* mask)
+{
+	const __m128 px = _mm_set1_ps(x), py = _mm_set1_ps(y);
+	HIT_MASK_LOOP(PointBlockSSE2(c, i, px, py));
+}
+
+MOUSE_TARGET("sse2") static void RectMaskSSE2(const HitColumns& c, float x0, float y0, float x1, float y1, bool contain, uint64_t* mask)
+{
+	const __m128 qx0 = _mm_set1_ps(x0), qy0 = _mm_set1_ps(y0), qx1 = _mm_set1_ps(x1), qy1 = _mm_set1_ps(y1);
+	HIT_MASK_LOOP(RectBlockSSE2(c, i, qx0, qy0, qx1, qy1, contain));
+}
+
+// AVX2: eight lanes, two blocks per 16.
+MOUSE_TARGET("avx2") static inline uint32_t PointBlockAVX2(const HitColumns& c, int i, __m256 px, __m256 py)
+{
+	uint32_t bits = 0;
+	for (int k = 0; k < 16; k += 8)
+	{
+		__m256 inX = _mm256_and_ps(_mm256_cmp_ps(_mm256_load_ps(c.minX + i + k), px, _CMP_LE_OQ), _mm256_cmp_ps(px, _mm256_load_ps(c.maxX + i + k), _CMP_LE_OQ));
+		__m256 inY = _mm256_and_ps(_mm256_cmp_ps(_mm256_load_ps(c.minY + i + k), py, _CMP_LE_OQ), _mm256_cmp_ps(py, _mm256_load_ps(c.maxY + i + k), _CMP_LE_OQ));
+		bits |= (uint32_t)_mm256_movemask_ps(_mm256_and_ps(inX, inY)) << k;
+	}
+	return bits;
+}
+
+MOUSE_TARGET("avx2") static inline uint32_t RectBlockAVX2(const HitColumns& c, int i, __m256 x0, __m256 y0, __m256 x1, __m256 y1, bool contain)
+{
+	uint32_t bits = 0;
+	for (int k = 0; k < 16; k += 8)
+	{
+		__m256 minX = _mm256_load_ps(c.minX + i + k), maxX = _mm256_load_ps(c.maxX + i + k);
+		__m256 minY = _mm256_load_ps(c.minY + i + k), maxY = _mm256_load_ps(c.maxY + i + k);
+		__m256 in = contain
+			? _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(x0, minX, _CMP_LE_OQ), _mm256_cmp_ps(maxX, x1, _CMP_LE_OQ)),
+				_mm256_and_ps(_mm256_cmp_ps(y0, minY, _CMP_LE_OQ), _mm256_cmp_ps(maxY, y1, _CMP_LE_OQ)))
+			: _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(minX, x1, _CMP_LE_OQ), _mm256_cmp_ps(x0, maxX, _CMP_LE_OQ)),
+				_mm256_and_ps(_mm256_cmp_ps(minY, y1, _CMP_LE_OQ), _mm256_cmp_ps(y0, maxY, _CMP_LE_OQ)));
+		bits |= (uint32_t)_mm256_movemask_ps(in) << k;
+	}
+	return bits;
+}
+
+MOUSE_TARGET("avx2") static int PointTopmostAVX2(const HitColumns& c, float x, float y)
+{
+	const __m256 px = _mm256_set1_ps(x), py = _mm256_set1_ps(y);
+	HIT_TOPMOST_LOOP(PointBlockAVX2(c, i, px, py));
+}
+
+MOUSE_TARGET("avx2") static void PointMaskAVX2(const HitColumns& c, float x, float y, uint64_t* mask)
+{
+	const __m256 px = _mm256_set1_ps(x), py = _mm256_set1_ps(y);
+	HIT_MASK_LOOP(PointBlockAVX2(c, i, px, py));
+}
+
+MOUSE_TARGET("avx2") static void RectMaskAVX2(const HitColumns& c, float x0, float y0, float x1, float y1, bool contain, uint64_t* mask)
+{
+	const __m256 qx0 = _mm256_set1_ps(x0), qy0 = _mm256_set1_ps(y0), qx1 = _mm256_set1_ps(x1), qy1 = _mm256_set1_ps(y1);
+	HIT_MASK_LOOP(RectBlockAVX2(c, i, qx0, qy0, qx1, qy1, contain));
+}
+
+// AVX-512: one block per 16, comparisons land directly in mask registers.
+MOUSE_TARGET("avx512f") static inline uint32_t PointBlockAVX512(const HitColumns& c, int i, __m512 px, __m512 py)
+{
+	__mmask16 in = _mm512_cmp_ps_mask(_mm512_load_ps(c.minX + i), px, _CMP_LE_OQ);
+	in = _mm512_mask_cmp_ps_mask(in, px, _mm512_load_ps(c.maxX + i), _CMP_LE_OQ);
+	in = _mm512_mask_cmp_ps_mask(in, _mm512_load_ps(c.minY + i), py, _CMP_LE_OQ);
+	in = _mm512_mask_cmp_ps_mask(in, py, _mm512_load_ps(c.maxY + i), _CMP_LE_OQ);
+	return (uint32_t)in;
+}
+
+MOUSE_TARGET("avx512f") static inline uint32_t RectBlockAVX512(const HitColumns& c, int i, __m512 x0, __m512 y0, __m512 x1, __m512 y1, bool contain)
+{
+	__m512 minX = _mm512_load_ps(c.minX + i), maxX = _mm512_load_ps(c.maxX + i);
+	__m512 minY = _mm512_load_ps(c.minY + i), maxY = _mm512_load_ps(c.maxY + i);
+	__mmask16 in;
+	if (contain)
+	{
+		in = _mm512_cmp_ps_mask(x0, minX, _CMP_LE_OQ);
+		in = _mm512_mask_cmp_ps_mask(in, maxX, x1, _CMP_LE_OQ);
+		in = _mm512_mask_cmp_ps_mask(in, y0, minY, _CMP_LE_OQ);
+		in = _mm512_mask_cmp_ps_mask(in, maxY, y1, _CMP_LE_OQ);
+	}
+	else
+	{
+		in = _mm512_cmp_ps_mask(minX, x1, _CMP_LE_OQ);
+		in = _mm512_mask_cmp_ps_mask(in, x0, maxX, _CMP_LE_OQ);
+		in = _mm512_mask_cmp_ps_mask(in, minY, y1, _CMP_LE_OQ);
+		in = _mm512_mask_cmp_ps_mask(in, y0, maxY, _CMP_LE_OQ);
+	}
+	return (uint32_t)in;
+}
+
+MOUSE_TARGET("avx512f") static int PointTopmostAVX512(const HitColumns& c, float x, float y)
+{
+	const __m512 px = _mm512_set1_ps(x), py = _mm512_set1_ps(y);
+	HIT_TOPMOST_LOOP(PointBlockAVX512(c, i, px, py));
+}
+
+MOUSE_TARGET("avx512f") static void PointMaskAVX512(const HitColumns& c, float x, float y, uint64_t* mask)
+{
+	const __m512 px = _mm512_set1_ps(x), py = _mm512_set1_ps(y);
+	HIT_MASK_LOOP(PointBlockAVX512(c, i, px, py));
+}
+
+MOUSE_TARGET("avx512f") static void RectMaskAVX512(const HitColumns& c, float x0, float y0, float x1, float y1, bool contain, uint64_t* mask)
+{
+	const __m512 qx0 = _mm512_set1_ps(x0), qy0 = _mm512_set1_ps(y0), qx1 = _mm512_set1_ps(x1), qy1 = _mm512_set1_ps(y1);
+	HIT_MASK_LOOP(RectBlockAVX512(c, i, qx0, qy0, qx1, qy1, contain));
+}
+
+static void Cpuid(unsigned int leaf, unsigned int sub, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+	__cpuidex((int*)regs, (int)leaf, (int)sub);
+#else
+	__cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t ReadXcr0()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int lo, hi;
+	__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+// The CPU must report the instructions and the OS must save the wider registers (XCR0).
+static HitTestIsa DetectIsa()
+{
+	unsigned int r0[4], r1[4], r7[4] = {};
+	Cpuid(0, 0, r0);
+	Cpuid(1, 0, r1);
+	if (r0[0] >= 7)
+	{
+		Cpuid(7, 0, r7);
+	}
+	bool sse2 = (r1[3] >> 26) & 1;
+	bool osxsave = (r1[2] >> 27) & 1;
+	bool avx = (r1[2] >> 28) & 1;
+	uint64_t xcr0 = osxsave ? ReadXcr0() : 0;
+	bool avx2 = avx && (xcr0 & 0x6) == 0x6 && ((r7[1] >> 5) & 1);
+	bool avx512 = avx2 && (xcr0 & 0xE6) == 0xE6 && ((r7[1] >> 16) & 1);
+	return avx512 ? HitTestIsa_AVX512 : avx2 ? HitTestIsa_AVX2 : sse2 ? HitTestIsa_SSE2 : HitTestIsa_Scalar;
+}
+
+#else
+
+static HitTestIsa DetectIsa()
+{
+	return HitTestIsa_Scalar;
+}
+
+#endif
+
+struct HitKernels {
+	int (*pointTopmost)(const HitColumns&, float, float);
+	void (*pointMask)(const HitColumns&, float, float, uint64_t*);
+	void (*rectMask)(const HitColumns&, float, float, float, float, bool, uint64_t*);
+};
+
+static const HitKernels kKernels[HitTestIsa_Count] = {
+	{ PointTopmostScalar, PointMaskScalar, RectMaskScalar },
+#if MOUSE_HIT_TEST_X86
+	{ PointTopmostSSE2, PointMaskSSE2, RectMaskSSE2 },
+	{ PointTopmostAVX2, PointMaskAVX2, RectMaskAVX2 },
+	{ PointTopmostAVX512, PointMaskAVX512, RectMaskAVX512 },
+#else
+	{ PointTopmostScalar, PointMaskScalar, RectMaskScalar },
+	{ PointTopmostScalar, PointMaskScalar, RectMaskScalar },
+	{ PointTopmostScalar, PointMaskScalar, RectMaskScalar },
+#endif
+};
+
+static const char* const kIsaNames[HitTestIsa_Count] = { "Scalar", "SSE2", "AVX2", "AVX-512" };
+
+static bool detected = false;
+static HitTestIsa bestIsa = HitTestIsa_Scalar;
+static const HitKernels* kernels = nullptr;
+
+static void EnsureDetected()
+{
+	if (!detected)
+	{
+		bestIsa = DetectIsa();
+		detected = true;
+	}
+}
+
+static const HitKernels& Kernels()
+{
+	if (!kernels)
+	{
+		EnsureDetected();
+		kernels = &kKernels[bestIsa];
+	}
+	return *kernels;
+}
+
+HitTestIsa HitTestSetIsa(HitTestIsa isa)
+{
+	if (HitTestIsaSupported(isa))
+	{
+		kernels = &kKernels[isa];
+	}
+	return HitTestGetIsa();
+}
+
+HitTestIsa HitTestGetIsa()
+{
+	return (HitTestIsa)(&Kernels() - kKernels);
+}
+
+bool HitTestIsaSupported(HitTestIsa isa)
+{
+	EnsureDetected();
+	return isa >= HitTestIsa_Scalar && isa <= bestIsa;
+}
+
+const char* HitTestIsaName(HitTestIsa isa)
+{
+	return isa >= HitTestIsa_Scalar && isa < HitTestIsa_Count ? kIsaNames[isa] : "?";
+}
+
+int HitTestPointTopmost(const HitColumns& cols, float x, float y)
+{
+	return Kernels().pointTopmost(cols, x, y);
+}
+
+void HitTestPointMask(const HitColumns& cols, float x, float y, uint64_t* mask)
+{
+	Kernels().pointMask(cols, x, y, mask);
+}
+
+void HitTestRectMask(const HitColumns& cols, float x0, float y0, float x1, float y1, HitRectMode mode, uint64_t* mask)
+{
+	Kernels().rectMask(cols, x0, y0, x1, y1, mode == HitRectMode_Contain, mask);
+}
+
+int HitMaskToIndices(const uint64_t* mask, int count, int* out)
+{
+	int n = 0;
+	for (int w = 0, words = HitMaskWords(count); w < words; ++w)
+	{
+		for (uint64_t bits = mask[w]; bits; bits &= bits - 1)
+		{
+			out[n++] = w * 64 + HitLowestBit(bits);
+		}
+	}
+	return n;
+}
+
+int HitMaskPopCount(const uint64_t* mask, int count)
+{
+	int n = 0;
+	for (int w = 0, words = HitMaskWords(count); w < words; ++w)
+	{
+		n += PopCount64(mask[w]);
+	}
+	return n;
+}
+
+void DrawHitTestUI()
+{
+	if (!ImGui::CollapsingHeader("Hit Testing"))
+	{
+		return;
+	}
+	HitTestIsa active = HitTestGetIsa();
+	ImGui::Text("Kernels: %s", HitTestIsaName(active));
+	for (int i = 0; i < HitTestIsa_Count; ++i)
+	{
+		HitTestIsa isa = (HitTestIsa)i;
+		if (!HitTestIsaSupported(isa))
+		{
+			continue;
+		}
+		if (i > 0)
+		{
+			ImGui::SameLine();
+		}
+		if (ImGui::RadioButton(HitTestIsaName(isa), active == isa))
+		{
+			HitTestSetIsa(isa);
+		}
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Brute-force hit testing over bounds stored as four float columns. Kernels
+// are written for SSE2, AVX2 and AVX-512 and the widest one the CPU and OS
+// support is picked at first use. Every query returns the same result on
+// every ISA; the scalar path is the reference.
+
+enum HitTestIsa {
+	HitTestIsa_Scalar,
+	HitTestIsa_SSE2,
+	HitTestIsa_AVX2,
+	HitTestIsa_AVX512,
+	HitTestIsa_Count
+};
+
+enum HitRectMode {
+	HitRectMode_Overlap, // touches the query rect (edges inclusive)
+	HitRectMode_Contain  // lies entirely inside the query rect
+};
+
+// Columns are 64-byte aligned and padded to a multiple of 16 with NaN, which
+// fails every comparison, so kernels never need a scalar tail.
+struct HitColumns {
+	float* minX = nullptr;
+	float* minY = nullptr;
+	float* maxX = nullptr;
+	float* maxY = nullptr;
+	int count = 0;
+	int capacity = 0;
+	void* block = nullptr;
+};
+
+void HitColumnsResize(HitColumns& cols, int count);
+void HitColumnsFree(HitColumns& cols);
+
+inline void HitColumnsSet(HitColumns& cols, int i, float x0, float y0, float x1, float y1)
+{
+	cols.minX[i] = x0;
+	cols.minY[i] = y0;
+	cols.maxX[i] = x1;
+	cols.maxY[i] = y1;
+}
+
+inline int HitMaskWords(int count) { return (count + 63) / 64; }
+
+// Index of the lowest set bit; v must be non-zero.
+inline int HitLowestBit(uint64_t v)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long)v))
+	{
+		return (int)index;
+	}
+	_BitScanForward(&index, (unsigned long)(v >> 32));
+	return (int)index + 32;
+#else
+	return __builtin_ctzll(v);
+#endif
+}
+
+// Highest index whose bounds contain the point (edges inclusive), or -1.
+// Matches a reverse scan over draw order, i.e. the topmost object.
+int HitTestPointTopmost(const HitColumns& cols, float x, float y);
+
+// Bit i of mask[i / 64] is set when object i is hit. mask needs HitMaskWords(count) words.
+void HitTestPointMask(const HitColumns& cols, float x, float y, uint64_t* mask);
+void HitTestRectMask(const HitColumns& cols, float x0, float y0, float x1, float y1, HitRectMode mode, uint64_t* mask);
+
+// Compacts a mask into ascending indices; out needs room for count entries. Returns the hit count.
+int HitMaskToIndices(const uint64_t* mask, int count, int* out);
+int HitMaskPopCount(const uint64_t* mask, int count);
+
+HitTestIsa HitTestGetIsa();
+bool HitTestIsaSupported(HitTestIsa isa);
+// Forces an ISA (benchmarks, debugging); unsupported ones are ignored. Returns the active ISA.
+HitTestIsa HitTestSetIsa(HitTestIsa isa);
+const char* HitTestIsaName(HitTestIsa isa);
+
+void DrawHitTestUI();
@@ -0,0 +1,347 @@
+#include "image_decode.h"
+
+#include "file_util.h"
+
+static uint16_t ReadU16(const uint8_t* p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t ReadU32(const uint8_t* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool CheckSize(int w, int h, const char** error)
+{
+	if (w <= 0 || h <= 0 || w > kMaxImageDimension || h > kMaxImageDimension)
+	{
+		return Fail(error, "image size out of range");
+	}
+	return true;
+}
+
+// Only once the file is known to hold that many pixels: a corrupt header
+// would otherwise cost a 1 GiB allocation before it is found out.
+static void Allocate(DecodedImage& out, int w, int h)
+{
+	out.width = w;
+	out.height = h;
+	out.rgba.resize((size_t)w * h * 4);
+}
+
+// TGA -----------------------------------------------------------------------
+
+static bool DecodeTga(const uint8_t* data, size_t size, DecodedImage& out, const char** error)
+{
+	if (size < 18)
+	{
+		return Fail(error, "truncated TGA header");
+	}
+	int idLength = data[0];
+	int colorMapType = data[1];
+	int imageType = data[2];
+	int colorMapLength = ReadU16(data + 5);
+	int colorMapBits = data[7];
+	int w = ReadU16(data + 12), h = ReadU16(data + 14);
+	int bpp = data[16];
+	bool topDown = (data[17] & 0x20) != 0;
+	bool rle = imageType == 10 || imageType == 11;
+	bool gray = imageType == 3 || imageType == 11;
+	if (imageType == 1 || imageType == 9)
+	{
+		return Fail(error, "color-mapped TGA is not supported");
+	}
+	if (imageType != 2 && imageType != 3 && imageType != 10 && imageType != 11)
+	{
+		return Fail(error, "unknown image format");
+	}
+	if (gray ? bpp != 8 : (bpp != 24 && bpp != 32))
+	{
+		return Fail(error, "unsupported TGA pixel depth");
+	}
+	if (!CheckSize(w, h, error))
+	{
+		return false;
+	}
+
+	size_t pos = 18 + idLength + (colorMapType ? (size_t)colorMapLength * ((colorMapBits + 7) / 8) : 0);
+	int bytes = bpp / 8;
+	size_t pixels = (size_t)w * h;
+	// An RLE packet covers at most 128 pixels.
+	size_t minData = rle ? (pixels + 127) / 128 * (1 + bytes) : pixels * bytes;
+	if (pos > size || size - pos < minData)
+	{
+		return Fail(error, "truncated TGA pixel data");
+	}
+	Allocate(out, w, h);
+	uint8_t* dst = out.rgba.data();
+	auto put = [&](size_t i, const uint8_t* src)
+	{
+		// Stored bottom row first unless the descriptor says otherwise.
+		size_t x = i % w, y = i / w;
+		uint8_t* p = dst + ((topDown ? y : h - 1 - y) * w + x) * 4;
+		if (gray)
+		{
+			p[0] = p[1] = p[2] = src[0];
+			p[3] = 255;
+		}
+		else
+		{
+			p[0] = src[2];
+			p[1] = src[1];
+			p[2] = src[0];
+			p[3] = bytes == 4 ? src[3] : 255;
+		}
+	};
+
+	if (!rle)
+	{
+		for (size_t i = 0; i < pixels; ++i)
+		{
+			put(i, data + pos + i * bytes);
+		}
+		return true;
+	}
+	// RLE packets: a header byte, then either one pixel repeated or raw pixels.
+	size_t i = 0;
+	while (i < pixels)
+	{
+		if (pos >= size)
+		{
+			return Fail(error, "truncated TGA pixel data");
+		}
+		uint8_t header = data[pos++];
+		size_t run = (header & 0x7F) + 1;
+		bool repeat = (header & 0x80) != 0;
+		size_t need = repeat ? bytes : run * bytes;
+		if (size - pos < need || pixels - i < run)
+		{
+			return Fail(error, "corrupt TGA run");
+		}
+		for (size_t k = 0; k < run; ++k)
+		{
+			put(i + k, data + pos + (repeat ? 0 : k * bytes));
+		}
+		pos += need;
+		i += run;
+	}
+	return true;
+}
+
+// PPM / PGM -------------------------------------------------------------------
+
+// Next whitespace-separated header number, skipping # comments.
+static bool ReadPnmNumber(const uint8_t* data, size_t size, size_t& pos, int& value)
+{
+	for (;;)
+	{
+		while (pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\r' || data[pos] == '\n'))
+		{
+			++pos;
+		}
+		if (pos < size && data[pos] == '#')
+		{
+			while (pos < size && data[pos] != '\n')
+			{
+				++pos;
+			}
+			continue;
+		}
+		break;
+	}
+	if (pos >= size || data[pos] < '0' || data[pos] > '9')
+	{
+		return false;
+	}
+	value = 0;
+	while (pos < size && data[pos] >= '0' && data[pos] <= '9')
+	{
+		value = value * 10 + (data[pos++] - '0');
+		if (value > 1 << 24)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool DecodePnm(const uint8_t* data, size_t size, DecodedImage& out, const char** error)
+{
+	bool gray = data[1] == '5';
+	size_t pos = 2;
+	int w = 0, h = 0, maxValue = 0;
+	if (!ReadPnmNumber(data, size, pos, w) || !ReadPnmNumber(data, size, pos, h) || !ReadPnmNumber(data, size, pos, maxValue))
+	{
+		return Fail(error, "corrupt PPM header");
+	}
+	if (maxValue <= 0 || maxValue > 255)
+	{
+		return Fail(error, "only 8 bit PPM is supported");
+	}
+	++pos; // the single whitespace byte before the raster
+	if (!CheckSize(w, h, error))
+	{
+		return false;
+	}
+	int bytes = gray ? 1 : 3;
+	size_t pixels = (size_t)w * h;
+	if (pos > size || size - pos < pixels * bytes)
+	{
+		return Fail(error, "truncated PPM pixel data");
+	}
+	Allocate(out, w, h);
+	const uint8_t* src = data + pos;
+	uint8_t* dst = out.rgba.data();
+	for (size_t i = 0; i < pixels; ++i, src += bytes, dst += 4)
+	{
+		uint8_t r = src[0], g = src[gray ? 0 : 1], b = src[gray ? 0 : 2];
+		if (maxValue != 255)
+		{
+			r = (uint8_t)(r * 255 / maxValue);
+			g = (uint8_t)(g * 255 / maxValue);
+			b = (uint8_t)(b * 255 / maxValue);
+		}
+		dst[0] = r;
+		dst[1] = g;
+		dst[2] = b;
+		dst[3] = 255;
+	}
+	return true;
+}
+
+// BMP -------------------------------------------------------------------------
+
+// Shift and width of a BI_BITFIELDS channel mask.
+static void MaskShift(uint32_t mask, int& shift, int& bits)
+{
+	shift = 0;
+	bits = 0;
+	if (!mask)
+	{
+		return;
+	}
+	while (!(mask & 1))
+	{
+		mask >>= 1;
+		++shift;
+	}
+	while (mask & 1)
+	{
+		mask >>= 1;
+		++bits;
+	}
+}
+
+static uint8_t ExtractChannel(uint32_t v, int shift, int bits, uint8_t missing)
+{
+	if (!bits)
+	{
+		return missing;
+	}
+	uint32_t max = bits >= 32 ? ~0u : (1u << bits) - 1;
+	uint32_t c = (v >> shift) & max;
+	return (uint8_t)(bits >= 8 ? c >> (bits - 8) : c * 255 / max);
+}
+
+static bool DecodeBmp(const uint8_t* data, size_t size, DecodedImage& out, const char** error)
+{
+	if (size < 54)
+	{
+		return Fail(error, "truncated BMP header");
+	}
+	uint32_t offset = ReadU32(data + 10);
+	uint32_t headerSize = ReadU32(data + 14);
+	if (headerSize < 40 || 14 + (size_t)headerSize > size)
+	{
+		return Fail(error, "unsupported BMP header");
+	}
+	int w = (int)ReadU32(data + 18);
+	int h = (int)ReadU32(data + 22);
+	int bpp = ReadU16(data + 28);
+	uint32_t compression = ReadU32(data + 30);
+	bool topDown = h < 0;
+	if (topDown)
+	{
+		h = h < -kMaxImageDimension ? 0 : -h;
+	}
+	if (compression != 0 && !(compression == 3 && bpp == 32))
+	{
+		return Fail(error, "compressed BMP is not supported");
+	}
+	if (bpp != 24 && bpp != 32)
+	{
+		return Fail(error, "only 24 and 32 bit BMP is supported");
+	}
+	if (!CheckSize(w, h, error))
+	{
+		return false;
+	}
+
+	// BI_RGB 32 bit leaves alpha undefined; treat it as opaque.
+	uint32_t masks[4] = { 0x00FF0000, 0x0000FF00, 0x000000FF, 0 };
+	if (compression == 3)
+	{
+		// Masks follow a 40 byte header, or sit inside a V4/V5 header.
+		if (54 + 12 > size)
+		{
+			return Fail(error, "truncated BMP masks");
+		}
+		masks[0] = ReadU32(data + 54);
+		masks[1] = ReadU32(data + 58);
+		masks[2] = ReadU32(data + 62);
+		masks[3] = headerSize >= 56 && 70 <= size ? ReadU32(data + 66) : 0;
+	}
+	int shifts[4], bits[4];
+	for (int c = 0; c < 4; ++c)
+	{
+		MaskShift(masks[c], shifts[c], bits[c]);
+	}
+
+	int bytes = bpp / 8;
+	size_t stride = ((size_t)w * bytes + 3) & ~(size_t)3;
+	if (offset > size || size - offset < stride * h)
+	{
+		return Fail(error, "truncated BMP pixel data");
+	}
+	Allocate(out, w, h);
+	for (int y = 0; y < h; ++y)
+	{
+		const uint8_t* src = data + offset + stride * (topDown ? y : h - 1 - y);
+		uint8_t* dst = out.rgba.data() + (size_t)y * w * 4;
+		if (bytes == 3)
+		{
+			for (int x = 0; x < w; ++x, src += 3, dst += 4)
+			{
+				dst[0] = src[2];
+				dst[1] = src[1];
+				dst[2] = src[0];
+				dst[3] = 255;
+			}
+			continue;
+		}
+		for (int x = 0; x < w; ++x, src += 4, dst += 4)
+		{
+			uint32_t v = ReadU32(src);
+			for (int c = 0; c < 4; ++c)
+			{
+				dst[c] = ExtractChannel(v, shifts[c], bits[c], 255);
+			}
+		}
+	}
+	return true;
+}
+
+bool DecodeImage(const uint8_t* data, size_t size, DecodedImage& out, const char** error)
+{
+	if (size >= 2 && data[0] == 'B' && data[1] == 'M')
+	{
+		return DecodeBmp(data, size, out, error);
+	}
+	if (size >= 2 && data[0] == 'P' && (data[1] == '5' || data[1] == '6'))
+	{
+		return DecodePnm(data, size, out, error);
+	}
+	// TGA has no signature; its header checks reject everything else.
+	return DecodeTga(data, size, out, error);
+}
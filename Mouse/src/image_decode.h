@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Decoders for the simple uncompressed image formats the asset pipeline
+// exports: TGA (true color and grayscale, raw or RLE), binary PPM/PGM
+// (P6/P5, 8 bit) and BMP (24/32 bit, BI_RGB or BI_BITFIELDS). Output is
+// always RGBA8, top row first.
+
+struct DecodedImage {
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> rgba;
+};
+
+// Largest width or height accepted; bigger headers are treated as corrupt.
+static const int kMaxImageDimension = 16384;
+
+// Picks the decoder from the file's signature. On failure returns false and
+// points error at a static message.
+bool DecodeImage(const uint8_t* data, size_t size, DecodedImage& out, const char** error);
@@ -0,0 +1,330 @@
+#include "input_latency.h"
+
+#include <algorithm>
+#include <mutex>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "imgui.h"
+#include "trace.h"
+
+// Frames being built, queued for the render thread or waiting on their
+// fence. When the slot a new frame needs is still busy, that frame goes
+// unmeasured rather than waiting.
+static const int kFramesInFlight = 8;
+static const int kLatencySamples = 256;
+
+enum LatencySlotState {
+	LatencySlot_Free,
+	LatencySlot_Building, // between BeginFrame and EndFrame
+	LatencySlot_Fenced    // waiting for the GPU
+};
+
+struct LatencyFrame {
+	double events[InputEvent_Count]; // 0 when the frame had no event of that kind
+	double stages[LatencyStage_Count];
+	double gpuToCpu;                 // seconds to add to a GL timestamp to get glfwGetTime
+	GLsync fence;
+	GLuint query;
+	LatencySlotState state;
+};
+
+struct LatencyHistory {
+	float stageMs[kLatencySamples][LatencyStage_Count]; // since the event; negative when not reached
+	int head;
+	int count;
+};
+
+static const char* kEventNames[InputEvent_Count] = { "Mouse Move", "Mouse Button", "Scroll", "Key" };
+static const char* kCounterNames[InputEvent_Count] = {
+	"Latency: Mouse Move (ms)", "Latency: Mouse Button (ms)", "Latency: Scroll (ms)", "Latency: Key (ms)"
+};
+static const char* kStageNames[LatencyStage_Count] = { "NewFrame", "Update", "Render", "Submit", "Swap", "GPU" };
+
+static double pendingEvents[InputEvent_Count];
+static LatencyFrame frames[kFramesInFlight];
+static int frameIndex = 0;
+static bool useFences = false;
+static unsigned int droppedFrames = 0;
+static LatencyHistory history[InputEvent_Count];
+// Slot states and the history; frames move between the main and render threads.
+static std::mutex latencyMutex;
+
+static void NoteEvent(InputEventKind kind)
+{
+	if (pendingEvents[kind] == 0.0)
+	{
+		pendingEvents[kind] = glfwGetTime();
+	}
+}
+
+static void CursorPosCallback(GLFWwindow*, double, double) { NoteEvent(InputEvent_MouseMove); }
+static void MouseButtonCallback(GLFWwindow*, int, int, int) { NoteEvent(InputEvent_MouseButton); }
+static void ScrollCallback(GLFWwindow*, double, double) { NoteEvent(InputEvent_Scroll); }
+static void KeyCallback(GLFWwindow*, int, int, int, int) { NoteEvent(InputEvent_Key); }
+static void CharCallback(GLFWwindow*, unsigned int) { NoteEvent(InputEvent_Key); }
+
+void InputLatencyInit(GLFWwindow* window)
+{
+	glfwSetCursorPosCallback(window, CursorPosCallback);
+	glfwSetMouseButtonCallback(window, MouseButtonCallback);
+	glfwSetScrollCallback(window, ScrollCallback);
+	glfwSetKeyCallback(window, KeyCallback);
+	glfwSetCharCallback(window, CharCallback);
+
+	// Fences are core in 3.2, timestamp queries in 3.3.
+	useFences = GLAD_GL_VERSION_3_3 != 0;
+	for (LatencyFrame& f : frames)
+	{
+		f.fence = nullptr;
+		f.state = LatencySlot_Free;
+		f.query = 0;
+		if (useFences)
+		{
+			glGenQueries(1, &f.query);
+		}
+	}
+}
+
+static void ReleaseFence(LatencyFrame& f)
+{
+	if (f.fence)
+	{
+		glDeleteSync(f.fence);
+		f.fence = nullptr;
+	}
+	f.state = LatencySlot_Free;
+}
+
+void InputLatencyShutdown()
+{
+	for (LatencyFrame& f : frames)
+	{
+		ReleaseFence(f);
+		if (f.query)
+		{
+			glDeleteQueries(1, &f.query);
+			f.query = 0;
+		}
+	}
+	useFences = false;
+}
+
+static void Record(const LatencyFrame& f)
+{
+	// The last stage reached is what the user sees: GPU completion when
+	// fenced, otherwise the return from the swap.
+	int last = f.stages[LatencyStage_Gpu] > 0.0 ? LatencyStage_Gpu : LatencyStage_Swap;
+	for (int k = 0; k < InputEvent_Count; ++k)
+	{
+		if (f.events[k] == 0.0)
+		{
+			continue;
+		}
+		LatencyHistory& h = history[k];
+		float* sample = h.stageMs[h.head];
+		for (int s = 0; s < LatencyStage_Count; ++s)
+		{
+			sample[s] = f.stages[s] > 0.0 ? (float)((f.stages[s] - f.events[k]) * 1000.0) : -1.0f;
+		}
+		h.head = (h.head + 1) % kLatencySamples;
+		h.count = std::min(h.count + 1, kLatencySamples);
+		TraceCounter(kCounterNames[k], sample[last]);
+	}
+}
+
+// Collects frames whose fence has signaled. Never blocks.
+static void ResolveFrames()
+{
+	for (LatencyFrame& f : frames)
+	{
+		if (f.state != LatencySlot_Fenced)
+		{
+			continue;
+		}
+		GLenum state = glClientWaitSync(f.fence, 0, 0);
+		if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+		{
+			continue;
+		}
+		GLuint64 gpuNs = 0;
+		glGetQueryObjectui64v(f.query, GL_QUERY_RESULT, &gpuNs);
+		f.stages[LatencyStage_Gpu] = gpuNs * 1e-9 + f.gpuToCpu;
+		Record(f);
+		ReleaseFence(f);
+	}
+}
+
+int InputLatencyBeginFrame()
+{
+	bool any = false;
+	for (double t : pendingEvents)
+	{
+		any |= t != 0.0;
+	}
+	// Frames without input cost nothing beyond this check.
+	if (!any)
+	{
+		return -1;
+	}
+	int slot = frameIndex % kFramesInFlight;
+	LatencyFrame& f = frames[slot];
+	{
+		std::lock_guard<std::mutex> lock(latencyMutex);
+		if (f.state != LatencySlot_Free)
+		{
+			++droppedFrames;
+			return -1;
+		}
+		f.state = LatencySlot_Building;
+	}
+	++frameIndex;
+	for (int k = 0; k < InputEvent_Count; ++k)
+	{
+		f.events[k] = pendingEvents[k];
+		pendingEvents[k] = 0.0;
+	}
+	std::fill(f.stages, f.stages + LatencyStage_Count, 0.0);
+	f.stages[LatencyStage_NewFrame] = glfwGetTime();
+	return slot;
+}
+
+void InputLatencyMark(int frame, LatencyStage stage)
+{
+	if (frame >= 0)
+	{
+		frames[frame].stages[stage] = glfwGetTime();
+	}
+}
+
+void InputLatencyEndFrame(int frame)
+{
+	std::lock_guard<std::mutex> lock(latencyMutex);
+	if (frame >= 0)
+	{
+		LatencyFrame& f = frames[frame];
+		f.stages[LatencyStage_Swap] = glfwGetTime();
+		if (useFences)
+		{
+			glQueryCounter(f.query, GL_TIMESTAMP);
+			f.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			// Pair the GL clock with the CPU clock now; drift over a few frames is negligible.
+			GLint64 gpuNow = 0;
+			glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+			f.gpuToCpu = glfwGetTime() - gpuNow * 1e-9;
+			f.state = LatencySlot_Fenced;
+		}
+		else
+		{
+			Record(f);
+			f.state = LatencySlot_Free;
+		}
+	}
+	if (useFences)
+	{
+		ResolveFrames();
+	}
+}
+
+void InputLatencyDiscard(int frame)
+{
+	if (frame >= 0)
+	{
+		std::lock_guard<std::mutex> lock(latencyMutex);
+		frames[frame].state = LatencySlot_Free;
+	}
+}
+
+static float Percentile(float* sorted, int count, float p)
+{
+	return sorted[std::min((int)(p * count), count - 1)];
+}
+
+void DrawInputLatencyUI()
+{
+	if (!ImGui::CollapsingHeader("Input Latency"))
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> lock(latencyMutex);
+	ImGui::Text("Measured to: %s", useFences ? "GPU completion (fence)" : "swap return");
+	if (droppedFrames)
+	{
+		ImGui::TextDisabled("%u frames dropped with the GPU behind", droppedFrames);
+	}
+
+	if (ImGui::BeginTable("LatencyTotals", 5, ImGuiTableFlags_BordersV | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Event", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn("Samples", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+		ImGui::TableSetupColumn("p50 ms", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+		ImGui::TableSetupColumn("p95 ms", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+		ImGui::TableSetupColumn("max ms", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+		ImGui::TableHeadersRow();
+		for (int k = 0; k < InputEvent_Count; ++k)
+		{
+			const LatencyHistory& h = history[k];
+			float totals[kLatencySamples];
+			int n = 0;
+			for (int i = 0; i < h.count; ++i)
+			{
+				float gpu = h.stageMs[i][LatencyStage_Gpu];
+				totals[n++] = gpu >= 0.0f ? gpu : h.stageMs[i][LatencyStage_Swap];
+			}
+			std::sort(totals, totals + n);
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(kEventNames[k]);
+			ImGui::TableNextColumn();
+			ImGui::Text("%d", n);
+			if (n == 0)
+			{
+				continue;
+			}
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", Percentile(totals, n, 0.5f));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", Percentile(totals, n, 0.95f));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", totals[n - 1]);
+		}
+		ImGui::EndTable();
+	}
+
+	// Mean time from the event to each stage, to see where the latency goes.
+	if (ImGui::BeginTable("LatencyStages", LatencyStage_Count + 1, ImGuiTableFlags_BordersV | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Mean ms", ImGuiTableColumnFlags_WidthStretch);
+		for (int s = 0; s < LatencyStage_Count; ++s)
+		{
+			ImGui::TableSetupColumn(kStageNames[s], ImGuiTableColumnFlags_WidthFixed, 55.0f);
+		}
+		ImGui::TableHeadersRow();
+		for (int k = 0; k < InputEvent_Count; ++k)
+		{
+			const LatencyHistory& h = history[k];
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(kEventNames[k]);
+			for (int s = 0; s < LatencyStage_Count; ++s)
+			{
+				double sum = 0.0;
+				int n = 0;
+				for (int i = 0; i < h.count; ++i)
+				{
+					if (h.stageMs[i][s] >= 0.0f)
+					{
+						sum += h.stageMs[i][s];
+						++n;
+					}
+				}
+				ImGui::TableNextColumn();
+				if (n)
+				{
+					ImGui::Text("%.2f", sum / n);
+				}
+			}
+		}
+		ImGui::EndTable();
+	}
+}
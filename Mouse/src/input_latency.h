@@ -0,0 +1,46 @@
+#pragma once
+
+struct GLFWwindow;
+
+// Input-to-photon latency. GLFW input callbacks timestamp the first event of
+// each kind since the last frame; the frame that consumes them records when
+// it passed each stage, and a fence plus a GL timestamp query placed after
+// the swap tell when the GPU finished it. Latencies are kept per event kind
+// and also written to the trace as counters.
+
+enum InputEventKind {
+	InputEvent_MouseMove,
+	InputEvent_MouseButton,
+	InputEvent_Scroll,
+	InputEvent_Key,
+	InputEvent_Count
+};
+
+enum LatencyStage {
+	LatencyStage_NewFrame,
+	LatencyStage_Update,  // scene update and Scene view built
+	LatencyStage_Render,  // ImGui::Render
+	LatencyStage_Submit,  // backend RenderDrawData
+	LatencyStage_Swap,    // glfwSwapBuffers returned
+	LatencyStage_Gpu,     // GPU done with the frame (fence)
+	LatencyStage_Count
+};
+
+// Installs the input callbacks and creates the timestamp queries. Call after
+// GL is loaded and before ImGui_ImplGlfw_InitForOpenGL, which chains to the
+// callbacks.
+void InputLatencyInit(GLFWwindow* window);
+void InputLatencyShutdown();
+
+// After ImGui::NewFrame: takes the events polled for this frame. Returns the
+// frame's handle, or -1 when it carries no input; the other calls accept -1.
+// Stages may be marked from whichever thread has the frame at the time.
+int InputLatencyBeginFrame();
+void InputLatencyMark(int frame, LatencyStage stage);
+// On the GL thread after glfwSwapBuffers: fences the frame and collects
+// finished ones. Call it every frame.
+void InputLatencyEndFrame(int frame);
+// For frames that are dropped before being presented.
+void InputLatencyDiscard(int frame);
+
+void DrawInputLatencyUI();
@@ -0,0 +1,371 @@
+#include "layer_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "profiler.h"
+#include "frame_arena.h"
+
+// Enough for a 4K view plus a ring of recently panned-away tiles.
+static const int kMaxTiles = 256;
+// Tiles redrawn per frame at most; the rest wait for the next frame.
+static const int kRasterBudget = 16;
+// A wheel zoom changes the zoom every frame; tiles drawn before it stops
+// would be thrown away, so the direct path covers until it holds this long.
+static const double kZoomSettleSeconds = 0.15;
+
+struct LayerTile {
+	int tx, ty;
+	void* handle;
+	unsigned int lastUsed;
+	bool valid;
+};
+
+static const LayerCacheBackend* backend = nullptr;
+static bool userEnabled = true;
+static std::vector<LayerTile> tiles;
+static float tileZoom = 0.0f;
+static double zoomChangedAt = -1e9;
+static bool pending = false;
+static unsigned int frameCounter = 0;
+static LayerCacheStats stats;
+
+static void FreeTiles()
+{
+	for (LayerTile& t : tiles)
+	{
+		backend->destroy(t.handle);
+	}
+	tiles.clear();
+}
+
+void LayerCacheSetBackend(const LayerCacheBackend* b)
+{
+	if (backend)
+	{
+		FreeTiles();
+	}
+	backend = b;
+	tileZoom = 0.0f;
+}
+
+bool LayerCacheEnabled()
+{
+	return backend && userEnabled;
+}
+
+void LayerCacheShutdown()
+{
+	LayerCacheSetBackend(nullptr);
+}
+
+void LayerCacheInvalidateAll()
+{
+	for (LayerTile& t : tiles)
+	{
+		t.valid = false;
+	}
+}
+
+void LayerCacheInvalidateRect(float x0, float y0, float x1, float y1)
+{
+	if (tiles.empty() || tileZoom <= 0.0f)
+	{
+		return;
+	}
+	// Tiles are half-open, so an edge that lands exactly on a tile boundary
+	// still dirties the tile on its far side; that costs at most one redraw.
+	float inv = tileZoom / kLayerTilePixels;
+	int tx0 = (int)std::floor(x0 * inv), tx1 = (int)std::floor(x1 * inv);
+	int ty0 = (int)std::floor(y0 * inv), ty1 = (int)std::floor(y1 * inv);
+	for (LayerTile& t : tiles)
+	{
+		if (t.tx >= tx0 && t.tx <= tx1 && t.ty >= ty0 && t.ty <= ty1)
+		{
+			t.valid = false;
+		}
+	}
+}
+
+static LayerTile* FindTile(int tx, int ty)
+{
+	for (LayerTile& t : tiles)
+	{
+		if (t.tx == tx && t.ty == ty)
+		{
+			return &t;
+		}
+	}
+	return nullptr;
+}
+
+// A fresh slot while under kMaxTiles, otherwise the least recently used tile
+// that is not on screen this frame.
+static LayerTile* AcquireTile(int tx, int ty)
+{
+	LayerTile* slot = nullptr;
+	if ((int)tiles.size() < kMaxTiles)
+	{
+		tiles.push_back(LayerTile());
+		slot = &tiles.back();
+		slot->handle = backend->create(kLayerTilePixels);
+	}
+	else
+	{
+		for (LayerTile& t : tiles)
+		{
+			if (t.lastUsed != frameCounter && (!slot || t.lastUsed < slot->lastUsed))
+			{
+				slot = &t;
+			}
+		}
+		if (!slot)
+		{
+			return nullptr;
+		}
+	}
+	slot->tx = tx;
+	slot->ty = ty;
+	slot->valid = false;
+	slot->lastUsed = frameCounter;
+	return slot;
+}
+
+bool LayerCacheDraw(ImDrawList* draw, ImVec2 p0, ImVec2 avail, ImVec2 pan, float zoom, LayerGatherFn gather)
+{
+	PROFILE_FUNCTION();
+	++frameCounter;
+	stats.visible = 0;
+	stats.rasterized = 0;
+	pending = false;
+	if (!LayerCacheEnabled() || avail.x <= 0.0f || avail.y <= 0.0f)
+	{
+		return false;
+	}
+	if (zoom != tileZoom)
+	{
+		LayerCacheInvalidateAll();
+		// The first fill after a backend switch need not wait.
+		if (tileZoom > 0.0f)
+		{
+			zoomChangedAt = ImGui::GetTime();
+		}
+		tileZoom = zoom;
+	}
+	if (ImGui::GetTime() - zoomChangedAt < kZoomSettleSeconds)
+	{
+		++stats.fallbackFrames;
+		pending = true;
+		return false;
+	}
+
+	float worldSize = kLayerTilePixels / zoom;
+	int tx0 = (int)std::floor(pan.x / worldSize), tx1 = (int)std::floor((pan.x + avail.x / zoom) / worldSize);
+	int ty0 = (int)std::floor(pan.y / worldSize), ty1 = (int)std::floor((pan.y + avail.y / zoom) / worldSize);
+	int visible = (tx1 - tx0 + 1) * (ty1 - ty0 + 1);
+	stats.visible = visible;
+	if (visible > kMaxTiles)
+	{
+		++stats.fallbackFrames;
+		return false;
+	}
+
+	// Pointers into tiles stay valid: it never grows past kMaxTiles, which is reserved up front.
+	tiles.reserve(kMaxTiles);
+	LayerTile** onScreen = (LayerTile**)FrameAlloc(visible * sizeof(LayerTile*));
+	bool complete = true;
+	int n = 0;
+	for (int ty = ty0; ty <= ty1; ++ty)
+	{
+		for (int tx = tx0; tx <= tx1; ++tx)
+		{
+			LayerTile* t = FindTile(tx, ty);
+			if (!t)
+			{
+				t = AcquireTile(tx, ty);
+			}
+			if (!t)
+			{
+				complete = false;
+				continue;
+			}
+			t->lastUsed = frameCounter;
+			if (!t->valid && stats.rasterized < kRasterBudget)
+			{
+				ImVec2* mins;
+				ImVec2* maxs;
+				ImU32* colors;
+				int count = gather(tx * worldSize, ty * worldSize, (tx + 1) * worldSize, (ty + 1) * worldSize, zoom, &mins, &maxs, &colors);
+				backend->rasterize(t->handle, kLayerTilePixels, mins, maxs, colors, count);
+				t->valid = true;
+				++stats.rasterized;
+			}
+			complete &= t->valid;
+			onScreen[n++] = t;
+		}
+	}
+	stats.tiles = (int)tiles.size();
+	if (!complete)
+	{
+		++stats.fallbackFrames;
+		pending = true;
+		return false;
+	}
+
+	ImVec2 uv0(0.0f, backend->flipY ? 1.0f : 0.0f), uv1(1.0f, backend->flipY ? 0.0f : 1.0f);
+	if (backend->premultipliedBlend)
+	{
+		draw->AddCallback(backend->premultipliedBlend, nullptr);
+	}
+	for (int i = 0; i < n; ++i)
+	{
+		const LayerTile& t = *onScreen[i];
+		ImVec2 a(p0.x + t.tx * (float)kLayerTilePixels - pan.x * zoom, p0.y + t.ty * (float)kLayerTilePixels - pan.y * zoom);
+		draw->AddImage(backend->texture(t.handle), a, ImVec2(a.x + kLayerTilePixels, a.y + kLayerTilePixels), uv0, uv1);
+	}
+	if (backend->premultipliedBlend)
+	{
+		draw->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+	}
+	return true;
+}
+
+// CPU backend: RGBA8 pixels in IM_COL32 layout, top row first. Edge pixels get
+// fractional coverage, so sub-pixel objects still leave their share of color.
+struct CpuTile {
+	std::vector<ImU32> pixels;
+};
+
+static void* CpuCreate(int size)
+{
+	CpuTile* t = new CpuTile();
+	t->pixels.resize(size * size);
+	return t;
+}
+
+static void CpuDestroy(void* tile)
+{
+	delete (CpuTile*)tile;
+}
+
+// Non-premultiplied "over": the tile starts transparent and is composited with straight alpha.
+static ImU32 BlendOver(ImU32 dst, ImU32 src, float coverage)
+{
+	ImU32 srcA = src >> IM_COL32_A_SHIFT, dstA = dst >> IM_COL32_A_SHIFT;
+	if (dstA == 0)
+	{
+		return (src & ~IM_COL32_A_MASK) | ((ImU32)(srcA * coverage + 0.5f) << IM_COL32_A_SHIFT);
+	}
+	if (dstA == 0xFF && srcA == 0xFF)
+	{
+		// Opaque over opaque is a plain lerp; two channels per multiply.
+		ImU32 a = (ImU32)(coverage * 256.0f + 0.5f), na = 256 - a;
+		ImU32 rb = (((src & 0xFF00FF) * a + (dst & 0xFF00FF) * na) >> 8) & 0xFF00FF;
+		ImU32 g = (((src & 0x00FF00) * a + (dst & 0x00FF00) * na) >> 8) & 0x00FF00;
+		return rb | g | IM_COL32_A_MASK;
+	}
+	float sa = ((src >> IM_COL32_A_SHIFT) & 0xFF) * (1.0f / 255.0f) * coverage;
+	float da = ((dst >> IM_COL32_A_SHIFT) & 0xFF) * (1.0f / 255.0f);
+	float oa = sa + da * (1.0f - sa);
+	if (oa <= 0.0f)
+	{
+		return 0;
+	}
+	float ws = sa / oa, wd = da * (1.0f - sa) / oa;
+	ImU32 out = (ImU32)(oa * 255.0f + 0.5f) << IM_COL32_A_SHIFT;
+	for (int shift = 0; shift < 24; shift += 8)
+	{
+		float c = ((src >> shift) & 0xFF) * ws + ((dst >> shift) & 0xFF) * wd;
+		out |= (ImU32)(c + 0.5f) << shift;
+	}
+	return out;
+}
+
+static void CpuBlendSpan(ImU32* row, int x0, int x1, float rx0, float rx1, ImU32 col, float cy)
+{
+	for (int x = x0; x < x1; ++x)
+	{
+		float cov = cy * (std::min(x + 1.0f, rx1) - std::max((float)x, rx0));
+		row[x] = BlendOver(row[x], col, cov);
+	}
+}
+
+static void CpuRasterize(void* tile, int size, const ImVec2* mins, const ImVec2* maxs, const ImU32* colors, int count)
+{
+	ImU32* px = ((CpuTile*)tile)->pixels.data();
+	std::fill(px, px + size * size, 0u);
+	float lim = (float)size;
+	for (int i = 0; i < count; ++i)
+	{
+		float x0 = std::max(mins[i].x, 0.0f), x1 = std::min(maxs[i].x, lim);
+		float y0 = std::max(mins[i].y, 0.0f), y1 = std::min(maxs[i].y, lim);
+		if (!(x0 < x1 && y0 < y1))
+		{
+			continue;
+		}
+		ImU32 col = colors[i];
+		bool opaque = (col >> IM_COL32_A_SHIFT) == 0xFF;
+		int px0 = (int)x0, px1 = std::min((int)std::ceil(x1), size);
+		int py0 = (int)y0, py1 = std::min((int)std::ceil(y1), size);
+		// Fully covered columns [ix0, ix1); only the pixels outside them need coverage math.
+		int ix0 = std::min((int)std::ceil(x0), px1), ix1 = std::max((int)x1, ix0);
+		for (int y = py0; y < py1; ++y)
+		{
+			float cy = std::min(y + 1.0f, y1) - std::max((float)y, y0);
+			ImU32* row = px + y * size;
+			if (cy < 1.0f || !opaque)
+			{
+				CpuBlendSpan(row, px0, px1, x0, x1, col, cy);
+				continue;
+			}
+			CpuBlendSpan(row, px0, ix0, x0, x1, col, 1.0f);
+			std::fill(row + ix0, row + ix1, col);
+			CpuBlendSpan(row, ix1, px1, x0, x1, col, 1.0f);
+		}
+	}
+}
+
+static ImTextureID CpuTexture(void* tile)
+{
+	// Never sampled: headless runs submit through a null renderer.
+	return (ImTextureID)(uintptr_t)tile;
+}
+
+static const LayerCacheBackend cpuBackend = { "CPU", CpuCreate, CpuDestroy, CpuRasterize, CpuTexture, false, nullptr };
+
+const LayerCacheBackend* LayerCacheCpuBackend()
+{
+	return &cpuBackend;
+}
+
+bool LayerCachePending()
+{
+	return pending;
+}
+
+LayerCacheStats LayerCacheGetStats()
+{
+	return stats;
+}
+
+void DrawLayerCacheUI()
+{
+	if (!ImGui::CollapsingHeader("Layer Cache"))
+	{
+		return;
+	}
+	if (!backend)
+	{
+		ImGui::TextDisabled("No raster backend");
+		return;
+	}
+	if (ImGui::Checkbox("Cache static objects", &userEnabled))
+	{
+		LayerCacheInvalidateAll();
+	}
+	ImGui::Text("Backend: %s, %d px tiles", backend->name, kLayerTilePixels);
+	ImGui::Text("Tiles: %d allocated, %d visible, %d redrawn", stats.tiles, stats.visible, stats.rasterized);
+	ImGui::Text("Frames drawn without cache: %d", stats.fallbackFrames);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "imgui.h"
+
+// Raster cache for the Scene view's static content. The world is cut into
+// square tiles of kLayerTilePixels screen pixels at the zoom they were drawn
+// at; panning reuses tiles and only invalidated ones are redrawn. A zoom
+// change redraws everything, once the zoom has held still for a moment.
+// Rasterization goes through a backend: an FBO in the editor, a CPU
+// framebuffer in headless benchmarks.
+
+static const int kLayerTilePixels = 256;
+
+struct LayerCacheBackend {
+	const char* name;
+	void* (*create)(int size);
+	void (*destroy)(void* tile);
+	// Clears the tile, then draws the rects in order. Coordinates are tile-local pixels.
+	void (*rasterize)(void* tile, int size, const ImVec2* mins, const ImVec2* maxs, const ImU32* colors, int count);
+	ImTextureID (*texture)(void* tile);
+	bool flipY; // rows are stored bottom-up (GL render targets)
+	// Draw-list callback that switches to premultiplied blending, for
+	// backends whose tiles come out premultiplied; nullptr for straight alpha.
+	// Render state is reset after the tiles.
+	ImDrawCallback premultipliedBlend;
+};
+
+// Fills tile-local rects for everything cached inside the world rect
+// [x0, x1) x [y0, y1) drawn at the given zoom. Arrays come from the frame arena.
+typedef int (*LayerGatherFn)(float x0, float y0, float x1, float y1, float zoom,
+	ImVec2** mins, ImVec2** maxs, ImU32** colors);
+
+// nullptr (the default) disables the cache. Switching backends drops all tiles.
+void LayerCacheSetBackend(const LayerCacheBackend* backend);
+const LayerCacheBackend* LayerCacheCpuBackend();
+// Renders tiles into textures through the ImGui OpenGL3 backend. Lives in
+// layer_cache_gl.cpp, which headless builds leave out; needs a current context.
+const LayerCacheBackend* LayerCacheGLBackend();
+bool LayerCacheEnabled();
+void LayerCacheShutdown();
+
+void LayerCacheInvalidateAll();
+void LayerCacheInvalidateRect(float x0, float y0, float x1, float y1);
+
+// Brings the tiles under the view up to date, within a per-frame raster
+// budget, and draws them as images. Returns false without drawing anything
+// if some visible tile is still missing; the caller then draws the content
+// directly for this frame.
+bool LayerCacheDraw(ImDrawList* draw, ImVec2 p0, ImVec2 avail, ImVec2 pan, float zoom, LayerGatherFn gather);
+// True when the last LayerCacheDraw fell back but a later one will not: tiles
+// are still being filled or the zoom is settling. The caller keeps frames
+// coming (RedrawSchedulerRequest) until it clears.
+bool LayerCachePending();
+
+struct LayerCacheStats {
+	int tiles;          // allocated
+	int visible;        // under the view last frame
+	int rasterized;     // redrawn last frame
+	int fallbackFrames; // frames drawn without the cache since start
+};
+
+LayerCacheStats LayerCacheGetStats();
+void DrawLayerCacheUI();
@@ -0,0 +1,102 @@
+#include "layer_cache.h"
+
+#include <cstdint>
+#include <glad/glad.h>
+
+#include "imgui_impl_opengl3.h"
+#include "draw_batch.h"
+
+// Each tile is a texture with its own FBO. The rects go through a scratch
+// ImDrawList and the regular OpenGL3 backend, so tiles come out exactly as
+// the direct path would draw them. FBO content is bottom-up, hence flipY.
+// The backend blends color with SRC_ALPHA and alpha with ONE, so over a
+// transparent clear the tile ends up premultiplied and is composited that way.
+
+struct GLTile {
+	GLuint fbo;
+	GLuint texture;
+};
+
+static void* GLCreate(int size)
+{
+	GLTile* t = new GLTile();
+	GLint lastTexture = 0, lastFbo = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &lastTexture);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &lastFbo);
+
+	glGenTextures(1, &t->texture);
+	glBindTexture(GL_TEXTURE_2D, t->texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenFramebuffers(1, &t->fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, t->fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, t->texture, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)lastFbo);
+	glBindTexture(GL_TEXTURE_2D, (GLuint)lastTexture);
+	return t;
+}
+
+static void GLDestroy(void* tile)
+{
+	GLTile* t = (GLTile*)tile;
+	glDeleteFramebuffers(1, &t->fbo);
+	glDeleteTextures(1, &t->texture);
+	delete t;
+}
+
+static void GLRasterize(void* tile, int size, const ImVec2* mins, const ImVec2* maxs, const ImU32* colors, int count)
+{
+	GLTile* t = (GLTile*)tile;
+	ImDrawList list(ImGui::GetDrawListSharedData());
+	list._ResetForNewFrame();
+	list.Flags = ImDrawListFlags_AllowVtxOffset;
+	list.PushClipRect(ImVec2(0.0f, 0.0f), ImVec2((float)size, (float)size));
+	list.PushTexture(ImGui::GetIO().Fonts->TexRef);
+	AddRectFilledBatch(&list, mins, maxs, colors, count);
+
+	ImDrawData data;
+	data.Valid = true;
+	data.CmdListsCount = 1;
+	data.CmdLists.push_back(&list);
+	data.TotalVtxCount = list.VtxBuffer.Size;
+	data.TotalIdxCount = list.IdxBuffer.Size;
+	data.DisplayPos = ImVec2(0.0f, 0.0f);
+	data.DisplaySize = ImVec2((float)size, (float)size);
+	data.FramebufferScale = ImVec2(1.0f, 1.0f);
+	// Tiles can be drawn before the first main pass has uploaded the font atlas
+	// (whose white pixel every rect samples), so let this pass do the uploads too.
+	data.Textures = &ImGui::GetPlatformIO().Textures;
+
+	GLint lastFbo = 0;
+	GLfloat lastClear[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &lastFbo);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, lastClear);
+	glBindFramebuffer(GL_FRAMEBUFFER, t->fbo);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	ImGui_ImplOpenGL3_RenderDrawData(&data);
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)lastFbo);
+	glClearColor(lastClear[0], lastClear[1], lastClear[2], lastClear[3]);
+}
+
+static ImTextureID GLTexture(void* tile)
+{
+	return (ImTextureID)(intptr_t)((GLTile*)tile)->texture;
+}
+
+static void GLPremultipliedBlend(const ImDrawList*, const ImDrawCmd*)
+{
+	glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+static const LayerCacheBackend glBackend = { "OpenGL FBO", GLCreate, GLDestroy, GLRasterize, GLTexture, true, GLPremultipliedBlend };
+
+const LayerCacheBackend* LayerCacheGLBackend()
+{
+	return &glBackend;
+}
@@ -4,16 +4,68 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include "main.h"
-
-static std::vector<std::string> logs;
+#include "profiler.h"
+#include "gpu_timer.h"
+#include "frame_stats.h"
+#include "trace.h"
+#include "alloc_tracker.h"
+#include "frame_arena.h"
+#include "pool_alloc.h"
+#include "scene.h"
+#include "hit_test.h"
+#include "layer_cache.h"
+#include "redraw_scheduler.h"
+#include "frame_pacer.h"
+#include "input_latency.h"
+#include "render_thread.h"
+#include "texture_atlas.h"
+#include "texture_stream.h"
+#include "scene_file.h"
+#include "scene_text.h"
+#include "scene_journal.h"
+#include "undo_history.h"
+
+static bool useImGuiPool = true;
+
+// Fixed ring of log lines so logging never touches the heap; the oldest line is dropped when full.
+static const int kMaxLogLines = 512;
+static const int kMaxLogLineLength = 128;
+static char logLines[kMaxLogLines][kMaxLogLineLength];
+static int logHead = 0;
+static int logCount = 0;
+
+void AddLog(const char* line)
+{
+	TraceLog(line);
+	int slot = (logHead + logCount) % kMaxLogLines;
+	if (logCount == kMaxLogLines)
+	{
+		logHead = (logHead + 1) % kMaxLogLines;
+	}
+	else
+	{
+		++logCount;
+	}
+	snprintf(logLines[slot], kMaxLogLineLength, "%s", line);
+	// The log window scrolls to the new line one frame after it appears.
+	RedrawSchedulerRequest(2);
+}
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-	glViewport(0, 0, width, height);
+	// With the render thread running the context is not current here.
+	if (glfwGetCurrentContext() == window)
+	{
+		glViewport(0, 0, width, height);
+	}
 }
 
 bool InitGLFW(GLFWwindow** window)
@@ -58,6 +110,14 @@ void InitImGui(GLFWwindow* window)
 	const char* glsl_version = "#version 330";
 	//IMGUI ʱȭ
 	IMGUI_CHECKVERSION();
+	if (useImGuiPool)
+	{
+		AllocTrackerInstallImGuiHooks(PoolAlloc, PoolFree, PoolBlockSize);
+	}
+	else
+	{
+		AllocTrackerInstallImGuiHooks();
+	}
 	//ImGUI /λ¸ ϱ   (context)  - ư , 콺 ġ  پ   
 	ImGui::CreateContext();
 	//ǵ  ʴ  
@@ -72,11 +132,31 @@ void ShutdownImGui()
 {
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
+	AtlasShutdown();
 	ImGui::DestroyContext();
 }
 
+// A shaded ball, so the scene starts with a sprite in it.
+static int MakeDemoSprite()
+{
+	const int size = 64;
+	std::vector<ImU32> pixels(size * size);
+	for (int y = 0; y < size; ++y)
+	{
+		for (int x = 0; x < size; ++x)
+		{
+			float dx = (x + 0.5f) / size * 2.0f - 1.0f, dy = (y + 0.5f) / size * 2.0f - 1.0f;
+			float edge = std::min(std::max((1.0f - std::sqrt(dx * dx + dy * dy)) * size * 0.5f, 0.0f), 1.0f);
+			float shade = std::min(std::max(0.75f - 0.35f * (dx + dy), 0.0f), 1.0f);
+			pixels[y * size + x] = IM_COL32(255 * shade, 255 * shade, 255 * shade, 255 * edge);
+		}
+	}
+	return AtlasAddImage(pixels.data(), size, size);
+}
+
 void DrawColorPicker(float*  bgColor)
 {
+	PROFILE_FUNCTION();
 
 	ImGui::Begin("Background Color");
 	ImGui::ColorEdit3("", bgColor);
@@ -85,35 +165,57 @@ void DrawColorPicker(float*  bgColor)
 
 void DrawPerfStats(float deltaTime)
 {
+	PROFILE_FUNCTION();
 	ImGui::Begin("Performance");
-	float fps = 1.0f / deltaTime;
+	FrameStatsSummary stats = FrameStatsGetSummary();
+	float fps = stats.avgMs > 0.0 ? float(1000.0 / stats.avgMs) : 0.0f;
 	float frameTimeMs = deltaTime * 1000.0f;
 	ImGui::Text("FPS: %.1f", fps);
 	ImGui::Text("Frame Time: %.2f ms", frameTimeMs);
+	DrawFrameStatsUI();
+	DrawProfilerUI();
+	DrawGpuTimerUI();
+	DrawAllocTrackerUI();
+	DrawFrameArenaUI();
+	DrawHitTestUI();
+	DrawLayerCacheUI();
+	DrawRedrawSchedulerUI();
+	DrawFramePacerUI();
+	DrawInputLatencyUI();
+	DrawRenderThreadUI();
+	DrawTextureAtlasUI();
+	DrawTextureStreamUI();
+	if (useImGuiPool)
+	{
+		DrawPoolAllocUI();
+	}
 	ImGui::End();
 }
 
 void DrawLogWindow()
 {
+	PROFILE_FUNCTION();
+	ALLOC_TAG("Log Window");
 	ImGui::Begin("Log");
 
 	if (ImGui::Button("Click to Log"))
 	{
 		float now = glfwGetTime();
-		logs.push_back("Clicked at " + std::to_string(now) + "s");
+		AddLog(FrameFormat("Clicked at %fs", now));
 	}
 
 	ImGui::SameLine();
 	if (ImGui::Button("Clear"))
 	{
-		logs.clear();
+		logHead = 0;
+		logCount = 0;
 	}
 
 	ImGui::BeginChild("LogRegion", ImVec2(0, 200), true, ImGuiWindowFlags_HorizontalScrollbar);
 
-	for (const auto& line : logs)
+	for (int i = 0; i < logCount; ++i)
 	{
-		ImGui::TextUnformatted(line.c_str());
+		ImGui::TextUnformatted(logLines[(logHead + i) % kMaxLogLines]);
 	}
 
 	if (ImGui::GetScrollY() >= ImGui::GetScrollMaxY())
@@ -127,6 +229,8 @@ void DrawLogWindow()
 
 void DrawMouseDebug(GLFWwindow* window)
 {
+	PROFILE_FUNCTION();
+	ALLOC_TAG("Mouse Debug");
 	ImGui::Begin("Mouse Debug");
 
 	//ImGui ǥ 
@@ -146,11 +250,11 @@ void DrawMouseDebug(GLFWwindow* window)
 
 	if (ImGui::IsMouseClicked(ImGuiMouseButton_Left))
 	{
-		logs.push_back("Left Click at ("+std::to_string(mousePos.x)+", " + std::to_string(mousePos.y)+")");
+		AddLog(FrameFormat("Left Click at (%f, %f)", mousePos.x, mousePos.y));
 	}
 	if (ImGui::IsMouseClicked(ImGuiMouseButton_Right))
 	{
-		logs.push_back("Right Click at (" + std::to_string(mousePos.x) + ", " + std::to_string(mousePos.y) + ")");
+		AddLog(FrameFormat("Right Click at (%f, %f)", mousePos.x, mousePos.y));
 	}
 
 
@@ -161,9 +265,11 @@ static bool lastKeyState[1024] = { false };
 
 void DrawKeyDebug(GLFWwindow* window)
 {
+	PROFILE_FUNCTION();
+	ALLOC_TAG("Keyboard Debug");
 	ImGui::Begin("Keyboard Debug");
 
-	struct {
+	static const struct {
 		int key;
 		const char* name;
 	} keys[] = {
@@ -174,7 +280,7 @@ void DrawKeyDebug(GLFWwindow* window)
 		{ GLFW_KEY_ESCAPE, "ESC" }
 	};
 
-	for (auto& k : keys)
+	for (const auto& k : keys)
 	{
 		int state = glfwGetKey(window, k.key);
 
@@ -187,143 +293,215 @@ void DrawKeyDebug(GLFWwindow* window)
 
 		if (state == GLFW_PRESS && !lastKeyState[k.key])
 		{
-			logs.push_back(std::string(k.name) + " Pressed");
+			AddLog(FrameFormat("%s Pressed", k.name));
 		}
 		if (state == GLFW_RELEASE && lastKeyState[k.key])
 		{
-			logs.push_back(std::string(k.name) + " Released");
+			AddLog(FrameFormat("%s Released", k.name));
 		}
 		lastKeyState[k.key] = (state == GLFW_PRESS);
 	}
 	ImGui::End();
 }
 
-struct Rect {
-	float x, y, w, h;
-	ImVec4 color;
-};
-
-static std::vector<Rect> objects;
-static int selectedIndex = -1;
-static ImVec2 dragOffset;
-
-inline float Clamp(float v, float min, float max) {
-	return v < min ? min : (v > max ? max : v);
-}
-
-void DrawInspector()
-{
-	if (selectedIndex < 0) return;
-
-	auto& R = objects[selectedIndex];
-	ImGui::Begin("Inspector");
-
-	ImGui::DragFloat("X", &R.x, 1.0f, 0.0f, ImGui::GetWindowWidth() - R.w);
-	ImGui::DragFloat("Y", &R.y, 1.0f, 0.0f, ImGui::GetWindowHeight() - R.h);
-
-	ImGui::DragFloat("Width", &R.w, 1.0f, 1.0f, 100);
-	ImGui::DragFloat("Height", &R.h, 1.0f, 1.0f, 100);
-
-	ImGui::ColorEdit4("Color", (float*)&R.color);
-	ImGui::End();
-}
-static bool playMode = false;
-
-void DrawSceneView(GLFWwindow* window)
-{
-	ImGui::Begin("Scene", nullptr, ImGuiWindowFlags_NoMove);
-
-
-	ImVec2 p0 = ImGui::GetCursorScreenPos();
-	ImVec2 avail = ImGui::GetContentRegionAvail();
-	ImDrawList* draw = ImGui::GetWindowDrawList();
-
-	draw->AddRectFilled(p0, ImVec2(p0.x + avail.x, p0.y + avail.y),
-		IM_COL32(50, 50, 50, 255));
-	if (!playMode)
+int main(int argc, char** argv) {
+	const char* frameStatsPath = nullptr;
+	const char* tracePath = "mouse_trace.json";
+	int traceFrames = 300;
+	bool traceAtStartup = false;
+	bool failOnAlloc = false;
+	bool alwaysRedraw = false;
+	double fpsCap = 0.0;
+	bool lateInput = false;
+	std::vector<const char*> texturePaths;
+	const char* scenePath = nullptr;
+	const char* journalPath = "mouse_autosave.mjnl";
+	for (int i = 1; i < argc; ++i)
 	{
-		if (ImGui::IsWindowHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+		if (strcmp(argv[i], "--frame-stats") == 0 && i + 1 < argc)
 		{
-			ImVec2 mp = ImGui::GetMousePos();
-			float lx = mp.x - p0.x, ly = mp.y - p0.y;
-
-			selectedIndex = -1;
-			for (int i = int(objects.size()) - 1; i >= 0; --i)
-			{
-				auto& R = objects[i];
-				if (lx >= R.x && lx <= R.x + R.w
-					&& ly >= R.y && ly <= R.y + R.h)
-				{
-					selectedIndex = i;
-					dragOffset = ImVec2(lx - R.x, ly - R.y);
-					break;
-				}
-			}
+			frameStatsPath = argv[++i];
 		}
-
-		if (selectedIndex >= 0
-			&& ImGui::IsWindowHovered()
-			&& ImGui::IsMouseDown(ImGuiMouseButton_Left))
+		else if (strcmp(argv[i], "--hitch-budget") == 0 && i + 1 < argc)
 		{
-			ImVec2 mp = ImGui::GetMousePos();
-			float nx = (mp.x - p0.x) - dragOffset.x;
-			float ny = (mp.y - p0.y) - dragOffset.y;
-
-			nx = Clamp(nx, 0.0f, avail.x - objects[selectedIndex].w);
-			ny = Clamp(ny, 0.0f, avail.y - objects[selectedIndex].h);
-			objects[selectedIndex].x = nx;
-			objects[selectedIndex].y = ny;
+			FrameStatsSetHitchBudget(atof(argv[++i]));
 		}
-	}
-
-	for (int i = 0; i < (int)objects.size(); ++i)
-	{
-		auto& R = objects[i];
-		ImVec2 a = ImVec2(p0.x + R.x, p0.y + R.y);
-		ImVec2 b = ImVec2(p0.x + R.x+ R.w, p0.y + R.y+ R.h);
-		ImU32 fill = ImGui::GetColorU32(R.color);
-		draw->AddRectFilled(a, b, fill);
-
-		if (i==selectedIndex)
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			tracePath = argv[++i];
+			traceAtStartup = true;
+		}
+		else if (strcmp(argv[i], "--trace-frames") == 0 && i + 1 < argc)
+		{
+			traceFrames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--fail-on-alloc") == 0 && i + 1 < argc)
+		{
+			// Frames after the warmup must not touch the heap.
+			AllocTrackerEnableSteadyStateCheck(atoi(argv[++i]));
+			failOnAlloc = true;
+		}
+		else if (strcmp(argv[i], "--no-imgui-pool") == 0)
+		{
+			useImGuiPool = false;
+		}
+		else if (strcmp(argv[i], "--always-redraw") == 0)
+		{
+			// Frame-time captures want every frame, not just the ones with changes.
+			alwaysRedraw = true;
+		}
+		else if (strcmp(argv[i], "--fps-cap") == 0 && i + 1 < argc)
+		{
+			fpsCap = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--late-input") == 0)
+		{
+			lateInput = true;
+		}
+		else if (strcmp(argv[i], "--render-thread") == 0)
+		{
+			RenderThreadSetWanted(true);
+		}
+		else if (strcmp(argv[i], "--texture") == 0 && i + 1 < argc)
+		{
+			texturePaths.push_back(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+		{
+			scenePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc)
+		{
+			journalPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--no-journal") == 0)
+		{
+			journalPath = nullptr;
+		}
+		else if (strcmp(argv[i], "--undo-budget") == 0 && i + 1 < argc)
 		{
-			draw->AddRect(a, b, IM_COL32(255, 255, 0, 255), 2.0f);
+			UndoSetMemoryBudget((size_t)atoi(argv[++i]) << 20);
 		}
 	}
-	ImGui::End();
-}
 
-int main() {
 	GLFWwindow* window = nullptr;
 	if(!InitGLFW(&window) || !InitGLAD())
 	{
 		return -1;
 	}
+	InputLatencyInit(window);
 	InitImGui(window);
+	RedrawSchedulerInit(window);
+	RedrawSchedulerSetEnabled(!alwaysRedraw);
+	FramePacerInit(window);
+	FramePacerSetTargetHz(fpsCap);
+	FramePacerSetLateInput(lateInput);
+	ProfilerInit();
+	GpuTimerInit();
+	LayerCacheSetBackend(LayerCacheGLBackend());
+	TextureStreamInit(0);
+	for (const char* path : texturePaths)
+	{
+		TextureStreamLoad(path);
+	}
+	FrameArenaInit(256 * 1024);
+	if (traceAtStartup && !TraceStartCapture(tracePath, traceFrames))
+	{
+		std::cerr << "Failed to open trace file " << tracePath << std::endl;
+	}
 
 	static float bgColor[3] = { 0.2f, 0.3f, 0.4f };
 
 	float deltaTime = 0.0f;
 	float lastFrame = 0.0f;
 
-	objects.push_back({ 50,  60, 80, 80, ImVec4(1,0,0,1) });
-	objects.push_back({ 200, 150,100,60, ImVec4(0,1,0,1) });
-	objects.push_back({ 400, 300, 60,90, ImVec4(0,0,1,1) });
+	const char* sceneError = nullptr;
+	if (scenePath && !(SceneTextMatchesPath(scenePath) ? SceneTextLoad(scenePath, &sceneError) : SceneFileLoad(scenePath, &sceneError)))
+	{
+		std::cerr << "Failed to load scene " << scenePath << ": " << sceneError << std::endl;
+		scenePath = nullptr;
+	}
+	if (!scenePath)
+	{
+		objects.push_back({ 50,  60, 80, 80, ImVec4(1,0,0,1) });
+		objects.push_back({ 200, 150,100,60, ImVec4(0,1,0,1) });
+		objects.push_back({ 400, 300, 60,90, ImVec4(0,0,1,1) });
+		objects.push_back({ 550, 120, 64,64, ImVec4(1,0.8f,0.3f,1), MakeDemoSprite() });
+	}
+	// A journal left behind means the last session crashed; its edits win.
+	SceneJournalRecovery recovery = journalPath ? SceneJournalInit(journalPath, scenePath) : SceneJournalRecovery_None;
+	if (recovery == SceneJournalRecovery_Replayed)
+	{
+		AddLog(FrameFormat("Recovered %d objects from %s", (int)objects.size(), journalPath));
+	}
+	else if (recovery == SceneJournalRecovery_SetAside)
+	{
+		AddLog(FrameFormat("%s belongs to another scene, kept as %s.stale", journalPath, journalPath));
+	}
 
 	//  
 	while (!glfwWindowShouldClose(window))
 	{
+		// With the render thread running, GL belongs to it: this thread only
+		// builds the frame and hands the draw data over.
+		bool pipelined = RenderThreadRunning();
+		if (!pipelined)
+		{
+			FramePacerBeginFrame();
+		}
+		// Time spent blocked while idle is not part of any frame.
+		double idleTime = RedrawSchedulerWaitEvents();
+		if (idleTime > 0.0)
+		{
+			FramePacerResync();
+		}
 		float currentFrame = glfwGetTime();
-		deltaTime = currentFrame - lastFrame;
+		deltaTime = currentFrame - lastFrame - (float)idleTime;
 		lastFrame = currentFrame;
+		FrameArenaReset();
+		FrameStatsRecord(deltaTime);
+		ProfilerBeginFrame();
+		AllocTrackerBeginFrame();
+		TraceBeginFrame();
+		{
+			PROFILE_SCOPE("glfwPollEvents");
+			glfwPollEvents();
+		}
+		if (!pipelined)
+		{
+			GpuTimerBeginFrame();
+			{
+				PROFILE_SCOPE("glClear");
+				GPU_SCOPE("glClear");
+				glClearColor(bgColor[0], bgColor[1], bgColor[2], 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT);
+			}
+		}
 
-		glClearColor(bgColor[0], bgColor[1], bgColor[2], 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT);
-
-		glfwPollEvents();
+		{
+			PROFILE_SCOPE("NewFrame");
+			if (!pipelined)
+			{
+				ImGui_ImplOpenGL3_NewFrame();
+			}
+			ImGui_ImplGlfw_NewFrame();
+			ImGui::NewFrame();
+		}
+		int latencyFrame = InputLatencyBeginFrame();
+		// Streamed textures land a band at a time; keep frames coming until they are in.
+		if (TextureStreamBusy())
+		{
+			RedrawSchedulerRequest();
+		}
 
-		ImGui_ImplOpenGL3_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
-		ImGui::NewFrame();
+		// F9 captures the next traceFrames frames.
+		if (ImGui::IsKeyPressed(ImGuiKey_F9, false) && !TraceIsCapturing())
+		{
+			if (TraceStartCapture(tracePath, traceFrames))
+			{
+				AddLog(FrameFormat("Trace capture started: %s", tracePath));
+			}
+		}
 
 		ImGui::Begin("Control", nullptr,
 			ImGuiWindowFlags_NoTitleBar |
@@ -333,6 +511,9 @@ int main() {
 		{
 			playMode = !playMode;
 		}
+		DrawSceneFileUI();
+		DrawSceneJournalUI();
+		DrawUndoUI();
 		ImGui::End();
 
 		DrawColorPicker(bgColor);
@@ -343,29 +524,103 @@ int main() {
 
 		if (playMode)
 		{
-			ImVec2 p0 = ImGui::GetCursorScreenPos();
-			ImVec2 avail = ImGui::GetContentRegionAvail();
-			for (auto& R : objects)
-			{
-				R.y += 25.0f * deltaTime;
-				R.y = Clamp(R.y, 0.0f, avail.y - R.h);
-			}
+			UpdateScene(deltaTime, ImGui::GetContentRegionAvail());
 
-			DrawSceneView(window);
+			DrawSceneView();
 		}
 		else
 		{
-			DrawSceneView(window);
+			DrawSceneView();
 			DrawInspector();
 		}
+		SceneJournalPump();
+		// Likewise while the layer cache is filling or waiting for the zoom to settle.
+		if (LayerCachePending())
+		{
+			RedrawSchedulerRequest();
+		}
+		InputLatencyMark(latencyFrame, LatencyStage_Update);
+
 
+		{
+			PROFILE_SCOPE("ImGui::Render");
+			ImGui::Render();
+		}
+		InputLatencyMark(latencyFrame, LatencyStage_Render);
+		RedrawSchedulerEndFrame(playMode || TraceIsCapturing());
+		if (TraceIsCapturing())
+		{
+			ImDrawData* drawData = ImGui::GetDrawData();
+			int drawCalls = 0;
+			for (ImDrawList* list : drawData->CmdLists)
+			{
+				drawCalls += list->CmdBuffer.Size;
+			}
+			TraceCounter("Objects", (double)objects.size());
+			TraceCounter("Draw Calls", drawCalls);
+			TraceCounter("Vertices", drawData->TotalVtxCount);
+		}
+		if (pipelined)
+		{
+			RenderThreadSubmit(ImGui::GetDrawData(), bgColor, latencyFrame);
+		}
+		else
+		{
+			TextureStreamPump();
+			{
+				PROFILE_SCOPE("RenderDrawData");
+				GPU_SCOPE("RenderDrawData");
+				ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+			}
+			InputLatencyMark(latencyFrame, LatencyStage_Submit);
+			GpuTimerEndFrame();
+			FramePacerEndFrame();
+			{
+				PROFILE_SCOPE("glfwSwapBuffers");
+				glfwSwapBuffers(window);
+			}
+			InputLatencyEndFrame(latencyFrame);
+		}
+		ProfilerEndFrame();
+		AllocTrackerEndFrame();
+		TraceEndFrame();
 
-		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-		glfwSwapBuffers(window);
+		// Switch modes between frames. The GL layer cache creates and draws
+		// tiles while the frame is built, so it only runs single-threaded.
+		if (RenderThreadWanted() != pipelined)
+		{
+			if (pipelined)
+			{
+				RenderThreadStop();
+				LayerCacheSetBackend(LayerCacheGLBackend());
+			}
+			else
+			{
+				LayerCacheSetBackend(nullptr);
+				RenderThreadStart(window);
+			}
+		}
 	}
+	RenderThreadStop();
+	if (frameStatsPath && !FrameStatsWriteJson(frameStatsPath))
+	{
+		std::cerr << "Failed to write frame stats to " << frameStatsPath << std::endl;
+	}
+	TraceStopCapture();
+	SceneJournalShutdown();
+	LayerCacheShutdown();
+	TextureStreamShutdown();
+	InputLatencyShutdown();
+	GpuTimerShutdown();
+	FrameArenaShutdown();
+	FramePacerShutdown();
 	ShutdownImGui();
 	glfwDestroyWindow(window);
 	glfwTerminate();
+	if (failOnAlloc && AllocTrackerGetViolations() > 0)
+	{
+		std::cerr << AllocTrackerGetViolations() << " steady-state frames allocated" << std::endl;
+		return 3;
+	}
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,353 @@
+#include "pool_alloc.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+#include "imgui.h"
+
+static const size_t kSlabSize = 64 * 1024;
+static const size_t kHeaderSize = 16;
+static const int kMaxPoolThreads = 16;
+static const uint32_t kLargeClass = 0xFFFFFFFFu;
+static const uint32_t kClassSizes[kPoolClassCount] = {
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096
+};
+
+struct ThreadPool;
+
+struct BlockHeader {
+	ThreadPool* owner;   // nullptr for large passthrough blocks
+	uint32_t sizeClass;
+	uint32_t requested;
+};
+static_assert(sizeof(BlockHeader) <= kHeaderSize, "block header must fit in kHeaderSize");
+
+struct FreeBlock {
+	FreeBlock* next;
+};
+
+struct Slab {
+	Slab* next;
+};
+
+// Counters are written only by the owning thread; relaxed atomics let the UI read them safely.
+struct SizeClass {
+	FreeBlock* freeList = nullptr;
+	char* carve = nullptr;
+	char* carveEnd = nullptr;
+	std::atomic<unsigned long long> allocs{ 0 };
+	std::atomic<unsigned long long> hits{ 0 };
+	std::atomic<unsigned long long> live{ 0 };
+	std::atomic<size_t> reserved{ 0 };
+	std::atomic<size_t> liveRequested{ 0 };
+};
+
+struct ThreadPool {
+	SizeClass classes[kPoolClassCount];
+	std::atomic<FreeBlock*> remoteFree{ nullptr };
+	Slab* slabs = nullptr;
+	std::atomic<size_t> slabBytes{ 0 };
+	bool inUse = false; // guarded by poolMutex
+};
+
+static ThreadPool* pools[kMaxPoolThreads];
+static std::atomic<int> poolCount{ 0 };
+static std::mutex poolMutex;
+static thread_local ThreadPool* localPool = nullptr;
+static thread_local bool noPool = false; // all pools taken, or the thread is exiting
+
+// Hands the pool to the next thread that needs one when this one exits. The
+// slabs and free lists carry over; blocks still live in the pool are freed
+// into it as remote frees, which the next owner drains.
+struct PoolOwner {
+	ThreadPool* pool = nullptr;
+	~PoolOwner()
+	{
+		if (pool)
+		{
+			std::lock_guard<std::mutex> lock(poolMutex);
+			pool->inUse = false;
+		}
+		localPool = nullptr;
+		noPool = true;
+	}
+};
+static thread_local PoolOwner poolOwner;
+
+static std::atomic<unsigned long long> largeAllocs{ 0 };
+static std::atomic<unsigned long long> largeLive{ 0 };
+static std::atomic<size_t> largeLiveBytes{ 0 };
+
+template <typename T>
+static void Bump(std::atomic<T>& counter, T delta)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+static int ClassOf(size_t size)
+{
+	for (int c = 0; c < kPoolClassCount; ++c)
+	{
+		if (size <= kClassSizes[c])
+		{
+			return c;
+		}
+	}
+	return -1;
+}
+
+static BlockHeader* HeaderOf(void* ptr)
+{
+	return (BlockHeader*)((char*)ptr - kHeaderSize);
+}
+
+// Adopts a pool left by an exited thread, or makes a new one. Past
+// kMaxPoolThreads live threads, the rest allocate like large blocks.
+static ThreadPool* LocalPool()
+{
+	if (localPool || noPool)
+	{
+		return localPool;
+	}
+	std::lock_guard<std::mutex> lock(poolMutex);
+	int count = poolCount.load(std::memory_order_relaxed);
+	ThreadPool* pool = nullptr;
+	for (int i = 0; i < count && !pool; ++i)
+	{
+		pool = pools[i]->inUse ? nullptr : pools[i];
+	}
+	if (!pool && count < kMaxPoolThreads)
+	{
+		void* mem = malloc(sizeof(ThreadPool));
+		if (mem)
+		{
+			pool = new (mem) ThreadPool();
+			pools[count] = pool;
+			poolCount.store(count + 1, std::memory_order_release);
+		}
+	}
+	if (!pool)
+	{
+		noPool = true;
+		return nullptr;
+	}
+	pool->inUse = true;
+	poolOwner.pool = pool;
+	localPool = pool;
+	return pool;
+}
+
+static void ReleaseToClass(ThreadPool* pool, void* ptr)
+{
+	BlockHeader* header = HeaderOf(ptr);
+	SizeClass& sc = pool->classes[header->sizeClass];
+	FreeBlock* block = (FreeBlock*)ptr;
+	block->next = sc.freeList;
+	sc.freeList = block;
+	Bump(sc.live, (unsigned long long)-1);
+	Bump(sc.liveRequested, (size_t)0 - header->requested);
+}
+
+static void DrainRemoteFrees(ThreadPool* pool)
+{
+	FreeBlock* block = pool->remoteFree.exchange(nullptr, std::memory_order_acquire);
+	while (block)
+	{
+		FreeBlock* next = block->next;
+		ReleaseToClass(pool, block);
+		block = next;
+	}
+}
+
+static void* LargeAlloc(size_t size)
+{
+	char* block = (char*)malloc(size + kHeaderSize);
+	if (!block)
+	{
+		return nullptr;
+	}
+	BlockHeader* header = (BlockHeader*)block;
+	header->owner = nullptr;
+	header->sizeClass = kLargeClass;
+	header->requested = (uint32_t)(size > 0xFFFFFFFFu ? 0xFFFFFFFFu : size);
+	largeAllocs.fetch_add(1, std::memory_order_relaxed);
+	largeLive.fetch_add(1, std::memory_order_relaxed);
+	largeLiveBytes.fetch_add(header->requested, std::memory_order_relaxed);
+	return block + kHeaderSize;
+}
+
+void* PoolAlloc(size_t size, void*)
+{
+	int c = ClassOf(size);
+	ThreadPool* pool = c >= 0 ? LocalPool() : nullptr;
+	if (!pool)
+	{
+		return LargeAlloc(size);
+	}
+	if (pool->remoteFree.load(std::memory_order_relaxed))
+	{
+		DrainRemoteFrees(pool);
+	}
+
+	SizeClass& sc = pool->classes[c];
+	char* block;
+	if (sc.freeList)
+	{
+		block = (char*)sc.freeList - kHeaderSize;
+		sc.freeList = sc.freeList->next;
+		Bump(sc.hits, 1ull);
+	}
+	else
+	{
+		size_t stride = kHeaderSize + kClassSizes[c];
+		if (!sc.carve || sc.carve + stride > sc.carveEnd)
+		{
+			char* mem = (char*)malloc(kSlabSize);
+			if (!mem)
+			{
+				return nullptr;
+			}
+			Slab* slab = (Slab*)mem;
+			slab->next = pool->slabs;
+			pool->slabs = slab;
+			sc.carve = mem + kHeaderSize; // keep blocks 16-byte aligned after the slab link
+			sc.carveEnd = mem + kSlabSize;
+			Bump(pool->slabBytes, kSlabSize);
+			Bump(sc.reserved, kSlabSize);
+		}
+		block = sc.carve;
+		sc.carve += stride;
+	}
+
+	BlockHeader* header = (BlockHeader*)block;
+	header->owner = pool;
+	header->sizeClass = (uint32_t)c;
+	header->requested = (uint32_t)size;
+	Bump(sc.allocs, 1ull);
+	Bump(sc.live, 1ull);
+	Bump(sc.liveRequested, size);
+	return block + kHeaderSize;
+}
+
+void PoolFree(void* ptr, void*)
+{
+	if (!ptr)
+	{
+		return;
+	}
+	BlockHeader* header = HeaderOf(ptr);
+	if (header->sizeClass == kLargeClass)
+	{
+		largeLive.fetch_sub(1, std::memory_order_relaxed);
+		largeLiveBytes.fetch_sub(header->requested, std::memory_order_relaxed);
+		free(header);
+		return;
+	}
+
+	ThreadPool* owner = header->owner;
+	if (owner == localPool)
+	{
+		ReleaseToClass(owner, ptr);
+		return;
+	}
+	FreeBlock* block = (FreeBlock*)ptr;
+	block->next = owner->remoteFree.load(std::memory_order_relaxed);
+	while (!owner->remoteFree.compare_exchange_weak(block->next, block, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+}
+
+size_t PoolBlockSize(void* ptr)
+{
+	return HeaderOf(ptr)->requested;
+}
+
+PoolStats PoolGetStats()
+{
+	PoolStats s = {};
+	for (int c = 0; c < kPoolClassCount; ++c)
+	{
+		s.classes[c].blockSize = kClassSizes[c];
+	}
+	int count = poolCount.load(std::memory_order_acquire);
+	s.pools = count;
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		for (int i = 0; i < count; ++i)
+		{
+			s.threads += pools[i]->inUse;
+		}
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		ThreadPool* pool = pools[i];
+		s.slabBytes += pool->slabBytes.load(std::memory_order_relaxed);
+		for (int c = 0; c < kPoolClassCount; ++c)
+		{
+			const SizeClass& sc = pool->classes[c];
+			PoolClassStats& out = s.classes[c];
+			unsigned long long live = sc.live.load(std::memory_order_relaxed);
+			out.allocs += sc.allocs.load(std::memory_order_relaxed);
+			out.hits += sc.hits.load(std::memory_order_relaxed);
+			out.live += live;
+			out.reservedBytes += sc.reserved.load(std::memory_order_relaxed);
+			s.liveRequestedBytes += sc.liveRequested.load(std::memory_order_relaxed);
+			s.liveBlockBytes += (size_t)live * kClassSizes[c];
+		}
+	}
+	s.largeAllocs = largeAllocs.load(std::memory_order_relaxed);
+	s.largeLive = largeLive.load(std::memory_order_relaxed);
+	s.largeLiveBytes = largeLiveBytes.load(std::memory_order_relaxed);
+	return s;
+}
+
+void DrawPoolAllocUI()
+{
+	if (!ImGui::CollapsingHeader("ImGui Pool Allocator"))
+	{
+		return;
+	}
+	PoolStats s = PoolGetStats();
+	unsigned long long allocs = 0, hits = 0;
+	for (const PoolClassStats& c : s.classes)
+	{
+		allocs += c.allocs;
+		hits += c.hits;
+	}
+	// Internal waste: rounding up to the class size. External: carved or free slab space.
+	double internal = s.liveBlockBytes ? 100.0 * (s.liveBlockBytes - s.liveRequestedBytes) / s.liveBlockBytes : 0.0;
+	double external = s.slabBytes ? 100.0 * (s.slabBytes - s.liveBlockBytes) / s.slabBytes : 0.0;
+	ImGui::Text("Slabs: %.1f KB in %d pool(s), %d in use", s.slabBytes / 1024.0, s.pools, s.threads);
+	ImGui::Text("Hit rate: %.1f%% of %llu small allocs", allocs ? 100.0 * hits / allocs : 0.0, allocs);
+	ImGui::Text("Fragmentation: %.1f%% internal, %.1f%% slab", internal, external);
+	ImGui::Text("Large passthrough: %llu allocs, %llu live (%.1f KB)", s.largeAllocs, s.largeLive, s.largeLiveBytes / 1024.0);
+
+	if (ImGui::BeginTable("PoolClasses", 4, ImGuiTableFlags_BordersV | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Class");
+		ImGui::TableSetupColumn("Live");
+		ImGui::TableSetupColumn("Hit %");
+		ImGui::TableSetupColumn("Reserved KB");
+		ImGui::TableHeadersRow();
+		for (const PoolClassStats& c : s.classes)
+		{
+			if (c.allocs == 0)
+			{
+				continue;
+			}
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%zu", c.blockSize);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", c.live);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", 100.0 * c.hits / c.allocs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", c.reservedBytes / 1024.0);
+		}
+		ImGui::EndTable();
+	}
+}
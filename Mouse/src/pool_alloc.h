@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+// Size-class slab allocator with a pool per thread. Blocks up to
+// kPoolMaxBlockSize come from 64 KB slabs with free lists per class; larger
+// requests pass straight through to malloc. A block freed on another thread
+// goes back to its owner through a lock-free remote free list. When a thread
+// exits, its pool passes to the next new thread.
+// Signatures match ImGuiMemAllocFunc/ImGuiMemFreeFunc.
+
+static const int kPoolClassCount = 16;
+static const size_t kPoolMaxBlockSize = 4096;
+
+void* PoolAlloc(size_t size, void* userData = nullptr);
+void PoolFree(void* ptr, void* userData = nullptr);
+// The size ptr was allocated with.
+size_t PoolBlockSize(void* ptr);
+
+struct PoolClassStats {
+	size_t blockSize;
+	unsigned long long allocs;
+	unsigned long long hits;    // served from a free list rather than fresh slab space
+	unsigned long long live;
+	size_t reservedBytes;       // slab space carved for this class
+};
+
+struct PoolStats {
+	PoolClassStats classes[kPoolClassCount];
+	unsigned long long largeAllocs;
+	unsigned long long largeLive;
+	size_t largeLiveBytes;
+	size_t slabBytes;
+	size_t liveRequestedBytes;  // small blocks only
+	size_t liveBlockBytes;      // small blocks rounded up to their class
+	int pools;
+	int threads;                // pools owned by a live thread
+};
+
+PoolStats PoolGetStats();
+void DrawPoolAllocUI();
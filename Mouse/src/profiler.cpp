@@ -0,0 +1,458 @@
+#include "profiler.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+#include "imgui.h"
+#include "alloc_tracker.h"
+
+static const uint32_t kMaxThreads = 16;
+static const uint32_t kZoneBufferSize = 8192; // per thread, power of two
+static const int kHistoryFrames = 120;
+
+// Single producer (the owning thread) / single consumer (ProfilerEndFrame).
+struct ThreadZoneBuffer {
+	ProfileZone zones[kZoneBufferSize];
+	std::atomic<uint32_t> writePos{ 0 };
+	std::atomic<uint32_t> readPos{ 0 };
+	uint32_t dropped = 0;
+	uint32_t index = 0;
+	std::atomic<const char*> name{ nullptr };
+	bool inUse = false; // guarded by registerMutex
+};
+
+struct FrameRecord {
+	uint64_t start = 0;
+	uint64_t end = 0;
+	std::vector<ProfileZone> zones;
+};
+
+static ThreadZoneBuffer* threadBuffers[kMaxThreads];
+static std::atomic<uint32_t> threadCount{ 0 };
+static std::mutex registerMutex;
+static thread_local ThreadZoneBuffer* localBuffer = nullptr;
+static thread_local bool registerFailed = false; // no free slot, or the thread is exiting
+
+// Frees the thread's slot when it exits, so threads that come and go (the
+// render thread restarts on every toggle) do not use up kMaxThreads.
+struct ThreadSlotOwner {
+	ThreadZoneBuffer* buffer = nullptr;
+	~ThreadSlotOwner()
+	{
+		if (buffer)
+		{
+			std::lock_guard<std::mutex> lock(registerMutex);
+			buffer->inUse = false;
+		}
+		localBuffer = nullptr;
+		registerFailed = true;
+	}
+};
+static thread_local ThreadSlotOwner slotOwner;
+#if MOUSE_PROFILER
+thread_local uint32_t profilerDepth = 0;
+#endif
+
+static FrameRecord history[kHistoryFrames];
+static int historyHead = -1;   // most recent completed frame
+static int historyCount = 0;
+static int selectedFrame = -1; // -1 follows the latest frame
+static bool paused = false;
+static uint64_t currentFrameStart = 0;
+
+static uint64_t calibTicks0 = 0;
+static std::chrono::steady_clock::time_point calibTime0;
+static double ticksPerMs = 1.0;
+
+// Takes a free slot, preferring one last used under the same name so a
+// restarted thread keeps its lane. The zone ring carries on where the last
+// owner left it; ProfilerEndFrame drains it either way.
+static ThreadZoneBuffer* RegisterThread(const char* name)
+{
+	if (registerFailed)
+	{
+		return nullptr;
+	}
+	std::lock_guard<std::mutex> lock(registerMutex);
+	uint32_t count = threadCount.load(std::memory_order_relaxed);
+	ThreadZoneBuffer* buf = nullptr;
+	for (uint32_t t = 0; t < count; ++t)
+	{
+		ThreadZoneBuffer* b = threadBuffers[t];
+		const char* last = b->name.load(std::memory_order_relaxed);
+		if (!b->inUse && (!buf || (name && last && strcmp(name, last) == 0)))
+		{
+			buf = b;
+		}
+	}
+	if (!buf && count < kMaxThreads)
+	{
+		buf = new ThreadZoneBuffer();
+		buf->index = count;
+		threadBuffers[count] = buf;
+		threadCount.store(count + 1, std::memory_order_release);
+	}
+	if (!buf)
+	{
+		registerFailed = true;
+		return nullptr;
+	}
+	buf->inUse = true;
+	buf->name.store(name, std::memory_order_relaxed);
+	slotOwner.buffer = buf;
+	localBuffer = buf;
+	return buf;
+}
+
+static void Calibrate()
+{
+	uint64_t ticks = ProfilerNow();
+	auto now = std::chrono::steady_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(now - calibTime0).count();
+	if (ms > 1.0)
+	{
+		ticksPerMs = double(ticks - calibTicks0) / ms;
+	}
+}
+
+void ProfilerInit()
+{
+	calibTicks0 = ProfilerNow();
+	calibTime0 = std::chrono::steady_clock::now();
+	// Spin briefly for a first estimate; every ProfilerEndFrame refines it.
+	while (std::chrono::steady_clock::now() - calibTime0 < std::chrono::milliseconds(2))
+	{
+	}
+	Calibrate();
+	for (auto& frame : history)
+	{
+		frame.zones.reserve(256);
+	}
+	ProfilerSetThreadName("Main");
+}
+
+double ProfilerTicksToMs(uint64_t ticks)
+{
+	return double(ticks) / ticksPerMs;
+}
+
+void ProfilerSetThreadName(const char* name)
+{
+	if (localBuffer)
+	{
+		localBuffer->name.store(name, std::memory_order_relaxed);
+	}
+	else
+	{
+		RegisterThread(name);
+	}
+}
+
+const char* ProfilerGetThreadName(uint32_t thread)
+{
+	const char* name = thread < threadCount.load(std::memory_order_acquire) ? threadBuffers[thread]->name.load(std::memory_order_relaxed) : nullptr;
+	return name ? name : "Thread";
+}
+
+uint32_t ProfilerGetThreadCount()
+{
+	return threadCount.load(std::memory_order_acquire);
+}
+
+#if MOUSE_PROFILER
+void ProfilerRecordZone(const char* name, uint64_t start, uint64_t end, uint32_t depth)
+{
+	ThreadZoneBuffer* buf = localBuffer ? localBuffer : RegisterThread(nullptr);
+	if (!buf)
+	{
+		return;
+	}
+	uint32_t w = buf->writePos.load(std::memory_order_relaxed);
+	if (w - buf->readPos.load(std::memory_order_acquire) >= kZoneBufferSize)
+	{
+		++buf->dropped;
+		return;
+	}
+	ProfileZone& z = buf->zones[w & (kZoneBufferSize - 1)];
+	z.name = name;
+	z.start = start;
+	z.end = end;
+	z.depth = depth;
+	z.thread = buf->index;
+	buf->writePos.store(w + 1, std::memory_order_release);
+}
+#endif
+
+void ProfilerBeginFrame()
+{
+	currentFrameStart = ProfilerNow();
+}
+
+void ProfilerEndFrame()
+{
+	uint64_t frameEnd = ProfilerNow();
+	Calibrate();
+
+	ALLOC_TAG("Profiler");
+	FrameRecord* frame = nullptr;
+	if (!paused)
+	{
+		historyHead = (historyHead + 1) % kHistoryFrames;
+		historyCount = std::min(historyCount + 1, kHistoryFrames);
+		frame = &history[historyHead];
+		frame->start = currentFrameStart;
+		frame->end = frameEnd;
+		frame->zones.clear();
+	}
+
+	// Always drain, so a paused profiler does not make producers drop zones.
+	uint32_t count = threadCount.load(std::memory_order_acquire);
+	for (uint32_t t = 0; t < count; ++t)
+	{
+		ThreadZoneBuffer* buf = threadBuffers[t];
+		uint32_t r = buf->readPos.load(std::memory_order_relaxed);
+		uint32_t w = buf->writePos.load(std::memory_order_acquire);
+		if (frame)
+		{
+			for (; r != w; ++r)
+			{
+				frame->zones.push_back(buf->zones[r & (kZoneBufferSize - 1)]);
+			}
+		}
+		buf->readPos.store(w, std::memory_order_release);
+	}
+
+	if (frame)
+	{
+		// Zones are recorded when they close (children first); reorder into a pre-order walk.
+		std::sort(frame->zones.begin(), frame->zones.end(), [](const ProfileZone& a, const ProfileZone& b) {
+			if (a.thread != b.thread) return a.thread < b.thread;
+			if (a.start != b.start) return a.start < b.start;
+			return a.depth < b.depth;
+		});
+	}
+}
+
+const ProfileZone* ProfilerGetLastFrame(int* count, uint64_t* frameStart, uint64_t* frameEnd)
+{
+	if (historyHead < 0)
+	{
+		*count = 0;
+		return nullptr;
+	}
+	const FrameRecord& frame = history[historyHead];
+	*count = (int)frame.zones.size();
+	if (frameStart) *frameStart = frame.start;
+	if (frameEnd) *frameEnd = frame.end;
+	return frame.zones.data();
+}
+
+static ImU32 ZoneColor(const char* name)
+{
+	// Hash the pointer so the same zone keeps its color across frames.
+	uint32_t h = (uint32_t)((uintptr_t)name * 2654435761u);
+	float hue = float(h >> 8 & 0xFFFF) / 65535.0f;
+	float r, g, b;
+	ImGui::ColorConvertHSVtoRGB(hue, 0.55f, 0.85f, r, g, b);
+	return ImGui::GetColorU32(ImVec4(r, g, b, 1.0f));
+}
+
+static void DrawZoneRows(const ProfileZone* zones, int count, int& i, double frameMs)
+{
+	const ProfileZone& z = zones[i];
+	bool hasChildren = i + 1 < count && zones[i + 1].thread == z.thread && zones[i + 1].depth > z.depth;
+	double ms = ProfilerTicksToMs(z.end - z.start);
+
+	ImGui::TableNextRow();
+	ImGui::TableNextColumn();
+	ImGui::PushID(i);
+	ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_DefaultOpen;
+	if (!hasChildren)
+	{
+		flags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+	}
+	bool open = ImGui::TreeNodeEx(z.name, flags);
+	ImGui::PopID();
+	ImGui::TableNextColumn();
+	ImGui::Text("%.3f", ms);
+	ImGui::TableNextColumn();
+	ImGui::Text("%.1f%%", frameMs > 0.0 ? ms * 100.0 / frameMs : 0.0);
+
+	++i;
+	if (!hasChildren)
+	{
+		return;
+	}
+	while (i < count && zones[i].thread == z.thread && zones[i].depth > z.depth)
+	{
+		if (open)
+		{
+			DrawZoneRows(zones, count, i, frameMs);
+		}
+		else
+		{
+			++i;
+		}
+	}
+	if (open)
+	{
+		ImGui::TreePop();
+	}
+}
+
+static void DrawZoneTree(const FrameRecord& frame)
+{
+	double frameMs = ProfilerTicksToMs(frame.end - frame.start);
+	ImGuiTableFlags tableFlags = ImGuiTableFlags_BordersV | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable;
+	if (!ImGui::BeginTable("ZoneTree", 3, tableFlags))
+	{
+		return;
+	}
+	ImGui::TableSetupColumn("Zone", ImGuiTableColumnFlags_WidthStretch);
+	ImGui::TableSetupColumn("ms", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+	ImGui::TableSetupColumn("% frame", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+	ImGui::TableHeadersRow();
+
+	const ProfileZone* zones = frame.zones.data();
+	int count = (int)frame.zones.size();
+	int i = 0;
+	while (i < count)
+	{
+		uint32_t thread = zones[i].thread;
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::PushID((int)thread);
+		bool open = ImGui::TreeNodeEx(ProfilerGetThreadName(thread), ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_DefaultOpen);
+		ImGui::PopID();
+		while (i < count && zones[i].thread == thread)
+		{
+			if (open)
+			{
+				DrawZoneRows(zones, count, i, frameMs);
+			}
+			else
+			{
+				++i;
+			}
+		}
+		if (open)
+		{
+			ImGui::TreePop();
+		}
+	}
+	ImGui::EndTable();
+}
+
+static void DrawTimeline()
+{
+	const float laneHeight = 16.0f;
+	const int frameCount = historyCount;
+	const int oldest = (historyHead - frameCount + 1 + kHistoryFrames) % kHistoryFrames;
+
+	// Each thread gets as many lanes as its deepest zone in the visible range.
+	uint32_t laneCount[kMaxThreads] = {};
+	for (int f = 0; f < frameCount; ++f)
+	{
+		for (const ProfileZone& z : history[(oldest + f) % kHistoryFrames].zones)
+		{
+			laneCount[z.thread] = std::max(laneCount[z.thread], z.depth + 1);
+		}
+	}
+	float laneOffset[kMaxThreads] = {};
+	float totalLanes = 0.0f;
+	for (uint32_t t = 0; t < kMaxThreads; ++t)
+	{
+		laneOffset[t] = totalLanes;
+		totalLanes += (float)laneCount[t];
+	}
+
+	ImVec2 p0 = ImGui::GetCursorScreenPos();
+	float width = ImGui::GetContentRegionAvail().x;
+	float height = std::max(1.0f, totalLanes) * laneHeight;
+	ImGui::InvisibleButton("Timeline", ImVec2(std::max(width, 1.0f), height));
+	if (frameCount == 0)
+	{
+		return;
+	}
+	bool hovered = ImGui::IsItemHovered();
+	ImVec2 mouse = ImGui::GetMousePos();
+	ImDrawList* draw = ImGui::GetWindowDrawList();
+	draw->AddRectFilled(p0, ImVec2(p0.x + width, p0.y + height), IM_COL32(30, 30, 30, 255));
+
+	uint64_t t0 = history[oldest].start;
+	uint64_t t1 = history[historyHead].end;
+	double scale = width / double(std::max<uint64_t>(t1 - t0, 1));
+	const FrameRecord* selected = selectedFrame >= 0 ? &history[selectedFrame] : &history[historyHead];
+
+	for (int f = 0; f < frameCount; ++f)
+	{
+		int index = (oldest + f) % kHistoryFrames;
+		const FrameRecord& frame = history[index];
+		float fx0 = p0.x + float((frame.start - t0) * scale);
+		float fx1 = p0.x + float((frame.end - t0) * scale);
+		if (&frame == selected)
+		{
+			draw->AddRectFilled(ImVec2(fx0, p0.y), ImVec2(fx1, p0.y + height), IM_COL32(70, 70, 90, 255));
+		}
+		draw->AddLine(ImVec2(fx0, p0.y), ImVec2(fx0, p0.y + height), IM_COL32(90, 90, 90, 255));
+
+		for (const ProfileZone& z : frame.zones)
+		{
+			float x0 = p0.x + float((std::max(z.start, t0) - t0) * scale);
+			float x1 = p0.x + float((std::max(z.end, t0) - t0) * scale);
+			if (x1 - x0 < 1.0f)
+			{
+				x1 = x0 + 1.0f;
+			}
+			float y0 = p0.y + (laneOffset[z.thread] + z.depth) * laneHeight;
+			ImVec2 a(x0, y0), b(x1, y0 + laneHeight - 1.0f);
+			draw->AddRectFilled(a, b, ZoneColor(z.name));
+			if (x1 - x0 > 30.0f)
+			{
+				draw->PushClipRect(a, b, true);
+				draw->AddText(ImVec2(x0 + 2.0f, y0), IM_COL32(0, 0, 0, 255), z.name);
+				draw->PopClipRect();
+			}
+			if (hovered && ImGui::IsMouseHoveringRect(a, b))
+			{
+				ImGui::SetTooltip("%s (%s)\n%.3f ms", z.name, ProfilerGetThreadName(z.thread), ProfilerTicksToMs(z.end - z.start));
+			}
+		}
+
+		if (hovered && ImGui::IsMouseClicked(ImGuiMouseButton_Left) && mouse.x >= fx0 && mouse.x < fx1)
+		{
+			selectedFrame = index;
+			paused = true;
+		}
+	}
+}
+
+void DrawProfilerUI()
+{
+#if MOUSE_PROFILER
+	if (!ImGui::CollapsingHeader("CPU Profiler", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		return;
+	}
+	if (ImGui::Checkbox("Pause", &paused) && !paused)
+	{
+		selectedFrame = -1;
+	}
+	if (historyHead < 0)
+	{
+		return;
+	}
+
+	const FrameRecord& frame = selectedFrame >= 0 ? history[selectedFrame] : history[historyHead];
+	ImGui::SameLine();
+	ImGui::Text("Frame: %.3f ms", ProfilerTicksToMs(frame.end - frame.start));
+
+	DrawTimeline();
+	DrawZoneTree(frame);
+#else
+	ImGui::TextDisabled("Profiler disabled (MOUSE_PROFILER=0)");
+#endif
+}
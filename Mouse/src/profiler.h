@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Set MOUSE_PROFILER to 0 to compile every PROFILE_SCOPE away.
+#ifndef MOUSE_PROFILER
+#define MOUSE_PROFILER 1
+#endif
+
+struct ProfileZone {
+	const char* name;   // string literal, compared by pointer
+	uint64_t start;     // TSC ticks
+	uint64_t end;
+	uint32_t depth;
+	uint32_t thread;
+};
+
+// Raw timestamp: the TSC on x86, steady_clock ticks elsewhere.
+inline uint64_t ProfilerNow()
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+double ProfilerTicksToMs(uint64_t ticks);
+
+void ProfilerInit();
+void ProfilerSetThreadName(const char* name);
+const char* ProfilerGetThreadName(uint32_t thread);
+uint32_t ProfilerGetThreadCount();
+
+void ProfilerBeginFrame();
+void ProfilerEndFrame();
+
+// Zones of the last completed frame, sorted by thread then start time.
+const ProfileZone* ProfilerGetLastFrame(int* count, uint64_t* frameStart, uint64_t* frameEnd);
+
+void DrawProfilerUI();
+
+#if MOUSE_PROFILER
+
+void ProfilerRecordZone(const char* name, uint64_t start, uint64_t end, uint32_t depth);
+
+extern thread_local uint32_t profilerDepth;
+
+struct ProfileScope {
+	const char* name;
+	uint64_t start;
+
+	explicit ProfileScope(const char* zoneName) : name(zoneName)
+	{
+		++profilerDepth;
+		start = ProfilerNow();
+	}
+	~ProfileScope()
+	{
+		uint64_t end = ProfilerNow();
+		--profilerDepth;
+		ProfilerRecordZone(name, start, end, profilerDepth);
+	}
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+
+#endif
@@ -0,0 +1,139 @@
+#include "redraw_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <GLFW/glfw3.h>
+
+#include "imgui.h"
+#include "imgui_internal.h"
+
+// Frames rendered after an input event. The first applies the input, the
+// others let hover, layout and auto-scroll catch up with it.
+static const int kFramesAfterInput = 3;
+static const double kNoWake = 1e30;
+
+static bool enabled = true;
+static double refreshHz = 60.0;
+static int framesLeft = kFramesAfterInput;
+static bool continuousLastFrame = true;
+static double wakeAt = kNoWake;
+static RedrawSchedulerStats stats;
+
+void RedrawSchedulerInit(GLFWwindow* window)
+{
+	GLFWmonitor* monitor = glfwGetWindowMonitor(window);
+	if (!monitor)
+	{
+		monitor = glfwGetPrimaryMonitor();
+	}
+	const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+	if (mode && mode->refreshRate > 0)
+	{
+		refreshHz = mode->refreshRate;
+	}
+}
+
+void RedrawSchedulerSetEnabled(bool e)
+{
+	enabled = e;
+}
+
+void RedrawSchedulerRequest(int frames)
+{
+	framesLeft = std::max(framesLeft, frames);
+}
+
+void RedrawSchedulerWakeAt(double time)
+{
+	wakeAt = std::min(wakeAt, time);
+}
+
+double RedrawSchedulerWaitEvents()
+{
+	if (!enabled || continuousLastFrame || framesLeft > 0)
+	{
+		return 0.0;
+	}
+
+	double start = glfwGetTime();
+	if (wakeAt < kNoWake)
+	{
+		glfwWaitEventsTimeout(std::max(wakeAt - start, 0.0));
+	}
+	else
+	{
+		glfwWaitEvents();
+	}
+	double now = glfwGetTime();
+	double waited = now - start;
+
+	// Woken by a timer: one frame redraws what it was waiting for. Anything
+	// earlier was an event, which gets the full burst.
+	framesLeft = now >= wakeAt ? 1 : kFramesAfterInput;
+	wakeAt = kNoWake;
+	stats.idleSeconds += waited;
+	stats.idleFrames += (unsigned long long)(waited * refreshHz);
+	++stats.wakeups;
+	return waited;
+}
+
+// Timed ImGui state that changes on screen without any input.
+static bool ScheduleImGuiAnimations()
+{
+	ImGuiContext& g = *ImGui::GetCurrentContext();
+	const ImGuiIO& io = g.IO;
+	const ImGuiStyle& style = g.Style;
+
+	// Dragging, resizing, held buttons and key repeat advance every frame.
+	if (ImGui::IsAnyMouseDown() || g.NavWindowingTarget || (g.DimBgRatio > 0.0f && g.DimBgRatio < 1.0f))
+	{
+		return true;
+	}
+
+	double now = glfwGetTime();
+	// Delayed tooltips appear once the hover timer passes the longest delay.
+	float hoverDelay = style.HoverStationaryDelay + style.HoverDelayNormal;
+	if (g.HoveredId && g.HoveredIdTimer < hoverDelay)
+	{
+		RedrawSchedulerWakeAt(now + (hoverDelay - g.HoveredIdTimer));
+	}
+	// Text cursor blink: visible for 0.8s of every 1.2s, and solid for a
+	// moment after each edit while CursorAnim is negative.
+	if (io.ConfigInputTextCursorBlink && g.ActiveId && g.ActiveId == g.InputTextState.ID)
+	{
+		float anim = g.InputTextState.CursorAnim;
+		float next = anim <= 0.0f ? 0.8f - anim : (std::fmod(anim, 1.2f) < 0.8f ? 0.8f : 1.2f) - std::fmod(anim, 1.2f);
+		RedrawSchedulerWakeAt(now + next);
+	}
+	return false;
+}
+
+void RedrawSchedulerEndFrame(bool continuous)
+{
+	++stats.activeFrames;
+	if (framesLeft > 0)
+	{
+		--framesLeft;
+	}
+	continuousLastFrame = ScheduleImGuiAnimations() || continuous;
+}
+
+RedrawSchedulerStats RedrawSchedulerGetStats()
+{
+	return stats;
+}
+
+void DrawRedrawSchedulerUI()
+{
+	if (!ImGui::CollapsingHeader("Redraw Scheduler"))
+	{
+		return;
+	}
+	ImGui::Checkbox("Redraw only on change", &enabled);
+	unsigned long long total = stats.activeFrames + stats.idleFrames;
+	double activePct = total ? 100.0 * stats.activeFrames / total : 100.0;
+	ImGui::Text("Active frames: %llu (%.1f%%)", stats.activeFrames, activePct);
+	ImGui::Text("Idle frames: %llu (%.1f s at %.0f Hz)", stats.idleFrames, stats.idleSeconds, refreshHz);
+	ImGui::Text("Wakeups: %llu", stats.wakeups);
+	ImGui::TextDisabled("%s", continuousLastFrame ? "Rendering continuously" : framesLeft > 0 ? "Settling after input" : "Idle");
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+struct GLFWwindow;
+
+// Renders only when something can have changed. While idle the main loop
+// blocks in glfwWaitEventsTimeout instead of redrawing a static frame. Input
+// wakes it for a short burst of frames (ImGui needs a couple to settle hover
+// and layout), ImGui's own timed animations (cursor blink, tooltip delays,
+// fades) schedule timer wakeups, and continuous work such as the simulation
+// keeps it rendering every frame.
+
+void RedrawSchedulerInit(GLFWwindow* window);
+void RedrawSchedulerSetEnabled(bool enabled);
+
+// Call before the frame begins: unless a frame is due, blocks until input or
+// the next timer. Returns the seconds spent blocked, which the caller leaves
+// out of its frame delta. The frame then polls events itself, so their
+// dispatch is profiled with it.
+double RedrawSchedulerWaitEvents();
+
+// Asks for at least `frames` more frames, e.g. after new log output.
+void RedrawSchedulerRequest(int frames = 1);
+// Wakes the loop at glfwGetTime() == time even without input.
+void RedrawSchedulerWakeAt(double time);
+
+// Call after ImGui::Render(). `continuous` keeps rendering every frame
+// (simulation running, trace capture in progress).
+void RedrawSchedulerEndFrame(bool continuous);
+
+struct RedrawSchedulerStats {
+	unsigned long long activeFrames; // rendered
+	unsigned long long idleFrames;   // display refreshes slept through
+	unsigned long long wakeups;      // waits ended by input or a timer
+	double idleSeconds;
+};
+
+RedrawSchedulerStats RedrawSchedulerGetStats();
+void DrawRedrawSchedulerUI();
@@ -0,0 +1,288 @@
+#include "render_thread.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "imgui.h"
+#include "imgui_impl_opengl3.h"
+#include "profiler.h"
+#include "frame_pacer.h"
+#include "input_latency.h"
+#include "texture_stream.h"
+
+// One slot per queued frame plus the one being rendered.
+static const int kSnapshotSlots = kMaxRenderQueueDepth + 1;
+
+struct FrameSnapshot {
+	ImDrawData data;
+	ImVector<ImDrawList*> lists; // owned; their buffers trade places with ImGui's every frame
+	float clearColor[3];
+	int latencyFrame;
+	double submitTime;
+	unsigned long long serial;
+	bool sync;                   // carries texture updates; the main thread waits for it
+	bool busy;
+};
+
+static FrameSnapshot snapshots[kSnapshotSlots];
+static int queue[kSnapshotSlots]; // slot indices, oldest first
+static int queueHead = 0;
+static int queuedCount = 0;
+static unsigned long long submittedSerial = 0;
+static unsigned long long completedSerial = 0;
+
+static std::mutex queueMutex;
+static std::condition_variable queueCv;
+static std::thread renderThread;
+static GLFWwindow* window = nullptr;
+static bool running = false;
+static bool stopRequested = false;
+static bool wanted = false;
+static int queueDepth = 1;
+static bool dropStale = false;
+static RenderThreadStats stats;
+
+static int PopFront()
+{
+	int slot = queue[queueHead];
+	queueHead = (queueHead + 1) % kSnapshotSlots;
+	--queuedCount;
+	return slot;
+}
+
+static void RenderSnapshot(FrameSnapshot& s)
+{
+	PROFILE_FUNCTION();
+	glClearColor(s.clearColor[0], s.clearColor[1], s.clearColor[2], 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	TextureStreamPump();
+	ImGui_ImplOpenGL3_RenderDrawData(&s.data);
+	InputLatencyMark(s.latencyFrame, LatencyStage_Submit);
+	FramePacerEndFrame();
+	{
+		PROFILE_SCOPE("glfwSwapBuffers");
+		glfwSwapBuffers(window);
+	}
+	InputLatencyEndFrame(s.latencyFrame);
+}
+
+static void RenderThreadMain()
+{
+	ProfilerSetThreadName("Render");
+	glfwMakeContextCurrent(window);
+	std::unique_lock<std::mutex> lock(queueMutex);
+	for (;;)
+	{
+		queueCv.wait(lock, [] { return queuedCount > 0 || stopRequested; });
+		if (queuedCount == 0)
+		{
+			break;
+		}
+		int slot = PopFront();
+		while (dropStale && queuedCount > 0 && !snapshots[slot].sync)
+		{
+			FrameSnapshot& stale = snapshots[slot];
+			InputLatencyDiscard(stale.latencyFrame);
+			completedSerial = std::max(completedSerial, stale.serial);
+			stale.busy = false;
+			++stats.dropped;
+			slot = PopFront();
+		}
+		queueCv.notify_all();
+		lock.unlock();
+
+		FrameSnapshot& s = snapshots[slot];
+		RenderSnapshot(s);
+		double queueMs = (glfwGetTime() - s.submitTime) * 1000.0;
+
+		lock.lock();
+		stats.queueMs = stats.rendered ? stats.queueMs * 0.9 + queueMs * 0.1 : queueMs;
+		++stats.rendered;
+		completedSerial = std::max(completedSerial, s.serial);
+		s.busy = false;
+		queueCv.notify_all();
+	}
+	glfwMakeContextCurrent(nullptr);
+}
+
+void RenderThreadStart(GLFWwindow* w)
+{
+	if (running)
+	{
+		return;
+	}
+	window = w;
+	stopRequested = false;
+	glfwMakeContextCurrent(nullptr);
+	running = true;
+	renderThread = std::thread(RenderThreadMain);
+}
+
+void RenderThreadStop()
+{
+	if (!running)
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopRequested = true;
+	}
+	queueCv.notify_all();
+	renderThread.join();
+	running = false;
+	glfwMakeContextCurrent(window);
+
+	for (FrameSnapshot& s : snapshots)
+	{
+		for (ImDrawList* list : s.lists)
+		{
+			IM_DELETE(list);
+		}
+		s.lists.clear();
+		s.data.Clear();
+	}
+}
+
+bool RenderThreadRunning()
+{
+	return running;
+}
+
+void RenderThreadSetWanted(bool w)
+{
+	wanted = w;
+}
+
+bool RenderThreadWanted()
+{
+	return wanted;
+}
+
+// Moves the frame's geometry into the snapshot. ImGui resets its draw lists
+// at the start of the next frame, so it only ever sees the swapped-in buffers
+// as spare capacity.
+static void TakeSnapshot(FrameSnapshot& s, ImDrawData* src)
+{
+	while (s.lists.Size < src->CmdListsCount)
+	{
+		s.lists.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+	}
+	s.data.Clear();
+	for (int i = 0; i < src->CmdListsCount; ++i)
+	{
+		ImDrawList* from = src->CmdLists[i];
+		ImDrawList* to = s.lists[i];
+		to->CmdBuffer.swap(from->CmdBuffer);
+		to->IdxBuffer.swap(from->IdxBuffer);
+		to->VtxBuffer.swap(from->VtxBuffer);
+		// Callback data is referenced from CmdBuffer by pointer; the heap block moves with the swap.
+		to->_CallbacksDataBuf.swap(from->_CallbacksDataBuf);
+		to->Flags = from->Flags;
+		s.data.CmdLists.push_back(to);
+	}
+	s.data.Valid = true;
+	s.data.CmdListsCount = src->CmdListsCount;
+	s.data.TotalIdxCount = src->TotalIdxCount;
+	s.data.TotalVtxCount = src->TotalVtxCount;
+	s.data.DisplayPos = src->DisplayPos;
+	s.data.DisplaySize = src->DisplaySize;
+	s.data.FramebufferScale = src->FramebufferScale;
+}
+
+void RenderThreadSubmit(ImDrawData* drawData, const float clearColor[3], int latencyFrame)
+{
+	PROFILE_FUNCTION();
+	// Texture uploads change state ImGui reads in the next NewFrame; those
+	// frames go through the render thread while we wait.
+	ImVector<ImTextureData*>& textures = ImGui::GetPlatformIO().Textures;
+	bool sync = false;
+	for (ImTextureData* tex : textures)
+	{
+		sync |= tex->Status != ImTextureStatus_OK;
+	}
+
+	double waitStart = glfwGetTime();
+	std::unique_lock<std::mutex> lock(queueMutex);
+	queueCv.wait(lock, [] { return queuedCount < queueDepth; });
+	stats.mainWaitMs = (glfwGetTime() - waitStart) * 1000.0;
+	int slot = 0;
+	while (snapshots[slot].busy)
+	{
+		++slot;
+	}
+	FrameSnapshot& s = snapshots[slot];
+	s.busy = true;
+	lock.unlock();
+
+	TakeSnapshot(s, drawData);
+	s.data.Textures = sync ? &textures : nullptr;
+	std::copy(clearColor, clearColor + 3, s.clearColor);
+	s.latencyFrame = latencyFrame;
+	s.submitTime = glfwGetTime();
+	s.sync = sync;
+
+	lock.lock();
+	s.serial = ++submittedSerial;
+	queue[(queueHead + queuedCount) % kSnapshotSlots] = slot;
+	++queuedCount;
+	queueCv.notify_all();
+	if (sync)
+	{
+		++stats.syncFrames;
+		unsigned long long serial = s.serial;
+		queueCv.wait(lock, [serial] { return completedSerial >= serial; });
+	}
+}
+
+void RenderThreadSetQueueDepth(int depth)
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+	queueDepth = std::min(std::max(depth, 1), kMaxRenderQueueDepth);
+	queueCv.notify_all();
+}
+
+void RenderThreadSetDropStale(bool d)
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+	dropStale = d;
+}
+
+RenderThreadStats RenderThreadGetStats()
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+	return stats;
+}
+
+void DrawRenderThreadUI()
+{
+	if (!ImGui::CollapsingHeader("Render Thread"))
+	{
+		return;
+	}
+	ImGui::Checkbox("Submit on a render thread", &wanted);
+	int depth = queueDepth;
+	if (ImGui::SliderInt("Queue depth", &depth, 1, kMaxRenderQueueDepth))
+	{
+		RenderThreadSetQueueDepth(depth);
+	}
+	bool d = dropStale;
+	if (ImGui::Checkbox("Drop stale frames", &d))
+	{
+		RenderThreadSetDropStale(d);
+	}
+	if (!running)
+	{
+		ImGui::TextDisabled("Building and submitting on the main thread");
+		return;
+	}
+	RenderThreadStats s = RenderThreadGetStats();
+	ImGui::Text("Rendered: %llu, dropped: %llu, synchronous: %llu", s.rendered, s.dropped, s.syncFrames);
+	ImGui::Text("Main thread waited: %.3f ms", s.mainWaitMs);
+	ImGui::Text("Submit to swap: %.2f ms", s.queueMs);
+	ImGui::TextDisabled("GPU timing and the layer cache are paused");
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+struct GLFWwindow;
+struct ImDrawData;
+
+// Pipelined submission. A render thread owns the GL context and submits frame
+// N while the main thread builds frame N+1. Handing a frame over swaps the
+// draw lists' buffers into a snapshot instead of copying them, so ImGui starts
+// the next frame on the buffers the render thread has finished with.
+//
+// While it runs, the main thread must not touch GL: GPU timing and the GL
+// layer cache are off, streamed texture uploads run on the render thread,
+// and frames that update ImGui textures (font atlas uploads) are submitted
+// synchronously.
+
+static const int kMaxRenderQueueDepth = 3;
+
+// Releases the context from the calling thread and starts the render thread.
+void RenderThreadStart(GLFWwindow* window);
+// Renders what is queued, stops the thread and makes the context current on
+// the calling thread again.
+void RenderThreadStop();
+bool RenderThreadRunning();
+// Set from the UI or the command line; the main loop starts or stops the
+// thread between frames.
+void RenderThreadSetWanted(bool wanted);
+bool RenderThreadWanted();
+
+// Queues ImGui's draw data for the render thread. Blocks while the queue
+// holds the configured number of frames. latencyFrame is the handle from
+// InputLatencyBeginFrame.
+void RenderThreadSubmit(ImDrawData* drawData, const float clearColor[3], int latencyFrame);
+
+// Frames queued ahead of the render thread, 1..kMaxRenderQueueDepth. Deeper
+// queues absorb spikes at the cost of latency.
+void RenderThreadSetQueueDepth(int depth);
+// Render only the newest queued frame and drop older ones, trading
+// smoothness for latency when the render thread falls behind.
+void RenderThreadSetDropStale(bool dropStale);
+
+struct RenderThreadStats {
+	unsigned long long rendered;
+	unsigned long long dropped;
+	unsigned long long syncFrames;
+	double mainWaitMs;  // main thread blocked on a full queue, last frame
+	double queueMs;     // submit to swap, smoothed
+};
+
+RenderThreadStats RenderThreadGetStats();
+void DrawRenderThreadUI();
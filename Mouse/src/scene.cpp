@@ -0,0 +1,973 @@
+#include "scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "profiler.h"
+#include "gpu_timer.h"
+#include "frame_arena.h"
+#include "draw_batch.h"
+#include "spatial_grid.h"
+#include "layer_cache.h"
+#include "texture_atlas.h"
+#include "scene_journal.h"
+#include "undo_history.h"
+
+std::vector<Rect> objects;
+SelectionSet selection;
+int selectedIndex = -1;
+bool playMode = false;
+SceneCamera sceneCamera;
+static HitColumns sceneBounds;
+static SceneChangeChannel boundsChanges;
+static bool boundsChannelRegistered = false;
+static SpatialGrid sceneGrid;
+static bool sceneGridDirty = true;
+static int queriesSinceSync = 0;
+
+// Group drag: the offset is measured from the press point and clamped against
+// the selection's bounds at that time, so the group moves as one rigid block.
+static bool groupDrag = false;
+static ImVec2 dragStart;
+static ImVec2 dragApplied;
+static ImVec2 dragMin, dragMax;
+
+// Undo labels; one entry per gesture.
+static const char* const kMoveEdit = "Move";
+static const char* const kInspectorEdit = "Inspector";
+
+// Marquee: the selection is rebuilt every frame as marqueeBase <op> region.
+static bool marqueeActive = false;
+static ImVec2 marqueeStart;
+static SelectionOp marqueeOp = SelectionOp_Replace;
+static SelectionSet marqueeBase;
+
+static const float kMinZoom = 1.0f / 256.0f;
+static const float kMaxZoom = 64.0f;
+
+// Below this the SIMD sweep beats building the grid.
+static const int kGridMinObjects = 4096;
+// Past this many changed cached objects in one sync, dropping every tile is cheaper.
+static const int kMaxTileInvalidations = 64;
+
+// Selected objects and sprites are drawn live, everything else goes through
+// the layer cache. Live objects are drawn above the rest on every path, cached
+// or not, and picking follows that order.
+static SelectionSet spriteObjects; // kept by SyncSceneBounds
+static SelectionSet liveObjects;   // selection | spriteObjects, rebuilt by SyncLiveSet
+static SelectionSet cachedLive;    // liveObjects as of the last layer cache sync
+
+static void InvalidateTiles(int& invalidations, float x0, float y0, float x1, float y1)
+{
+	if (++invalidations <= kMaxTileInvalidations)
+	{
+		LayerCacheInvalidateRect(x0, y0, x1, y1);
+	}
+	else if (invalidations == kMaxTileInvalidations + 1)
+	{
+		LayerCacheInvalidateAll();
+	}
+}
+
+// Old and new bounds of an object; tiles under both are redrawn unless the
+// object is drawn live (so not in any tile).
+static void UpdateBounds(int i, int& invalidations)
+{
+	const Rect& R = objects[i];
+	bool cached = !SelectionContains(cachedLive, i);
+	if (cached)
+	{
+		InvalidateTiles(invalidations, sceneBounds.minX[i], sceneBounds.minY[i], sceneBounds.maxX[i], sceneBounds.maxY[i]);
+		InvalidateTiles(invalidations, R.x, R.y, R.x + R.w, R.y + R.h);
+	}
+	HitColumnsSet(sceneBounds, i, R.x, R.y, R.x + R.w, R.y + R.h);
+}
+
+// Catches the bounds columns and the layer cache up with the changes made
+// since the last sync. Usually that is a handful of objects; a simulation
+// step or a structural edit falls back to a full pass.
+static void SyncSceneBounds()
+{
+	if (!boundsChannelRegistered)
+	{
+		SceneChangesRegister(&boundsChanges);
+		boundsChannelRegistered = true;
+	}
+	int count = (int)objects.size();
+	bool resized = sceneBounds.count != count;
+	bool moved = false;
+	int invalidations = 0;
+	SelectionResize(spriteObjects, count);
+	uint32_t all = ConsumeSceneChanges(boundsChanges, [&](int i, uint32_t what)
+	{
+		if (resized || i >= count)
+		{
+			return;
+		}
+		if (what & SceneChange_Sprite)
+		{
+			if (objects[i].sprite >= 0)
+			{
+				SelectionAdd(spriteObjects, i);
+			}
+			else
+			{
+				SelectionRemove(spriteObjects, i);
+			}
+		}
+		if (what & SceneChange_Bounds)
+		{
+			moved = true;
+			UpdateBounds(i, invalidations);
+		}
+		else if (!SelectionContains(cachedLive, i))
+		{
+			InvalidateTiles(invalidations, sceneBounds.minX[i], sceneBounds.minY[i], sceneBounds.maxX[i], sceneBounds.maxY[i]);
+		}
+	});
+
+	if (resized || (all & (SceneChange_Color | SceneChange_Structure | SceneChange_Sprite)))
+	{
+		HitColumnsResize(sceneBounds, count);
+		SelectionClear(spriteObjects);
+		for (int i = 0; i < count; ++i)
+		{
+			const Rect& R = objects[i];
+			HitColumnsSet(sceneBounds, i, R.x, R.y, R.x + R.w, R.y + R.h);
+			if (R.sprite >= 0) SelectionAdd(spriteObjects, i);
+		}
+		LayerCacheInvalidateAll();
+		moved = true;
+	}
+	else if (all)
+	{
+		// Only positions and sizes: compare against the columns to find what moved.
+		for (int i = 0; i < count; ++i)
+		{
+			const Rect& R = objects[i];
+			if (sceneBounds.minX[i] != R.x || sceneBounds.minY[i] != R.y || sceneBounds.maxX[i] != R.x + R.w || sceneBounds.maxY[i] != R.y + R.h)
+			{
+				UpdateBounds(i, invalidations);
+			}
+		}
+		moved = true;
+	}
+	if (moved)
+	{
+		sceneGridDirty = true;
+		queriesSinceSync = 0;
+	}
+}
+
+int PickObject(float lx, float ly)
+{
+	SyncSceneBounds();
+	int top = HitTestPointTopmost(sceneBounds, lx, ly);
+	if (top < 0 || cachedLive.count == 0 || SelectionContains(cachedLive, top))
+	{
+		return top;
+	}
+	// A live object under the point is drawn above the hit.
+	int live = -1;
+	SelectionForEach(cachedLive, [&](int i)
+	{
+		if (i < sceneBounds.count && sceneBounds.minX[i] <= lx && lx <= sceneBounds.maxX[i] && sceneBounds.minY[i] <= ly && ly <= sceneBounds.maxY[i])
+		{
+			live = i;
+		}
+	});
+	return live >= 0 ? live : top;
+}
+
+void QuerySceneRect(float x0, float y0, float x1, float y1, HitRectMode mode, uint64_t* mask)
+{
+	SyncSceneBounds();
+	if (x0 > x1) std::swap(x0, x1);
+	if (y0 > y1) std::swap(y0, y1);
+	// The grid only pays off once bounds hold still for a few queries (a
+	// marquee drag in edit mode); while objects move, sweep.
+	if (sceneBounds.count < kGridMinObjects || ++queriesSinceSync < 2)
+	{
+		HitTestRectMask(sceneBounds, x0, y0, x1, y1, mode, mask);
+		return;
+	}
+	if (sceneGridDirty)
+	{
+		SpatialGridBuild(sceneGrid, sceneBounds, 64.0f);
+		sceneGridDirty = false;
+	}
+
+	// A query covering most of the grid visits most objects anyway; sweep instead.
+	float gridW = sceneGrid.cols * sceneGrid.cellSize, gridH = sceneGrid.rows * sceneGrid.cellSize;
+	float qx0 = std::max(x0, sceneGrid.originX), qx1 = std::min(x1, sceneGrid.originX + gridW);
+	float qy0 = std::max(y0, sceneGrid.originY), qy1 = std::min(y1, sceneGrid.originY + gridH);
+	float covered = std::max(qx1 - qx0, 0.0f) * std::max(qy1 - qy0, 0.0f);
+	if (covered > 0.25f * gridW * gridH)
+	{
+		HitTestRectMask(sceneBounds, x0, y0, x1, y1, mode, mask);
+		return;
+	}
+	memset(mask, 0, HitMaskWords(sceneBounds.count) * sizeof(uint64_t));
+	SpatialGridQueryRect(sceneGrid, sceneBounds, x0, y0, x1, y1, mode, mask);
+}
+
+// Keeps the primary object inside the selection.
+static void SyncPrimary()
+{
+	if (!SelectionContains(selection, selectedIndex))
+	{
+		selectedIndex = SelectionFirst(selection);
+	}
+}
+
+void UpdateScene(float deltaTime, ImVec2 bounds)
+{
+	PROFILE_SCOPE("Simulation");
+	for (auto& R : objects)
+	{
+		R.y += 25.0f * deltaTime;
+		R.y = Clamp(R.y, 0.0f, bounds.y - R.h);
+	}
+	MarkAllObjectsChanged(SceneChange_Position);
+}
+
+void InsertRects(std::vector<Rect>& v, const int* indices, const Rect* values, int count)
+{
+	int old = (int)v.size();
+	v.resize(old + count);
+	// From the back, each slot takes either the next inserted object or the
+	// next old one; once every insert is placed the rest is already in place.
+	int src = old - 1, k = count - 1;
+	for (int dst = old + count - 1; k >= 0; --dst)
+	{
+		v[dst] = dst == indices[k] ? values[k--] : v[src--];
+	}
+}
+
+void EraseRects(std::vector<Rect>& v, const int* indices, int count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	int size = (int)v.size(), dst = indices[0], k = 0;
+	for (int src = indices[0]; src < size; ++src)
+	{
+		if (k < count && src == indices[k])
+		{
+			++k;
+			continue;
+		}
+		v[dst++] = v[src];
+	}
+	v.resize(size - count);
+}
+
+void DuplicateSelection()
+{
+	std::vector<int> indices;
+	std::vector<Rect> copies;
+	int first = (int)objects.size();
+	SelectionForEach(selection, [&](int i)
+	{
+		Rect copy = objects[i];
+		copy.x += 16.0f;
+		copy.y += 16.0f;
+		indices.push_back(first + (int)copies.size());
+		copies.push_back(copy);
+	});
+	if (copies.empty())
+	{
+		return;
+	}
+	SceneJournalRecordInsert(indices.data(), copies.data(), (int)copies.size());
+	UndoRecordInsert("Duplicate", indices.data(), copies.data(), (int)copies.size());
+	objects.insert(objects.end(), copies.begin(), copies.end());
+	MarkAllObjectsChanged(SceneChange_Structure);
+	SelectionResize(selection, (int)objects.size());
+	SelectionClear(selection);
+	for (int i : indices)
+	{
+		SelectionAdd(selection, i);
+	}
+	selectedIndex = first;
+}
+
+void DeleteSelection()
+{
+	std::vector<int> indices;
+	SelectionForEach(selection, [&](int i) { indices.push_back(i); });
+	if (indices.empty())
+	{
+		return;
+	}
+	SceneJournalRecordRemove(indices.data(), (int)indices.size());
+	UndoRecordRemove("Delete", indices.data(), (int)indices.size());
+	EraseRects(objects, indices.data(), (int)indices.size());
+	MarkAllObjectsChanged(SceneChange_Structure);
+	SelectionResize(selection, (int)objects.size());
+	SelectionClear(selection);
+	selectedIndex = -1;
+}
+
+void DrawInspector()
+{
+	PROFILE_FUNCTION();
+	SelectionResize(selection, (int)objects.size());
+	SyncPrimary();
+	if (selectedIndex < 0) return;
+
+	auto& R = objects[selectedIndex];
+	ImGui::Begin("Inspector");
+
+	// With several objects selected the fields show the primary object: X/Y
+	// move everything by the same delta, the rest are assigned to all.
+	bool multi = selection.count > 1;
+	bool mixedW = false, mixedH = false;
+	if (multi)
+	{
+		ImGui::Text("%d objects selected", selection.count);
+		ImGui::Separator();
+		SelectionForEach(selection, [&](int i)
+		{
+			mixedW |= objects[i].w != R.w;
+			mixedH |= objects[i].h != R.h;
+		});
+	}
+
+	Rect before = R;
+	uint32_t what = 0;
+	ImGui::BeginGroup();
+	what |= ImGui::DragFloat("X", &R.x, 1.0f) ? SceneChange_Position : 0;
+	what |= ImGui::DragFloat("Y", &R.y, 1.0f) ? SceneChange_Position : 0;
+
+	what |= ImGui::DragFloat("Width", &R.w, 1.0f, 1.0f, 100, mixedW ? "(mixed)" : "%.3f") ? SceneChange_Size : 0;
+	what |= ImGui::DragFloat("Height", &R.h, 1.0f, 1.0f, 100, mixedH ? "(mixed)" : "%.3f") ? SceneChange_Size : 0;
+
+	what |= ImGui::ColorEdit4(R.sprite >= 0 ? "Tint" : "Color", (float*)&R.color) ? SceneChange_Color : 0;
+	if (AtlasImageCount() > 0)
+	{
+		what |= ImGui::SliderInt("Sprite", &R.sprite, -1, AtlasImageCount() - 1, R.sprite < 0 ? "None" : "%d") ? SceneChange_Sprite : 0;
+	}
+	ImGui::EndGroup();
+	// The undo entry stays open while a field is held or the color picker is up.
+	bool editing = ImGui::IsItemActive() || ImGui::IsPopupOpen("", ImGuiPopupFlags_AnyPopupId);
+	if (what)
+	{
+		UndoBeginEdit(kInspectorEdit);
+		UndoCapture(selectedIndex, before);
+	}
+	if (multi && what)
+	{
+		float dx = R.x - before.x, dy = R.y - before.y;
+		bool setW = R.w != before.w, setH = R.h != before.h;
+		int primary = selectedIndex;
+		SelectionForEach(selection, [&](int i)
+		{
+			MarkObjectChanged(i, what);
+			if (i == primary) return;
+			UndoCapture(i);
+			Rect& O = objects[i];
+			O.x += dx;
+			O.y += dy;
+			if (setW) O.w = R.w;
+			if (setH) O.h = R.h;
+			if (what & SceneChange_Color) O.color = R.color;
+			if (what & SceneChange_Sprite) O.sprite = R.sprite;
+		});
+	}
+	else if (what)
+	{
+		MarkObjectChanged(selectedIndex, what);
+	}
+	if (!editing)
+	{
+		UndoEndEdit(kInspectorEdit);
+	}
+	ImGui::TextDisabled("Version %llu", (unsigned long long)GetObjectVersion(selectedIndex));
+	if (ImGui::Button("Duplicate"))
+	{
+		DuplicateSelection();
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Delete"))
+	{
+		DeleteSelection();
+	}
+	ImGui::End();
+}
+
+static void BeginGroupDrag(float lx, float ly)
+{
+	bool first = true;
+	SelectionForEach(selection, [&](int i)
+	{
+		const Rect& R = objects[i];
+		if (first)
+		{
+			dragMin = ImVec2(R.x, R.y);
+			dragMax = ImVec2(R.x + R.w, R.y + R.h);
+			first = false;
+			return;
+		}
+		dragMin = ImVec2(std::min(dragMin.x, R.x), std::min(dragMin.y, R.y));
+		dragMax = ImVec2(std::max(dragMax.x, R.x + R.w), std::max(dragMax.y, R.y + R.h));
+	});
+	dragStart = ImVec2(lx, ly);
+	dragApplied = ImVec2(0.0f, 0.0f);
+	groupDrag = true;
+	UndoBeginEdit(kMoveEdit);
+	SelectionForEach(selection, [](int i) { UndoCapture(i); });
+}
+
+// World-space rect currently shown in the Scene view.
+struct ViewRect {
+	float x0, y0, x1, y1;
+};
+
+static ViewRect VisibleWorldRect(ImVec2 avail)
+{
+	float inv = 1.0f / sceneCamera.zoom;
+	return { sceneCamera.pan.x, sceneCamera.pan.y, sceneCamera.pan.x + avail.x * inv, sceneCamera.pan.y + avail.y * inv };
+}
+
+static ImVec2 WorldToScreen(ImVec2 p0, float x, float y)
+{
+	return ImVec2(p0.x + (x - sceneCamera.pan.x) * sceneCamera.zoom, p0.y + (y - sceneCamera.pan.y) * sceneCamera.zoom);
+}
+
+// The group stays inside the visible part of the world.
+static void UpdateGroupDrag(float lx, float ly, const ViewRect& view)
+{
+	float ox = Clamp(lx - dragStart.x, view.x0 - dragMin.x, std::max(view.x1 - dragMax.x, view.x0 - dragMin.x));
+	float oy = Clamp(ly - dragStart.y, view.y0 - dragMin.y, std::max(view.y1 - dragMax.y, view.y0 - dragMin.y));
+	float dx = ox - dragApplied.x, dy = oy - dragApplied.y;
+	if (dx == 0.0f && dy == 0.0f)
+	{
+		return;
+	}
+	SelectionForEach(selection, [&](int i)
+	{
+		objects[i].x += dx;
+		objects[i].y += dy;
+		MarkObjectChanged(i, SceneChange_Position);
+	});
+	dragApplied = ImVec2(ox, oy);
+}
+
+static void UpdateMarquee(float lx, float ly)
+{
+	int count = (int)objects.size();
+	uint64_t* mask = (uint64_t*)FrameAlloc(HitMaskWords(count) * sizeof(uint64_t));
+	QuerySceneRect(marqueeStart.x, marqueeStart.y, lx, ly, HitRectMode_Overlap, mask);
+	SelectionCombine(selection, marqueeBase, mask, marqueeOp);
+	SyncPrimary();
+}
+
+// Middle-drag pans, the wheel zooms about the cursor, Home resets. Works in play mode too.
+static void HandleCameraInput(ImVec2 p0)
+{
+	if (!ImGui::IsWindowHovered())
+	{
+		return;
+	}
+	ImGuiIO& io = ImGui::GetIO();
+	SceneCamera& cam = sceneCamera;
+	if (ImGui::IsMouseDown(ImGuiMouseButton_Middle))
+	{
+		cam.pan.x -= io.MouseDelta.x / cam.zoom;
+		cam.pan.y -= io.MouseDelta.y / cam.zoom;
+	}
+	if (io.MouseWheel != 0.0f)
+	{
+		ImVec2 local(io.MousePos.x - p0.x, io.MousePos.y - p0.y);
+		ImVec2 anchor(cam.pan.x + local.x / cam.zoom, cam.pan.y + local.y / cam.zoom);
+		cam.zoom = Clamp(cam.zoom * powf(1.2f, io.MouseWheel), kMinZoom, kMaxZoom);
+		cam.pan = ImVec2(anchor.x - local.x / cam.zoom, anchor.y - local.y / cam.zoom);
+	}
+	if (ImGui::IsKeyPressed(ImGuiKey_Home))
+	{
+		cam = SceneCamera();
+	}
+}
+
+static void HandleSceneInput(ImVec2 p0, ImVec2 avail)
+{
+	ImGuiIO& io = ImGui::GetIO();
+	ImVec2 mp = ImGui::GetMousePos();
+	float lx = sceneCamera.pan.x + (mp.x - p0.x) / sceneCamera.zoom;
+	float ly = sceneCamera.pan.y + (mp.y - p0.y) / sceneCamera.zoom;
+	if (ImGui::IsWindowHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+	{
+		int hit = PickObject(lx, ly);
+		if (hit >= 0)
+		{
+			if (io.KeyCtrl)
+			{
+				SelectionToggle(selection, hit);
+			}
+			else if (io.KeyShift)
+			{
+				SelectionAdd(selection, hit);
+			}
+			else if (!SelectionContains(selection, hit))
+			{
+				SelectionClear(selection);
+				SelectionAdd(selection, hit);
+			}
+			if (SelectionContains(selection, hit))
+			{
+				selectedIndex = hit;
+				BeginGroupDrag(lx, ly);
+			}
+			SyncPrimary();
+		}
+		else
+		{
+			marqueeActive = true;
+			marqueeStart = ImVec2(lx, ly);
+			marqueeOp = io.KeyCtrl ? SelectionOp_Toggle : (io.KeyAlt ? SelectionOp_Subtract : (io.KeyShift ? SelectionOp_Add : SelectionOp_Replace));
+			marqueeBase = selection;
+		}
+	}
+
+	if (!ImGui::IsMouseDown(ImGuiMouseButton_Left))
+	{
+		if (groupDrag)
+		{
+			UndoEndEdit(kMoveEdit);
+		}
+		groupDrag = false;
+		marqueeActive = false;
+	}
+	if (groupDrag)
+	{
+		UpdateGroupDrag(lx, ly, VisibleWorldRect(avail));
+	}
+	if (marqueeActive)
+	{
+		UpdateMarquee(lx, ly);
+	}
+	else if (!groupDrag && ImGui::IsWindowFocused())
+	{
+		if (ImGui::IsKeyPressed(ImGuiKey_Delete, false))
+		{
+			DeleteSelection();
+		}
+		else if (io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_D, false))
+		{
+			DuplicateSelection();
+		}
+		else if (io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_Z))
+		{
+			io.KeyShift ? RedoNext() : UndoLast();
+		}
+		else if (io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_Y))
+		{
+			RedoNext();
+		}
+	}
+}
+
+// Objects smaller than kLodPixels on screen are not drawn one by one; their
+// coverage and color are accumulated into kLodTilePixels screen tiles and
+// each non-empty tile becomes one quad. However many sub-pixel objects are
+// in view, they cost at most one quad per tile.
+struct LodTile {
+	float r, g, b;
+	float coverage; // covered area in pixels, weighted by alpha
+	bool selected;
+	bool touched;
+};
+
+// Tiles are kept zeroed between uses; touched lists the ones with coverage.
+struct LodGrid {
+	std::vector<LodTile> tiles;
+	std::vector<int> touched;
+	int tilesX = 0, tilesY = 0;
+};
+
+static const float kLodPixels = 1.0f;
+static const float kLodTilePixels = 4.0f;
+static LodGrid viewLod;   // over the Scene view
+static LodGrid gatherLod; // over one layer cache tile
+static SceneViewStats viewStats;
+
+SceneViewStats GetSceneViewStats()
+{
+	return viewStats;
+}
+
+static void LodResize(LodGrid& g, int tilesX, int tilesY)
+{
+	if (g.tilesX != tilesX || g.tilesY != tilesY)
+	{
+		g.tiles.assign(tilesX * tilesY, LodTile());
+		g.tilesX = tilesX;
+		g.tilesY = tilesY;
+	}
+}
+
+// Adds a sub-pixel object whose center is at (sx, sy) pixels from the grid origin.
+static void LodAdd(LodGrid& g, float sx, float sy, const Rect& R, float sw, float sh, bool selected)
+{
+	int tx = (int)Clamp(sx / kLodTilePixels, 0.0f, (float)(g.tilesX - 1));
+	int ty = (int)Clamp(sy / kLodTilePixels, 0.0f, (float)(g.tilesY - 1));
+	LodTile& T = g.tiles[ty * g.tilesX + tx];
+	if (!T.touched)
+	{
+		T.touched = true;
+		g.touched.push_back(ty * g.tilesX + tx);
+	}
+	float weight = sw * sh * R.color.w;
+	T.r += R.color.x * weight;
+	T.g += R.color.y * weight;
+	T.b += R.color.z * weight;
+	T.coverage += weight;
+	T.selected |= selected;
+}
+
+// One quad per touched tile, placed from origin; the arrays need room for
+// g.touched.size() quads. Only touched tiles are visited, and they are zeroed
+// again on the way out.
+static int LodResolve(LodGrid& g, ImVec2 origin, float alpha, ImVec2* mins, ImVec2* maxs, ImU32* fills)
+{
+	const float tileArea = kLodTilePixels * kLodTilePixels;
+	int n = 0;
+	for (int t : g.touched)
+	{
+		LodTile& T = g.tiles[t];
+		if (T.coverage <= 0.0f)
+		{
+			T = LodTile();
+			continue;
+		}
+		float inv = 1.0f / T.coverage;
+		ImVec4 c = T.selected ? ImVec4(1.0f, 1.0f, 0.0f, 1.0f) : ImVec4(T.r * inv, T.g * inv, T.b * inv, std::min(T.coverage / tileArea, 1.0f));
+		float x = origin.x + (t % g.tilesX) * kLodTilePixels, y = origin.y + (t / g.tilesX) * kLodTilePixels;
+		mins[n] = ImVec2(x, y);
+		maxs[n] = ImVec2(x + kLodTilePixels, y + kLodTilePixels);
+		fills[n] = PackColorU32(c, alpha);
+		++n;
+		T = LodTile();
+	}
+	g.touched.clear();
+	return n;
+}
+
+static void EmitLodTiles(ImDrawList* draw, ImVec2 p0, float alpha)
+{
+	int touched = (int)viewLod.touched.size();
+	ImVec2* mins = (ImVec2*)FrameAlloc(touched * sizeof(ImVec2));
+	ImVec2* maxs = (ImVec2*)FrameAlloc(touched * sizeof(ImVec2));
+	ImU32* fills = (ImU32*)FrameAlloc(touched * sizeof(ImU32));
+	int n = LodResolve(viewLod, p0, alpha, mins, maxs, fills);
+	AddRectFilledBatch(draw, mins, maxs, fills, n);
+	viewStats.lodQuads = n;
+}
+
+// Sprites are drawn in runs that share an atlas page, one draw call per run.
+// Solid rects inside a run sample the page's white texel, so only a change of
+// page in draw order starts a new run.
+static void EmitSpriteRuns(ImDrawList* draw, const ImVec2* mins, const ImVec2* maxs, ImVec2* uvMins, ImVec2* uvMaxs, const ImU32* fills, const int* pageOf, int n)
+{
+	int start = 0, page = -1;
+	auto flush = [&](int end)
+	{
+		ImVec2 white = AtlasWhiteUV(page);
+		for (int i = start; i < end; ++i)
+		{
+			if (pageOf[i] < 0)
+			{
+				uvMins[i] = uvMaxs[i] = white;
+			}
+		}
+		draw->PushTexture(AtlasPageTexture(page));
+		AddImageBatch(draw, mins + start, maxs + start, uvMins + start, uvMaxs + start, fills + start, end - start);
+		draw->PopTexture();
+		start = end;
+	};
+	for (int i = 0; i < n; ++i)
+	{
+		if (pageOf[i] >= 0 && pageOf[i] != page)
+		{
+			if (page >= 0)
+			{
+				flush(i);
+			}
+			page = pageOf[i];
+		}
+	}
+	flush(n);
+}
+
+// Culls against the camera, sends sub-pixel objects to LOD tiles and bulk-draws
+// the rest, selected objects and sprites last. With liveOnly, only those are
+// drawn; the layer cache has the rest.
+static void EmitSceneObjects(ImDrawList* draw, ImVec2 p0, ImVec2 avail, bool liveOnly)
+{
+	int count = liveOnly ? cachedLive.count : (int)objects.size();
+	ViewRect view = VisibleWorldRect(avail);
+	float zoom = sceneCamera.zoom;
+	LodResize(viewLod, std::max(1, (int)std::ceil(avail.x / kLodTilePixels)), std::max(1, (int)std::ceil(avail.y / kLodTilePixels)));
+
+	// Corners and colors go through the frame arena so the whole scene is one bulk draw.
+	ImVec2* mins = (ImVec2*)FrameAlloc(count * sizeof(ImVec2));
+	ImVec2* maxs = (ImVec2*)FrameAlloc(count * sizeof(ImVec2));
+	ImU32* fills = (ImU32*)FrameAlloc(count * sizeof(ImU32));
+	// UVs and pages only when there are sprites to draw.
+	int images = AtlasImageCount();
+	ImVec2* uvMins = nullptr;
+	ImVec2* uvMaxs = nullptr;
+	int* pageOf = nullptr;
+	if (images > 0 && spriteObjects.count > 0)
+	{
+		uvMins = (ImVec2*)FrameAlloc(count * sizeof(ImVec2));
+		uvMaxs = (ImVec2*)FrameAlloc(count * sizeof(ImVec2));
+		pageOf = (int*)FrameAlloc(count * sizeof(int));
+	}
+	float alpha = ImGui::GetStyle().Alpha;
+	int n = 0, aggregated = 0, sprites = 0;
+	auto visit = [&](int i)
+	{
+		const Rect& R = objects[i];
+		if (R.x > view.x1 || R.x + R.w < view.x0 || R.y > view.y1 || R.y + R.h < view.y0)
+		{
+			return;
+		}
+		float sw = R.w * zoom, sh = R.h * zoom;
+		if (sw < kLodPixels && sh < kLodPixels)
+		{
+			LodAdd(viewLod, ((R.x + R.w * 0.5f) - view.x0) * zoom, ((R.y + R.h * 0.5f) - view.y0) * zoom, R, sw, sh, SelectionContains(selection, i));
+			++aggregated;
+			return;
+		}
+		mins[n] = WorldToScreen(p0, R.x, R.y);
+		maxs[n] = WorldToScreen(p0, R.x + R.w, R.y + R.h);
+		fills[n] = PackColorU32(R.color, alpha);
+		if (pageOf)
+		{
+			pageOf[n] = -1;
+			if (R.sprite >= 0 && R.sprite < images)
+			{
+				const AtlasImage& img = AtlasGetImage(R.sprite);
+				pageOf[n] = img.page;
+				uvMins[n] = img.uv0;
+				uvMaxs[n] = img.uv1;
+				++sprites;
+			}
+		}
+		++n;
+	};
+	if (liveOnly)
+	{
+		SelectionForEach(cachedLive, visit);
+	}
+	else
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			if (!SelectionContains(cachedLive, i))
+			{
+				visit(i);
+			}
+		}
+		SelectionForEach(cachedLive, visit);
+	}
+
+	viewStats.drawn = n;
+	viewStats.aggregated = aggregated;
+	viewStats.lodQuads = 0;
+	if (!viewLod.touched.empty())
+	{
+		EmitLodTiles(draw, p0, alpha);
+	}
+	if (sprites > 0)
+	{
+		EmitSpriteRuns(draw, mins, maxs, uvMins, uvMaxs, fills, pageOf, n);
+	}
+	else
+	{
+		AddRectFilledBatch(draw, mins, maxs, fills, n);
+	}
+}
+
+// Objects entering or leaving the selection, or gaining or losing a sprite,
+// move between the live and the cached layer, so the tiles under them are redrawn.
+static void SyncLiveSet()
+{
+	int count = (int)objects.size();
+	SelectionResize(liveObjects, count);
+	for (int w = 0; w < (int)liveObjects.words.size(); ++w)
+	{
+		uint64_t selected = w < (int)selection.words.size() ? selection.words[w] : 0;
+		liveObjects.words[w] = selected | spriteObjects.words[w];
+	}
+	if ((count & 63) && !liveObjects.words.empty())
+	{
+		liveObjects.words.back() &= (1ull << (count & 63)) - 1;
+	}
+	liveObjects.count = HitMaskPopCount(liveObjects.words.data(), count);
+
+	if (cachedLive.objectCount != count)
+	{
+		LayerCacheInvalidateAll();
+		cachedLive = liveObjects;
+		return;
+	}
+	for (int w = 0; w < (int)liveObjects.words.size(); ++w)
+	{
+		uint64_t changed = cachedLive.words[w] ^ liveObjects.words[w];
+		for (uint64_t bits = changed; bits; bits &= bits - 1)
+		{
+			const Rect& R = objects[w * 64 + HitLowestBit(bits)];
+			LayerCacheInvalidateRect(R.x, R.y, R.x + R.w, R.y + R.h);
+		}
+		cachedLive.words[w] = liveObjects.words[w];
+	}
+	cachedLive.count = liveObjects.count;
+}
+
+// Cached (not live) objects overlapping the world rect, in draw order, as
+// tile-local pixels. Sub-pixel objects are folded into LOD quads as in the
+// direct path, which come first; a GL tile would otherwise drop any object
+// that covers no pixel center.
+static int GatherCachedObjects(float x0, float y0, float x1, float y1, float zoom, ImVec2** mins, ImVec2** maxs, ImU32** colors)
+{
+	int count = (int)objects.size();
+	int words = HitMaskWords(count);
+	uint64_t* mask = (uint64_t*)FrameAlloc(words * sizeof(uint64_t));
+	QuerySceneRect(x0, y0, x1, y1, HitRectMode_Overlap, mask);
+	for (int w = 0; w < words; ++w)
+	{
+		mask[w] &= ~cachedLive.words[w];
+	}
+	int hits = HitMaskPopCount(mask, count);
+	*mins = (ImVec2*)FrameAlloc(hits * sizeof(ImVec2));
+	*maxs = (ImVec2*)FrameAlloc(hits * sizeof(ImVec2));
+	*colors = (ImU32*)FrameAlloc(hits * sizeof(ImU32));
+	float alpha = ImGui::GetStyle().Alpha;
+	int lodTiles = (int)std::ceil((x1 - x0) * zoom / kLodTilePixels);
+	LodResize(gatherLod, std::max(1, lodTiles), std::max(1, lodTiles));
+	int n = 0;
+	for (int w = 0; w < words; ++w)
+	{
+		for (uint64_t bits = mask[w]; bits; bits &= bits - 1)
+		{
+			const Rect& R = objects[w * 64 + HitLowestBit(bits)];
+			float sw = R.w * zoom, sh = R.h * zoom;
+			if (sw < kLodPixels && sh < kLodPixels)
+			{
+				// Counted once, by the tile that holds its center.
+				float cx = R.x + R.w * 0.5f, cy = R.y + R.h * 0.5f;
+				if (cx >= x0 && cx < x1 && cy >= y0 && cy < y1)
+				{
+					LodAdd(gatherLod, (cx - x0) * zoom, (cy - y0) * zoom, R, sw, sh, false);
+				}
+				continue;
+			}
+			(*mins)[n] = ImVec2((R.x - x0) * zoom, (R.y - y0) * zoom);
+			(*maxs)[n] = ImVec2((R.x + R.w - x0) * zoom, (R.y + R.h - y0) * zoom);
+			(*colors)[n] = PackColorU32(R.color, alpha);
+			++n;
+		}
+	}
+	// Every quad stands for at least one hit, so they fit in front of the
+	// full-size objects.
+	int quads = (int)gatherLod.touched.size();
+	if (quads > 0)
+	{
+		memmove(*mins + quads, *mins, n * sizeof(ImVec2));
+		memmove(*maxs + quads, *maxs, n * sizeof(ImVec2));
+		memmove(*colors + quads, *colors, n * sizeof(ImU32));
+		n += LodResolve(gatherLod, ImVec2(0.0f, 0.0f), alpha, *mins, *maxs, *colors);
+	}
+	return n;
+}
+
+// Selection outlines as four inset edge strips per visible, full-detail object, also batched.
+static void EmitSelectionOutlines(ImDrawList* draw, ImVec2 p0, ImVec2 avail)
+{
+	if (selection.count == 0)
+	{
+		return;
+	}
+	ViewRect view = VisibleWorldRect(avail);
+	float zoom = sceneCamera.zoom;
+	int strips = selection.count * 4;
+	ImVec2* smin = (ImVec2*)FrameAlloc(strips * sizeof(ImVec2));
+	ImVec2* smax = (ImVec2*)FrameAlloc(strips * sizeof(ImVec2));
+	ImU32* scol = (ImU32*)FrameAlloc(strips * sizeof(ImU32));
+	const float t = 2.0f;
+	int n = 0;
+	SelectionForEach(selection, [&](int i)
+	{
+		const Rect& R = objects[i];
+		if (R.x > view.x1 || R.x + R.w < view.x0 || R.y > view.y1 || R.y + R.h < view.y0
+			|| (R.w * zoom < kLodPixels && R.h * zoom < kLodPixels))
+		{
+			return;
+		}
+		ImVec2 a = WorldToScreen(p0, R.x, R.y), b = WorldToScreen(p0, R.x + R.w, R.y + R.h);
+		smin[n] = a;                            smax[n++] = ImVec2(b.x, a.y + t);
+		smin[n] = ImVec2(a.x, b.y - t);         smax[n++] = b;
+		smin[n] = ImVec2(a.x, a.y + t);         smax[n++] = ImVec2(a.x + t, b.y - t);
+		smin[n] = ImVec2(b.x - t, a.y + t);     smax[n++] = ImVec2(b.x, b.y - t);
+	});
+	for (int s = 0; s < n; ++s)
+	{
+		scol[s] = IM_COL32(255, 255, 0, 255);
+	}
+	AddRectFilledBatch(draw, smin, smax, scol, n);
+}
+
+void DrawSceneView()
+{
+	PROFILE_FUNCTION();
+	ImGui::Begin("Scene", nullptr, ImGuiWindowFlags_NoMove);
+
+
+	ImVec2 p0 = ImGui::GetCursorScreenPos();
+	ImVec2 avail = ImGui::GetContentRegionAvail();
+	ImDrawList* draw = ImGui::GetWindowDrawList();
+
+	GpuDrawListZoneBegin(draw, "DrawSceneView");
+	draw->AddRectFilled(p0, ImVec2(p0.x + avail.x, p0.y + avail.y),
+		IM_COL32(50, 50, 50, 255));
+	SelectionResize(selection, (int)objects.size());
+	HandleCameraInput(p0);
+	if (!playMode)
+	{
+		HandleSceneInput(p0, avail);
+	}
+	else
+	{
+		if (groupDrag)
+		{
+			UndoEndEdit(kMoveEdit);
+		}
+		groupDrag = false;
+		marqueeActive = false;
+	}
+
+	SyncSceneBounds();
+	SyncLiveSet();
+	bool cached = !playMode && LayerCacheDraw(draw, p0, avail, sceneCamera.pan, sceneCamera.zoom, GatherCachedObjects);
+	EmitSceneObjects(draw, p0, avail, cached);
+	EmitSelectionOutlines(draw, p0, avail);
+
+	if (marqueeActive)
+	{
+		ImVec2 mp = ImGui::GetMousePos();
+		ImVec2 a = WorldToScreen(p0, marqueeStart.x, marqueeStart.y);
+		ImVec2 ra(std::min(a.x, mp.x), std::min(a.y, mp.y)), rb(std::max(a.x, mp.x), std::max(a.y, mp.y));
+		draw->AddRectFilled(ra, rb, IM_COL32(80, 140, 255, 40));
+		draw->AddRect(ra, rb, IM_COL32(80, 140, 255, 200));
+	}
+
+	draw->AddText(ImVec2(p0.x + 6.0f, p0.y + 4.0f), IM_COL32(200, 200, 200, 255),
+		FrameFormat("%.0f%%  %d drawn  %d in %d LOD tiles", sceneCamera.zoom * 100.0f, viewStats.drawn, viewStats.aggregated, viewStats.lodQuads));
+	GpuDrawListZoneEnd(draw);
+	ImGui::End();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+
+#include "imgui.h"
+#include "selection.h"
+#include "scene_changes.h"
+
+// A solid rect, or a sprite when it names an atlas image (texture_atlas.h);
+// sprites are tinted by color.
+struct Rect {
+	float x, y, w, h;
+	ImVec4 color;
+	int sprite = -1;
+};
+
+// Code that writes to objects reports it through MarkObjectChanged or
+// MarkAllObjectsChanged (scene_changes.h); picking, region queries and the
+// layer cache only see edits that were reported.
+extern std::vector<Rect> objects;
+extern SelectionSet selection;
+// Primary object of the selection (the one the Inspector edits), or -1.
+extern int selectedIndex;
+extern bool playMode;
+
+// Scene view transform: screen = view origin + (world - pan) * zoom.
+struct SceneCamera {
+	ImVec2 pan = ImVec2(0.0f, 0.0f);
+	float zoom = 1.0f;
+};
+extern SceneCamera sceneCamera;
+
+inline float Clamp(float v, float min, float max) {
+	return v < min ? min : (v > max ? max : v);
+}
+
+// Topmost object containing the world-space point, or -1. Selected objects
+// and sprites are drawn above the rest, so they come first.
+int PickObject(float lx, float ly);
+
+
+// Sets bit i of mask (HitMaskWords(objects.size()) words) for every object
+// overlapping or inside the world-space rect. Large scenes go through a
+// uniform grid that is rebuilt only after bounds change.
+void QuerySceneRect(float x0, float y0, float x1, float y1, HitRectMode mode, uint64_t* mask);
+
+void UpdateScene(float deltaTime, ImVec2 bounds);
+
+// Inserts values so that they land at indices, which are ascending positions
+// in the result.
+void InsertRects(std::vector<Rect>& v, const int* indices, const Rect* values, int count);
+// Erases the objects at indices (ascending); later objects move down.
+void EraseRects(std::vector<Rect>& v, const int* indices, int count);
+
+// Appends an offset copy of every selected object and selects the copies;
+// removes the selected objects. Both are recorded in the scene journal and
+// the undo history.
+void DuplicateSelection();
+void DeleteSelection();
+
+// What the last DrawSceneView emitted: objects drawn individually, objects
+// folded into LOD tiles, and the tile quads that stood in for them.
+struct SceneViewStats {
+	int drawn = 0;
+	int aggregated = 0;
+	int lodQuads = 0;
+};
+SceneViewStats GetSceneViewStats();
+
+void DrawInspector();
+void DrawSceneView();
@@ -0,0 +1,86 @@
+#include "scene_changes.h"
+
+#include <algorithm>
+
+#include "scene.h"
+
+static std::vector<SceneChangeChannel*> channels;
+static std::vector<uint64_t> objectVersions;
+static uint64_t sceneVersion = 0;
+static uint64_t allVersion = 0; // version of the last Mark-all
+
+void SceneChangesRegister(SceneChangeChannel* channel)
+{
+	channels.push_back(channel);
+	// A new consumer has seen nothing yet.
+	channel->all = SceneChange_All;
+}
+
+void SceneChangesUnregister(SceneChangeChannel* channel)
+{
+	channels.erase(std::remove(channels.begin(), channels.end(), channel), channels.end());
+}
+
+void MarkObjectChanged(int index, uint32_t what)
+{
+	if (index < 0)
+	{
+		return;
+	}
+	++sceneVersion;
+	if (index >= (int)objectVersions.size())
+	{
+		objectVersions.resize(index + 1, 0);
+	}
+	objectVersions[index] = sceneVersion;
+	for (SceneChangeChannel* ch : channels)
+	{
+		if (ch->all)
+		{
+			ch->all |= what;
+			continue;
+		}
+		if (index >= (int)ch->pending.size())
+		{
+			ch->pending.resize(std::max<size_t>(index + 1, ch->pending.size() * 2), 0);
+		}
+		uint8_t& bits = ch->pending[index];
+		if (!bits)
+		{
+			ch->changed.push_back(index);
+			// Past a quarter of the objects, a full rescan is cheaper than the
+			// list. What is already pending folds into all, so the consumer
+			// still learns every kind of change.
+			if (ch->changed.size() > objects.size() / 4 + 64)
+			{
+				uint32_t folded = what;
+				for (int c : ch->changed)
+				{
+					folded |= ch->pending[c];
+				}
+				ch->all = folded;
+			}
+		}
+		bits |= (uint8_t)what;
+	}
+}
+
+void MarkAllObjectsChanged(uint32_t what)
+{
+	allVersion = ++sceneVersion;
+	for (SceneChangeChannel* ch : channels)
+	{
+		ch->all |= what;
+	}
+}
+
+uint64_t GetSceneVersion()
+{
+	return sceneVersion;
+}
+
+uint64_t GetObjectVersion(int index)
+{
+	uint64_t v = index >= 0 && index < (int)objectVersions.size() ? objectVersions[index] : 0;
+	return std::max(v, allVersion);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Change tracking for scene objects. Every mutation of `objects` is reported
+// here with the components it touched. Each consumer (bounds columns, layer
+// cache, serializers) owns a channel that collects the indices changed since
+// it last looked, so catching up costs only the number of changed objects.
+// Per-object versions answer "has this changed since X" without a channel.
+
+enum SceneChange {
+	SceneChange_Position  = 1 << 0,
+	SceneChange_Size      = 1 << 1,
+	SceneChange_Color     = 1 << 2,
+	SceneChange_Structure = 1 << 3, // objects added, removed or reordered
+	SceneChange_Sprite    = 1 << 4,
+	SceneChange_Bounds    = SceneChange_Position | SceneChange_Size,
+	SceneChange_All       = 0x1F
+};
+
+struct SceneChangeChannel {
+	std::vector<uint8_t> pending; // per object: SceneChange bits not yet consumed
+	std::vector<int> changed;     // objects with non-zero pending, in first-touch order
+	uint32_t all = 0;             // set when everything must be treated as changed
+};
+
+// Channels must stay alive while registered.
+void SceneChangesRegister(SceneChangeChannel* channel);
+void SceneChangesUnregister(SceneChangeChannel* channel);
+
+void MarkObjectChanged(int index, uint32_t what);
+// For edits that touch every object (simulation, loading, add/remove). O(1).
+void MarkAllObjectsChanged(uint32_t what);
+
+// Bumped by every Mark call.
+uint64_t GetSceneVersion();
+// Scene version of the last change to the object.
+uint64_t GetObjectVersion(int index);
+
+// Calls fn(index, what) for each object changed since the last call, then
+// empties the channel. When the channel overflowed into "all" (a quarter of
+// the objects or a Mark-all call), fn is not called and the bits of what
+// changed are returned instead, including those still pending per object;
+// the caller rescans everything.
+template <typename Fn>
+uint32_t ConsumeSceneChanges(SceneChangeChannel& channel, Fn fn)
+{
+	uint32_t all = channel.all;
+	for (int i : channel.changed)
+	{
+		if (channel.all)
+		{
+			all |= channel.pending[i];
+		}
+		else
+		{
+			fn(i, (uint32_t)channel.pending[i]);
+		}
+		channel.pending[i] = 0;
+	}
+	channel.changed.clear();
+	channel.all = 0;
+	return all;
+}
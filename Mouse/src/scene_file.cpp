@@ -0,0 +1,390 @@
+#include "scene_file.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "file_util.h"
+#include "profiler.h"
+#include "scene_journal.h"
+#include "scene_text.h"
+#include "undo_history.h"
+
+static const char kMagic[4] = { 'M', 'S', 'C', 'N' };
+static const size_t kColumnAlign = 64;
+static const int kWriteChunk = 16384; // elements converted per write
+
+enum SceneColumn {
+	SceneColumn_X,
+	SceneColumn_Y,
+	SceneColumn_W,
+	SceneColumn_H,
+	SceneColumn_Color,
+	SceneColumn_Sprite,
+	SceneColumn_MinX,  // bounds, paddedCount long
+	SceneColumn_MinY,
+	SceneColumn_MaxX,
+	SceneColumn_MaxY,
+	SceneColumn_Count
+};
+
+static const uint32_t kColumnSizes[SceneColumn_Count] = { 4, 4, 4, 4, 16, 4, 4, 4, 4, 4 };
+
+struct SceneFileColumn {
+	uint32_t id;
+	uint32_t elementSize;
+	uint64_t offset;
+};
+
+// Readers find columns by id, so later versions can add columns.
+struct SceneFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t headerSize;   // including the column table
+	uint32_t columnCount;
+	uint64_t objectCount;
+	uint64_t paddedCount;  // length of the bounds columns
+	uint64_t fileSize;
+	SceneFileColumn columns[SceneColumn_Count];
+};
+
+static uint64_t AlignUp(uint64_t v)
+{
+	return (v + kColumnAlign - 1) & ~(uint64_t)(kColumnAlign - 1);
+}
+
+static uint64_t PaddedCount(uint64_t count)
+{
+	return (count + 15) & ~(uint64_t)15;
+}
+
+static uint64_t ColumnLength(int id, const SceneFileHeader& h)
+{
+	return id >= SceneColumn_MinX ? h.paddedCount : h.objectCount;
+}
+
+// Mapping -------------------------------------------------------------------
+
+static bool MapFile(const char* path, SceneFileView& view, const char** error)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return Fail(error, "cannot open the file");
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(SceneFileHeader))
+	{
+		CloseHandle(file);
+		return Fail(error, "not a scene file");
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* base = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!base)
+	{
+		if (mapping)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return Fail(error, "cannot map the file");
+	}
+	view.file = file;
+	view.mapping = mapping;
+	view.size = (size_t)size.QuadPart;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return Fail(error, "cannot open the file");
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SceneFileHeader))
+	{
+		close(fd);
+		return Fail(error, "not a scene file");
+	}
+	void* base = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+	{
+		return Fail(error, "cannot map the file");
+	}
+	view.size = (size_t)st.st_size;
+#endif
+	view.base = base;
+	return true;
+}
+
+void SceneFileClose(SceneFileView& view)
+{
+	if (view.base)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(view.base);
+		CloseHandle((HANDLE)view.mapping);
+		CloseHandle((HANDLE)view.file);
+#else
+		munmap((void*)view.base, view.size);
+#endif
+	}
+	view = SceneFileView();
+}
+
+// Header checks only: nothing past the header is read here.
+bool SceneFileOpen(const char* path, SceneFileView& view, const char** error)
+{
+	PROFILE_FUNCTION();
+	SceneFileClose(view);
+	if (!MapFile(path, view, error))
+	{
+		return false;
+	}
+	SceneFileHeader h;
+	memcpy(&h, view.base, sizeof(h));
+	const char* problem = nullptr;
+	if (memcmp(h.magic, kMagic, sizeof(kMagic)) != 0)
+	{
+		problem = "not a scene file";
+	}
+	else if (h.version != kSceneFileVersion)
+	{
+		problem = "unsupported scene file version";
+	}
+	else if (h.headerSize < sizeof(SceneFileHeader) || h.headerSize > view.size || h.columnCount > 64 || h.headerSize < offsetof(SceneFileHeader, columns) + (uint64_t)h.columnCount * sizeof(SceneFileColumn)
+		|| h.fileSize != view.size || h.objectCount > (uint64_t)std::numeric_limits<int>::max() - 16 || h.paddedCount != PaddedCount(h.objectCount))
+	{
+		problem = "corrupt scene file header";
+	}
+
+	const char* columns[SceneColumn_Count] = {};
+	const SceneFileColumn* table = (const SceneFileColumn*)((const char*)view.base + offsetof(SceneFileHeader, columns));
+	for (uint32_t c = 0; !problem && c < h.columnCount; ++c)
+	{
+		SceneFileColumn col;
+		memcpy(&col, table + c, sizeof(col));
+		if (col.id >= SceneColumn_Count)
+		{
+			continue;
+		}
+		uint64_t bytes = ColumnLength(col.id, h) * col.elementSize;
+		if (col.elementSize != kColumnSizes[col.id] || col.offset % kColumnAlign != 0 || col.offset > view.size || view.size - col.offset < bytes)
+		{
+			problem = "corrupt scene file column";
+			break;
+		}
+		columns[col.id] = (const char*)view.base + col.offset;
+	}
+	for (int c = 0; !problem && c < SceneColumn_Count; ++c)
+	{
+		if (!columns[c])
+		{
+			problem = "scene file is missing a column";
+		}
+	}
+	if (problem)
+	{
+		SceneFileClose(view);
+		return Fail(error, problem);
+	}
+
+	view.count = (int)h.objectCount;
+	view.x = (const float*)columns[SceneColumn_X];
+	view.y = (const float*)columns[SceneColumn_Y];
+	view.w = (const float*)columns[SceneColumn_W];
+	view.h = (const float*)columns[SceneColumn_H];
+	view.color = (const ImVec4*)columns[SceneColumn_Color];
+	view.sprite = (const int32_t*)columns[SceneColumn_Sprite];
+	// The mapping is read-only; the hit-test kernels only read.
+	view.bounds.minX = (float*)columns[SceneColumn_MinX];
+	view.bounds.minY = (float*)columns[SceneColumn_MinY];
+	view.bounds.maxX = (float*)columns[SceneColumn_MaxX];
+	view.bounds.maxY = (float*)columns[SceneColumn_MaxY];
+	view.bounds.count = view.count;
+	view.bounds.capacity = (int)h.paddedCount;
+	return true;
+}
+
+// Saving --------------------------------------------------------------------
+
+struct StreamWriter {
+	FILE* f;
+	uint64_t written;
+	bool ok;
+};
+
+static void Put(StreamWriter& out, const void* data, size_t bytes)
+{
+	out.ok = out.ok && fwrite(data, 1, bytes, out.f) == bytes;
+	out.written += bytes;
+}
+
+static void PadTo(StreamWriter& out, uint64_t offset)
+{
+	static const char zeros[kColumnAlign] = {};
+	while (out.written < offset)
+	{
+		Put(out, zeros, (size_t)std::min<uint64_t>(offset - out.written, kColumnAlign));
+	}
+}
+
+// Converts kWriteChunk elements at a time from the objects into one column.
+template <typename T, typename Fn>
+static void WriteColumn(StreamWriter& out, uint64_t offset, int count, int length, T pad, Fn get)
+{
+	static T chunk[kWriteChunk];
+	PadTo(out, offset);
+	for (int start = 0; start < length; start += kWriteChunk)
+	{
+		int n = std::min(kWriteChunk, length - start);
+		for (int i = 0; i < n; ++i)
+		{
+			chunk[i] = start + i < count ? get(start + i) : pad;
+		}
+		Put(out, chunk, n * sizeof(T));
+	}
+}
+
+bool SceneFileSave(const char* path, const std::vector<Rect>& objects, const char** error)
+{
+	PROFILE_FUNCTION();
+	int count = (int)objects.size();
+	SceneFileHeader h = {};
+	memcpy(h.magic, kMagic, sizeof(kMagic));
+	h.version = kSceneFileVersion;
+	h.headerSize = sizeof(SceneFileHeader);
+	h.columnCount = SceneColumn_Count;
+	h.objectCount = (uint64_t)count;
+	h.paddedCount = PaddedCount(count);
+	uint64_t offset = AlignUp(sizeof(SceneFileHeader));
+	for (int c = 0; c < SceneColumn_Count; ++c)
+	{
+		h.columns[c].id = (uint32_t)c;
+		h.columns[c].elementSize = kColumnSizes[c];
+		h.columns[c].offset = offset;
+		offset = AlignUp(offset + ColumnLength(c, h) * kColumnSizes[c]);
+	}
+	h.fileSize = offset;
+
+	char temp[1024];
+	snprintf(temp, sizeof(temp), "%s.tmp", path);
+	FILE* f = fopen(temp, "wb");
+	if (!f)
+	{
+		return Fail(error, "cannot create the file");
+	}
+	setvbuf(f, nullptr, _IOFBF, 1 << 20);
+	StreamWriter out = { f, 0, true };
+	Put(out, &h, sizeof(h));
+	const Rect* R = objects.data();
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const ImVec4 clear(0.0f, 0.0f, 0.0f, 0.0f);
+	WriteColumn(out, h.columns[SceneColumn_X].offset, count, count, 0.0f, [R](int i) { return R[i].x; });
+	WriteColumn(out, h.columns[SceneColumn_Y].offset, count, count, 0.0f, [R](int i) { return R[i].y; });
+	WriteColumn(out, h.columns[SceneColumn_W].offset, count, count, 0.0f, [R](int i) { return R[i].w; });
+	WriteColumn(out, h.columns[SceneColumn_H].offset, count, count, 0.0f, [R](int i) { return R[i].h; });
+	WriteColumn(out, h.columns[SceneColumn_Color].offset, count, count, clear, [R](int i) { return R[i].color; });
+	WriteColumn(out, h.columns[SceneColumn_Sprite].offset, count, count, (int32_t)-1, [R](int i) { return (int32_t)R[i].sprite; });
+	int padded = (int)h.paddedCount;
+	WriteColumn(out, h.columns[SceneColumn_MinX].offset, count, padded, nan, [R](int i) { return R[i].x; });
+	WriteColumn(out, h.columns[SceneColumn_MinY].offset, count, padded, nan, [R](int i) { return R[i].y; });
+	WriteColumn(out, h.columns[SceneColumn_MaxX].offset, count, padded, nan, [R](int i) { return R[i].x + R[i].w; });
+	WriteColumn(out, h.columns[SceneColumn_MaxY].offset, count, padded, nan, [R](int i) { return R[i].y + R[i].h; });
+	PadTo(out, h.fileSize);
+	bool ok = out.ok && fclose(f) == 0;
+	if (!ok || !FileReplace(temp, path))
+	{
+		remove(temp);
+		return Fail(error, ok ? "cannot replace the file" : "write failed");
+	}
+	return true;
+}
+
+bool SceneFileLoad(const char* path, const char** error)
+{
+	PROFILE_FUNCTION();
+	SceneFileView view;
+	if (!SceneFileOpen(path, view, error))
+	{
+		return false;
+	}
+	int count = view.count;
+	objects.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		Rect& R = objects[i];
+		R.x = view.x[i];
+		R.y = view.y[i];
+		R.w = view.w[i];
+		R.h = view.h[i];
+		R.color = view.color[i];
+		R.sprite = view.sprite[i];
+	}
+	SceneFileClose(view);
+	SelectionResize(selection, count);
+	SelectionClear(selection);
+	selectedIndex = -1;
+	UndoClear();
+	MarkAllObjectsChanged(SceneChange_All);
+	return true;
+}
+
+void DrawSceneFileUI()
+{
+	if (!ImGui::CollapsingHeader("Scene File"))
+	{
+		return;
+	}
+	static char path[256] = "scene.mscn";
+	static char status[128] = "";
+	ImGui::InputText("##scenefile", path, sizeof(path));
+	bool text = SceneTextMatchesPath(path);
+	ImGui::SameLine();
+	ImGui::TextDisabled(text ? "text" : "binary");
+	bool save = ImGui::Button("Save");
+	ImGui::SameLine();
+	bool load = ImGui::Button("Load");
+	if (save || load)
+	{
+		const char* error = nullptr;
+		auto start = std::chrono::steady_clock::now();
+		bool ok;
+		if (text)
+		{
+			ok = save ? SceneTextSave(path, objects, &error) : SceneTextLoad(path, &error);
+		}
+		else
+		{
+			ok = save ? SceneFileSave(path, objects, &error) : SceneFileLoad(path, &error);
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (ok)
+		{
+			SceneJournalSetSource(path);
+			snprintf(status, sizeof(status), "%s %d objects in %.1f ms", save ? "Saved" : "Loaded", (int)objects.size(), ms);
+		}
+		else
+		{
+			snprintf(status, sizeof(status), "%s failed: %s", save ? "Save" : "Load", error);
+		}
+	}
+	if (status[0])
+	{
+		ImGui::TextDisabled("%s", status);
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "hit_test.h"
+#include "scene.h"
+
+// Binary scene files (.mscn). The file is a small header followed by one
+// column per Rect field, plus the four bounds columns in the HitColumns
+// layout: 64-byte aligned and NaN-padded to a multiple of 16. Opening a file
+// maps it read-only and checks the header; the columns are then used in
+// place, so opening costs the same for ten objects or ten million and pages
+// come in as they are first touched. All values are little-endian.
+
+static const uint32_t kSceneFileVersion = 1;
+
+// A mapped scene file. Everything points into the mapping and stays valid
+// until SceneFileClose. bounds can be passed to the hit-test queries; it
+// must never be resized or freed.
+struct SceneFileView {
+	int count = 0;
+	const float* x = nullptr;
+	const float* y = nullptr;
+	const float* w = nullptr;
+	const float* h = nullptr;
+	const ImVec4* color = nullptr;
+	const int32_t* sprite = nullptr;
+	HitColumns bounds;
+
+	const void* base = nullptr;
+	size_t size = 0;
+	void* file = nullptr;    // platform handles
+	void* mapping = nullptr;
+};
+
+// On failure return false and point error at a static message.
+bool SceneFileOpen(const char* path, SceneFileView& view, const char** error);
+void SceneFileClose(SceneFileView& view);
+
+// Writes the objects as one sequential stream to a temporary file next to
+// path, then renames it over path, so a failed save leaves the old file.
+bool SceneFileSave(const char* path, const std::vector<Rect>& objects, const char** error);
+
+// Replaces the scene with the file's objects and clears the selection.
+// Sprite indices are stored as is; they name images of the atlas as it is
+// built at runtime.
+bool SceneFileLoad(const char* path, const char** error);
+
+// Save and Load buttons for a path; .mtxt paths use the text format
+// (scene_text.h).
+void DrawSceneFileUI();
@@ -0,0 +1,900 @@
+#include "scene_journal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "file_util.h"
+#include "profiler.h"
+
+static const char kMagic[4] = { 'M', 'J', 'N', 'L' };
+static const uint32_t kJournalVersion = 2;
+static const size_t kHeaderBytes = 28; // magic, version, source size and hash, path length; the path follows
+static const uint32_t kMaxSourcePath = 4096;
+static const size_t kFrameBytes = 8;   // payload size, checksum
+static const size_t kRectBytes = 36;   // x y w h, color, sprite
+static const uint32_t kFieldBits = SceneChange_Position | SceneChange_Size | SceneChange_Color | SceneChange_Sprite;
+static const uint32_t kMaxObjects = 1u << 26; // keeps a snapshot frame under 4 GB
+static const uint64_t kMinCompactBytes = 1 << 20;
+static const double kMinSnapshotGap = 2.0;  // seconds between snapshots forced by bulk changes
+static const uint32_t kSnapshotSlice = 1 << 16; // objects encoded per frame while snapshotting
+static const uint32_t kChecksumSeed = 2166136261u;
+
+enum JournalOp {
+	JournalOp_Set = 1,     // index, SceneChange bits, the fields they name
+	JournalOp_Insert = 2,  // count, then an index and every field per object
+	JournalOp_Remove = 3,  // count, then the indices
+	JournalOp_Snapshot = 4 // count, then every field per object; first in the file
+};
+
+// The scene file the journal's edits apply to. A journal is only replayed
+// over the scene it was written for.
+struct JournalSource {
+	std::string path;   // empty for the built-in scene
+	uint64_t size;
+	uint64_t hash;
+};
+
+// Main thread.
+static bool journalOpen = false;
+static std::string journalPath;
+static JournalSource source = { "", 0, 0 };
+static SceneChangeChannel changes;
+static std::vector<uint8_t> batch;     // records of the current pump
+static int journalCount = 0;           // object count as the journal has it
+static bool structurePending = false;  // a recorded insert or remove explains the next Structure mark
+static bool snapshotWanted = false;    // the records can no longer describe the scene
+static bool compactRequested = false;
+static double lastSnapshotTime = 0.0;
+static double compactInterval = 60.0;
+static uint64_t bytesSinceSnapshot = 0;
+static int batchesSinceSnapshot = 0;
+static int recoveredObjects = -1;
+static int recoveredBatches = 0;
+// Snapshot being streamed out, a slice per pump. Set records stay valid
+// across the slices because they carry absolute values; an insert or remove
+// restarts it.
+static bool building = false;
+static bool buildStale = false;
+static uint32_t buildCount = 0;
+static uint32_t buildNext = 0;
+static std::vector<uint8_t> buildSince; // framed batches queued since it started
+static std::vector<uint8_t> slice;
+
+// Shared with the writer.
+static std::mutex journalMutex;
+static std::condition_variable journalCv;
+static std::condition_variable idleCv;
+static std::thread writer;
+static bool stopping = false;
+static bool writerBusy = false;
+static std::vector<uint8_t> queued;       // framed batches waiting for the writer
+static size_t queuedBeforeSnapshot = 0;   // bytes of queued that belong to the old file
+static bool snapshotStart = false;        // begin a new temporary file, dropping any partial one
+static std::vector<uint8_t> snapshotHeader; // file header for it, naming the source
+static std::vector<uint8_t> snapshotData; // snapshot payload for the temporary file
+static bool snapshotDone = false;         // payload complete; swap the file in
+static uint32_t snapshotDoneObjects = 0;
+static bool snapshotFailed = false;
+static SceneJournalStats stats;
+
+// Writer thread.
+static FILE* file = nullptr;
+static std::vector<uint8_t> writing;
+static std::vector<uint8_t> writingSnapshot;
+static FILE* tempFile = nullptr;
+static std::vector<uint8_t> tempHeader;
+static bool tempOk = false;
+static uint64_t tempPayload = 0;
+static uint32_t tempSum = 0;
+static double tempMs = 0.0;
+
+static double Now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// FNV-1a.
+static uint32_t Checksum(uint32_t h, const uint8_t* p, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		h = (h ^ p[i]) * 16777619u;
+	}
+	return h;
+}
+
+// FNV-1a over 64-bit words; the tail is zero padded.
+static uint64_t HashFile(FILE* f, uint64_t& size)
+{
+	uint64_t h = 14695981039346656037ull;
+	size = 0;
+	std::vector<uint64_t> chunk(1 << 17);
+	size_t n;
+	while ((n = fread(chunk.data(), 1, chunk.size() * 8, f)) > 0)
+	{
+		memset((uint8_t*)chunk.data() + n, 0, (8 - n % 8) % 8);
+		for (size_t k = 0; k < (n + 7) / 8; ++k)
+		{
+			h = (h ^ chunk[k]) * 1099511628211ull;
+		}
+		size += n;
+	}
+	return h;
+}
+
+// Records -------------------------------------------------------------------
+
+static void Put(std::vector<uint8_t>& out, const void* data, size_t bytes)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	out.insert(out.end(), p, p + bytes);
+}
+
+static void PutU8(std::vector<uint8_t>& out, uint32_t v)
+{
+	out.push_back((uint8_t)v);
+}
+
+static void PutU32(std::vector<uint8_t>& out, uint32_t v)
+{
+	Put(out, &v, sizeof(v));
+}
+
+static void PutRect(std::vector<uint8_t>& out, const Rect& R, uint32_t what)
+{
+	if (what & SceneChange_Position)
+	{
+		Put(out, &R.x, 4);
+		Put(out, &R.y, 4);
+	}
+	if (what & SceneChange_Size)
+	{
+		Put(out, &R.w, 4);
+		Put(out, &R.h, 4);
+	}
+	if (what & SceneChange_Color)
+	{
+		Put(out, &R.color, 16);
+	}
+	if (what & SceneChange_Sprite)
+	{
+		int32_t sprite = R.sprite;
+		Put(out, &sprite, 4);
+	}
+}
+
+struct Reader {
+	const uint8_t* p;
+	const uint8_t* end;
+	bool ok;
+};
+
+static void Get(Reader& r, void* out, size_t bytes)
+{
+	if (!r.ok || (size_t)(r.end - r.p) < bytes)
+	{
+		r.ok = false;
+		memset(out, 0, bytes);
+		return;
+	}
+	memcpy(out, r.p, bytes);
+	r.p += bytes;
+}
+
+static uint32_t GetU8(Reader& r)
+{
+	uint8_t v;
+	Get(r, &v, 1);
+	return v;
+}
+
+static uint32_t GetU32(Reader& r)
+{
+	uint32_t v;
+	Get(r, &v, 4);
+	return v;
+}
+
+static std::vector<uint8_t> EncodeHeader(const JournalSource& s)
+{
+	std::vector<uint8_t> out;
+	Put(out, kMagic, sizeof(kMagic));
+	PutU32(out, kJournalVersion);
+	Put(out, &s.size, 8);
+	Put(out, &s.hash, 8);
+	PutU32(out, (uint32_t)s.path.size());
+	Put(out, s.path.data(), s.path.size());
+	return out;
+}
+
+static void GetRect(Reader& r, Rect& R, uint32_t what)
+{
+	if (what & SceneChange_Position)
+	{
+		Get(r, &R.x, 4);
+		Get(r, &R.y, 4);
+	}
+	if (what & SceneChange_Size)
+	{
+		Get(r, &R.w, 4);
+		Get(r, &R.h, 4);
+	}
+	if (what & SceneChange_Color)
+	{
+		Get(r, &R.color, 16);
+	}
+	if (what & SceneChange_Sprite)
+	{
+		int32_t sprite;
+		Get(r, &sprite, 4);
+		R.sprite = sprite;
+	}
+}
+
+static bool Remaining(const Reader& r, uint64_t bytes)
+{
+	return (uint64_t)(r.end - r.p) >= bytes;
+}
+
+// Ascending, in [0, limit).
+static bool ValidIndices(const std::vector<int>& indices, size_t limit)
+{
+	for (size_t k = 0; k < indices.size(); ++k)
+	{
+		if (indices[k] < 0 || (size_t)indices[k] >= limit || (k > 0 && indices[k] <= indices[k - 1]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Applies one batch to scene. A snapshot is only valid as the first record
+// of the first batch, and nothing else is.
+static bool ApplyBatch(const uint8_t* data, size_t size, std::vector<Rect>& scene, bool first)
+{
+	Reader r = { data, data + size, true };
+	std::vector<int> indices;
+	std::vector<Rect> values;
+	while (r.ok && r.p < r.end)
+	{
+		uint32_t op = GetU8(r);
+		if (first != (op == JournalOp_Snapshot))
+		{
+			return false;
+		}
+		first = false;
+		uint32_t n = op == JournalOp_Set ? 0 : GetU32(r);
+		if (n > kMaxObjects)
+		{
+			return false;
+		}
+		switch (op)
+		{
+		case JournalOp_Set:
+		{
+			uint32_t index = GetU32(r);
+			uint32_t what = GetU8(r);
+			if (index >= scene.size())
+			{
+				return false;
+			}
+			GetRect(r, scene[index], what);
+			break;
+		}
+		case JournalOp_Insert:
+			if (!Remaining(r, (uint64_t)n * (4 + kRectBytes)))
+			{
+				return false;
+			}
+			indices.resize(n);
+			values.resize(n);
+			for (uint32_t k = 0; k < n; ++k)
+			{
+				indices[k] = (int)GetU32(r);
+				GetRect(r, values[k], kFieldBits);
+			}
+			if (!ValidIndices(indices, scene.size() + n))
+			{
+				return false;
+			}
+			InsertRects(scene, indices.data(), values.data(), (int)n);
+			break;
+		case JournalOp_Remove:
+			if (!Remaining(r, (uint64_t)n * 4))
+			{
+				return false;
+			}
+			indices.resize(n);
+			for (uint32_t k = 0; k < n; ++k)
+			{
+				indices[k] = (int)GetU32(r);
+			}
+			if (!ValidIndices(indices, scene.size()))
+			{
+				return false;
+			}
+			EraseRects(scene, indices.data(), (int)n);
+			break;
+		case JournalOp_Snapshot:
+			if (!Remaining(r, (uint64_t)n * kRectBytes))
+			{
+				return false;
+			}
+			scene.resize(n);
+			for (uint32_t k = 0; k < n; ++k)
+			{
+				GetRect(r, scene[k], kFieldBits);
+			}
+			break;
+		default:
+			return false;
+		}
+	}
+	return r.ok;
+}
+
+// Replays every intact batch. Stops at a torn or corrupt one, which is what a
+// crash in the middle of a write leaves. A journal that is not for the
+// current source (or not readable as one) is left alone and reported foreign.
+static bool Recover(const char* path, std::vector<Rect>& scene, int& batches, bool& foreign)
+{
+	batches = 0;
+	foreign = false;
+	FILE* f = fopen(path, "rb");
+	if (!f)
+	{
+		return false;
+	}
+	PROFILE_FUNCTION();
+	uint8_t header[kHeaderBytes];
+	bool ok = fread(header, 1, sizeof(header), f) == sizeof(header);
+	Reader r = { header, header + sizeof(header), ok };
+	char magic[4];
+	Get(r, magic, sizeof(magic));
+	uint32_t version = GetU32(r);
+	JournalSource s;
+	Get(r, &s.size, 8);
+	Get(r, &s.hash, 8);
+	uint32_t pathBytes = GetU32(r);
+	ok = r.ok && memcmp(magic, kMagic, sizeof(kMagic)) == 0 && version == kJournalVersion && pathBytes <= kMaxSourcePath;
+	if (ok)
+	{
+		s.path.resize(pathBytes);
+		ok = fread(&s.path[0], 1, pathBytes, f) == pathBytes;
+	}
+	if (!ok || s.path != source.path || s.size != source.size || s.hash != source.hash)
+	{
+		fclose(f);
+		foreign = true;
+		return false;
+	}
+	std::vector<uint8_t> payload;
+	while (ok)
+	{
+		uint32_t frame[2];
+		if (fread(frame, 1, sizeof(frame), f) != sizeof(frame) || frame[0] > (uint32_t)(kMaxObjects * kRectBytes + 16))
+		{
+			break;
+		}
+		payload.resize(frame[0]);
+		if (fread(payload.data(), 1, payload.size(), f) != payload.size() || Checksum(kChecksumSeed, payload.data(), payload.size()) != frame[1])
+		{
+			break;
+		}
+		if (!ApplyBatch(payload.data(), payload.size(), scene, batches == 0))
+		{
+			break;
+		}
+		++batches;
+	}
+	fclose(f);
+	return batches > 0;
+}
+
+// Writer --------------------------------------------------------------------
+
+// A failed reopen after a snapshot is reported by the snapshot itself.
+static bool WriteBytes(const uint8_t* data, size_t bytes)
+{
+	return bytes == 0 || !file || fwrite(data, 1, bytes, file) == bytes;
+}
+
+static std::string TempPath()
+{
+	return journalPath + ".tmp";
+}
+
+// The snapshot goes to a temporary file that is renamed over the journal
+// once complete, so a crash at any point leaves one complete journal or the
+// other. The frame is patched in at the end.
+static void OpenTemp()
+{
+	if (tempFile)
+	{
+		fclose(tempFile);
+	}
+	tempFile = fopen(TempPath().c_str(), "wb");
+	std::vector<uint8_t> header = tempHeader;
+	header.resize(header.size() + kFrameBytes);
+	tempOk = tempFile && fwrite(header.data(), 1, header.size(), tempFile) == header.size();
+	tempPayload = 0;
+	tempSum = kChecksumSeed;
+	tempMs = 0.0;
+}
+
+static void AppendTemp(const std::vector<uint8_t>& data)
+{
+	tempOk = tempOk && fwrite(data.data(), 1, data.size(), tempFile) == data.size();
+	tempSum = Checksum(tempSum, data.data(), data.size());
+	tempPayload += data.size();
+}
+
+static bool FinishTemp(uint64_t& fileBytes)
+{
+	std::string temp = TempPath();
+	uint32_t frame[2] = { (uint32_t)tempPayload, tempSum };
+	bool ok = tempOk && tempPayload <= 5 + (uint64_t)kMaxObjects * kRectBytes && fseek(tempFile, (long)tempHeader.size(), SEEK_SET) == 0 && fwrite(frame, 1, sizeof(frame), tempFile) == sizeof(frame);
+	if (tempFile)
+	{
+		ok = fclose(tempFile) == 0 && ok;
+		tempFile = nullptr;
+	}
+	if (file)
+	{
+		fclose(file);
+		file = nullptr;
+	}
+	ok = ok && FileReplace(temp.c_str(), journalPath.c_str());
+	if (!ok)
+	{
+		remove(temp.c_str());
+	}
+	// After a failure, keep the old journal; the main thread asks for another snapshot.
+	file = fopen(journalPath.c_str(), "ab");
+	fileBytes = tempHeader.size() + kFrameBytes + tempPayload;
+	return ok && file;
+}
+
+static void WriterMain()
+{
+	ProfilerSetThreadName("Scene Journal");
+	std::unique_lock<std::mutex> lock(journalMutex);
+	for (;;)
+	{
+		journalCv.wait(lock, [] { return stopping || snapshotStart || snapshotDone || !snapshotData.empty() || !queued.empty(); });
+		if (stopping)
+		{
+			break;
+		}
+		writerBusy = true;
+		bool start = snapshotStart, done = snapshotDone;
+		size_t before = done ? queuedBeforeSnapshot : queued.size();
+		snapshotStart = false;
+		if (start)
+		{
+			tempHeader.swap(snapshotHeader);
+		}
+		writing.swap(queued);
+		queued.clear();
+		writingSnapshot.swap(snapshotData);
+		snapshotData.clear();
+		lock.unlock();
+
+		bool ok = WriteBytes(writing.data(), before);
+		bool snapshotOk = true;
+		uint64_t snapshotBytes = 0;
+		if (start || done || !writingSnapshot.empty())
+		{
+			PROFILE_SCOPE("Journal Snapshot");
+			double t0 = Now();
+			if (start)
+			{
+				OpenTemp();
+			}
+			AppendTemp(writingSnapshot);
+			if (done)
+			{
+				snapshotOk = FinishTemp(snapshotBytes);
+			}
+			tempMs += (Now() - t0) * 1000.0;
+		}
+		ok = WriteBytes(writing.data() + before, writing.size() - before) && ok;
+		ok = (!file || fflush(file) == 0) && ok;
+
+		lock.lock();
+		stats.fileBytes += writing.size();
+		if (done)
+		{
+			snapshotDone = false;
+			if (snapshotOk)
+			{
+				stats.fileBytes = snapshotBytes + writing.size() - before;
+				stats.snapshotObjects = (int)snapshotDoneObjects;
+				stats.snapshotMs = tempMs;
+				++stats.snapshots;
+			}
+			else
+			{
+				snapshotFailed = true;
+			}
+		}
+		stats.writeErrors += !ok + !snapshotOk;
+		writerBusy = false;
+		idleCv.notify_all();
+	}
+	if (tempFile)
+	{
+		fclose(tempFile);
+		tempFile = nullptr;
+		remove(TempPath().c_str());
+	}
+}
+
+// Main thread ---------------------------------------------------------------
+
+static void QueueBatch()
+{
+	if (batch.empty())
+	{
+		return;
+	}
+	uint32_t frame[2] = { (uint32_t)batch.size(), Checksum(kChecksumSeed, batch.data(), batch.size()) };
+	{
+		std::lock_guard<std::mutex> lock(journalMutex);
+		Put(queued, frame, sizeof(frame));
+		Put(queued, batch.data(), batch.size());
+	}
+	journalCv.notify_one();
+	// The old journal gets the batch now, the new one after the snapshot.
+	if (building)
+	{
+		Put(buildSince, frame, sizeof(frame));
+		Put(buildSince, batch.data(), batch.size());
+	}
+	bytesSinceSnapshot += kFrameBytes + batch.size();
+	++batchesSinceSnapshot;
+	batch.clear();
+}
+
+// Starts streaming the current scene into a fresh journal. Returns false
+// while the writer is still swapping in the previous one.
+static bool BeginSnapshot()
+{
+	{
+		std::lock_guard<std::mutex> lock(journalMutex);
+		if (snapshotDone)
+		{
+			return false;
+		}
+		snapshotStart = true;
+		snapshotHeader = EncodeHeader(source);
+		snapshotData.clear();
+	}
+	journalCv.notify_one();
+	building = true;
+	buildStale = false;
+	buildCount = (uint32_t)objects.size();
+	buildNext = 0;
+	buildSince.clear();
+	slice.clear();
+	PutU8(slice, JournalOp_Snapshot);
+	PutU32(slice, buildCount);
+	journalCount = (int)objects.size();
+	snapshotWanted = false;
+	compactRequested = false;
+	lastSnapshotTime = Now();
+	bytesSinceSnapshot = 0;
+	batchesSinceSnapshot = 0;
+	return true;
+}
+
+// Encodes the next slice. After the last one, batches queued so far go to
+// the old journal and buildSince follows the snapshot in the new one.
+static void ContinueSnapshot()
+{
+	uint32_t end = std::min(buildCount, buildNext + kSnapshotSlice);
+	for (uint32_t k = buildNext; k < end; ++k)
+	{
+		PutRect(slice, objects[k], kFieldBits);
+	}
+	buildNext = end;
+	bool last = buildNext == buildCount;
+	{
+		std::lock_guard<std::mutex> lock(journalMutex);
+		Put(snapshotData, slice.data(), slice.size());
+		if (last)
+		{
+			snapshotDone = true;
+			snapshotDoneObjects = buildCount;
+			queuedBeforeSnapshot = queued.size();
+			Put(queued, buildSince.data(), buildSince.size());
+		}
+	}
+	journalCv.notify_one();
+	slice.clear();
+	if (last)
+	{
+		building = false;
+		buildSince.clear();
+	}
+}
+
+void SceneJournalSetSource(const char* scenePath)
+{
+	source.path = scenePath ? scenePath : "";
+	source.size = 0;
+	source.hash = 0;
+	FILE* f = scenePath ? fopen(scenePath, "rb") : nullptr;
+	if (f)
+	{
+		PROFILE_FUNCTION();
+		source.hash = HashFile(f, source.size);
+		fclose(f);
+	}
+	// The header changes with the next snapshot.
+	compactRequested = journalOpen;
+}
+
+SceneJournalRecovery SceneJournalInit(const char* path, const char* scenePath)
+{
+	PROFILE_FUNCTION();
+	journalPath = path;
+	SceneJournalSetSource(scenePath);
+	std::vector<Rect> recovered;
+	bool foreign;
+	SceneJournalRecovery result = SceneJournalRecovery_None;
+	if (Recover(path, recovered, recoveredBatches, foreign))
+	{
+		objects.swap(recovered);
+		SelectionResize(selection, (int)objects.size());
+		SelectionClear(selection);
+		selectedIndex = -1;
+		MarkAllObjectsChanged(SceneChange_All);
+		recoveredObjects = (int)objects.size();
+		result = SceneJournalRecovery_Replayed;
+	}
+	else if (foreign)
+	{
+		// Someone else's unsaved edits: keep them rather than overwrite them.
+		std::string aside = journalPath + ".stale";
+		if (FileReplace(path, aside.c_str()))
+		{
+			result = SceneJournalRecovery_SetAside;
+		}
+	}
+	SceneChangesRegister(&changes);
+	// The first snapshot covers everything the new channel reports.
+	ConsumeSceneChanges(changes, [](int, uint32_t) {});
+	stopping = false;
+	writer = std::thread(WriterMain);
+	journalOpen = true;
+	BeginSnapshot();
+	ContinueSnapshot();
+	return result;
+}
+
+void SceneJournalShutdown()
+{
+	if (!journalOpen)
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(journalMutex);
+		stopping = true;
+	}
+	journalCv.notify_all();
+	writer.join();
+	if (file)
+	{
+		fclose(file);
+		file = nullptr;
+	}
+	remove(journalPath.c_str());
+	SceneChangesUnregister(&changes);
+	queued.clear();
+	batch.clear();
+	snapshotStart = false;
+	snapshotDone = false;
+	snapshotHeader.clear();
+	snapshotData.clear();
+	building = false;
+	buildSince.clear();
+	journalOpen = false;
+}
+
+void SceneJournalPump()
+{
+	if (!journalOpen)
+	{
+		return;
+	}
+	PROFILE_FUNCTION();
+	int count = (int)objects.size();
+	uint32_t all = ConsumeSceneChanges(changes, [&](int i, uint32_t what)
+	{
+		what &= kFieldBits;
+		if (snapshotWanted || i >= count || !what)
+		{
+			return;
+		}
+		PutU8(batch, JournalOp_Set);
+		PutU32(batch, (uint32_t)i);
+		PutU8(batch, what);
+		PutRect(batch, objects[i], what);
+	});
+	uint32_t unexplained = structurePending ? all & ~(uint32_t)SceneChange_Structure : all;
+	structurePending = false;
+	bool failed;
+	{
+		std::lock_guard<std::mutex> lock(journalMutex);
+		failed = snapshotFailed;
+		snapshotFailed = false;
+	}
+	if (unexplained || failed || count != journalCount)
+	{
+		snapshotWanted = true;
+	}
+	if (snapshotWanted)
+	{
+		batch.clear();
+		building = false;
+	}
+	else
+	{
+		QueueBatch();
+	}
+
+	// Bulk changes wait for play mode to end: a snapshot per simulated frame
+	// would be wasted.
+	double now = Now();
+	bool due;
+	if (snapshotWanted)
+	{
+		due = !playMode && now - lastSnapshotTime >= kMinSnapshotGap;
+	}
+	else
+	{
+		uint64_t limit = std::max(kMinCompactBytes, (uint64_t)journalCount * kRectBytes);
+		due = bytesSinceSnapshot > 0 && (now - lastSnapshotTime >= compactInterval || bytesSinceSnapshot > limit);
+	}
+	if (building ? buildStale : due || compactRequested)
+	{
+		BeginSnapshot();
+	}
+	if (building)
+	{
+		ContinueSnapshot();
+	}
+}
+
+void SceneJournalRecordInsert(const int* indices, const Rect* values, int count)
+{
+	if (!journalOpen || count <= 0)
+	{
+		return;
+	}
+	// Changes so far use the indices as they are before the insert.
+	SceneJournalPump();
+	if (!snapshotWanted)
+	{
+		PutU8(batch, JournalOp_Insert);
+		PutU32(batch, (uint32_t)count);
+		for (int k = 0; k < count; ++k)
+		{
+			PutU32(batch, (uint32_t)indices[k]);
+			PutRect(batch, values[k], kFieldBits);
+		}
+		QueueBatch();
+	}
+	journalCount += count;
+	structurePending = true;
+	// Indices in the snapshot being streamed no longer line up.
+	buildStale = building;
+}
+
+void SceneJournalRecordRemove(const int* indices, int count)
+{
+	if (!journalOpen || count <= 0)
+	{
+		return;
+	}
+	SceneJournalPump();
+	if (!snapshotWanted)
+	{
+		PutU8(batch, JournalOp_Remove);
+		PutU32(batch, (uint32_t)count);
+		for (int k = 0; k < count; ++k)
+		{
+			PutU32(batch, (uint32_t)indices[k]);
+		}
+		QueueBatch();
+	}
+	journalCount -= count;
+	structurePending = true;
+	buildStale = building;
+}
+
+void SceneJournalFlush()
+{
+	if (!journalOpen)
+	{
+		return;
+	}
+	while (building)
+	{
+		ContinueSnapshot();
+	}
+	std::unique_lock<std::mutex> lock(journalMutex);
+	idleCv.wait(lock, [] { return !writerBusy && !snapshotStart && !snapshotDone && snapshotData.empty() && queued.empty(); });
+}
+
+void SceneJournalCompact()
+{
+	compactRequested = true;
+}
+
+void SceneJournalSetCompactInterval(double seconds)
+{
+	compactInterval = seconds;
+}
+
+SceneJournalStats SceneJournalGetStats()
+{
+	SceneJournalStats s;
+	{
+		std::lock_guard<std::mutex> lock(journalMutex);
+		s = stats;
+	}
+	s.bytesSinceSnapshot = bytesSinceSnapshot;
+	s.batchesSinceSnapshot = batchesSinceSnapshot;
+	s.recoveredObjects = recoveredObjects;
+	s.recoveredBatches = recoveredBatches;
+	return s;
+}
+
+void DrawSceneJournalUI()
+{
+	if (!ImGui::CollapsingHeader("Scene Journal"))
+	{
+		return;
+	}
+	if (!journalOpen)
+	{
+		ImGui::TextDisabled("Off");
+		return;
+	}
+	SceneJournalStats s = SceneJournalGetStats();
+	ImGui::Text("%s: %.1f KB", journalPath.c_str(), s.fileBytes / 1024.0);
+	ImGui::Text("Since snapshot: %d batches, %.1f KB", s.batchesSinceSnapshot, s.bytesSinceSnapshot / 1024.0);
+	ImGui::Text("Snapshots: %d, last %d objects in %.1f ms", s.snapshots, s.snapshotObjects, s.snapshotMs);
+	if (building)
+	{
+		ImGui::ProgressBar(buildCount ? (float)buildNext / (float)buildCount : 1.0f, ImVec2(-1.0f, 0.0f), "Snapshotting");
+	}
+	if (s.recoveredObjects >= 0)
+	{
+		ImGui::Text("Recovered %d objects from %d batches", s.recoveredObjects, s.recoveredBatches);
+	}
+	if (s.writeErrors > 0)
+	{
+		ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%d write errors", s.writeErrors);
+	}
+	float interval = (float)compactInterval;
+	if (ImGui::SliderFloat("Compact every", &interval, 5.0f, 600.0f, "%.0f s"))
+	{
+		compactInterval = interval;
+	}
+	if (ImGui::Button("Compact Now"))
+	{
+		SceneJournalCompact();
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+#include "scene.h"
+
+// Crash safety for edits. Every frame the changes reported through
+// scene_changes.h are appended to a journal file as compact binary records:
+// an object index, the SceneChange bits and only the fields they name.
+// Inserts and removes are recorded explicitly. A background thread does all
+// the file work. The journal starts with a full snapshot of the scene and
+// is compacted into a fresh one when it grows past the snapshot's size,
+// after the compaction interval, or after a bulk change (simulation,
+// loading) that per-object records cannot describe. Snapshots are encoded a
+// slice of objects per frame and streamed to a temporary file, so even a huge
+// scene is never copied in one go; until the new journal is swapped in, edits
+// keep going to the old one. A clean shutdown deletes the journal; one that
+// is still there at startup is replayed if it was written for the scene
+// being opened (same path, size and content hash).
+//
+// Batches are framed with a length and a checksum, so a tail torn by a crash
+// is dropped and everything before it is kept.
+
+enum SceneJournalRecovery {
+	SceneJournalRecovery_None,
+	SceneJournalRecovery_Replayed,  // objects now hold the journal's scene
+	SceneJournalRecovery_SetAside   // written for another scene; renamed to <path>.stale
+};
+
+// Replays a journal left at path, replacing objects, then starts a new one
+// from the current scene. scenePath is the file objects were loaded from, or
+// nullptr for the built-in scene.
+SceneJournalRecovery SceneJournalInit(const char* path, const char* scenePath);
+// The scene now matches this file, after a load or a save. Written into the
+// journal with the next snapshot.
+void SceneJournalSetSource(const char* scenePath);
+// Stops the writer and deletes the journal.
+void SceneJournalShutdown();
+
+// Once per frame, after the UI has edited objects.
+void SceneJournalPump();
+
+// Inserts and removes shift the indices of later objects, so they are
+// recorded explicitly. Call before changing objects, then report the change
+// with MarkAllObjectsChanged(SceneChange_Structure). Indices are ascending;
+// insert indices are positions after the insert.
+void SceneJournalRecordInsert(const int* indices, const Rect* values, int count);
+void SceneJournalRecordRemove(const int* indices, int count);
+
+// Blocks until everything pumped so far is on disk. A snapshot still being
+// streamed is finished first.
+void SceneJournalFlush();
+
+// Snapshots the scene into a fresh journal on the next pump.
+void SceneJournalCompact();
+void SceneJournalSetCompactInterval(double seconds);
+
+struct SceneJournalStats {
+	uint64_t fileBytes;          // on disk, snapshot included
+	uint64_t bytesSinceSnapshot;
+	int batchesSinceSnapshot;
+	int snapshots;
+	int snapshotObjects;
+	double snapshotMs;           // last snapshot, on the writer thread
+	int writeErrors;
+	int recoveredObjects;        // -1 when nothing was recovered
+	int recoveredBatches;
+};
+
+SceneJournalStats SceneJournalGetStats();
+void DrawSceneJournalUI();
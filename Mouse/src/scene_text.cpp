@@ -0,0 +1,490 @@
+#include "scene_text.h"
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MOUSE_SCENE_TEXT_SSE2 1
+#include <emmintrin.h>
+#else
+#define MOUSE_SCENE_TEXT_SSE2 0
+#endif
+
+#include "file_util.h"
+#include "hit_test.h"
+#include "profiler.h"
+#include "scene_changes.h"
+#include "undo_history.h"
+
+static const char kHeader[] = "mouse-scene";
+static const size_t kReadChunk = 1 << 20;
+static const size_t kWriteBuffer = 256 * 1024;
+static const size_t kMaxLine = 256; // nine fields of at most 16 characters
+static const int kFields = 9;       // x y w h r g b a sprite
+
+// Powers of ten that are exact in a double.
+static const double kPow10[23] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static char lineError[128];
+
+static bool FailAt(const char** error, int line, const char* message)
+{
+	snprintf(lineError, sizeof(lineError), "line %d: %s", line, message);
+	*error = lineError;
+	return false;
+}
+
+static bool IsDigit(char c)
+{
+	return (unsigned)(c - '0') < 10;
+}
+
+static bool IsSeparator(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Numbers -------------------------------------------------------------------
+
+static const char* ParseFloatSlow(const char* p, float& out)
+{
+	char* end;
+	out = strtof(p, &end);
+	return end == p ? nullptr : end;
+}
+
+// A double exactly halfway between two floats: rounding it to float would
+// round a second time.
+static bool IsFloatMidpoint(double d)
+{
+	uint64_t bits;
+	memcpy(&bits, &d, sizeof(bits));
+	return (bits & ((1ull << 29) - 1)) == (1ull << 28);
+}
+
+// The digits are gathered into an integer; up to 19 of them cannot
+// overflow it. When it fits 53 bits and the power of ten is exact, one
+// multiply or divide gives the correctly rounded double, and rounding that
+// to float is correct unless it lands on a midpoint. Everything else, nan
+// and inf included, goes to strtof. Returns the end of the number, or null
+// when there is none.
+static const char* ParseFloat(const char* p, float& out)
+{
+	const char* start = p;
+	bool negative = *p == '-';
+	if (*p == '-' || *p == '+')
+	{
+		++p;
+	}
+	uint64_t m = 0;
+	const char* digits = p;
+	for (; IsDigit(*p); ++p)
+	{
+		m = m * 10 + (*p - '0');
+	}
+	ptrdiff_t count = p - digits;
+	int exp10 = 0;
+	if (*p == '.')
+	{
+		const char* fraction = ++p;
+		for (; IsDigit(*p); ++p)
+		{
+			m = m * 10 + (*p - '0');
+		}
+		exp10 = (int)-(p - fraction);
+		count += p - fraction;
+	}
+	if (count == 0)
+	{
+		return ParseFloatSlow(start, out);
+	}
+	if (*p == 'e' || *p == 'E')
+	{
+		const char* e = p + 1;
+		bool negativeExp = *e == '-';
+		if (*e == '-' || *e == '+')
+		{
+			++e;
+		}
+		if (IsDigit(*e))
+		{
+			int v = 0;
+			for (; IsDigit(*e); ++e)
+			{
+				v = v < 10000 ? v * 10 + (*e - '0') : v;
+			}
+			exp10 += negativeExp ? -v : v;
+			p = e;
+		}
+	}
+	if (count <= 19 && m <= (1ull << 53) && exp10 >= -22 && exp10 <= 22)
+	{
+		double d = exp10 < 0 ? (double)m / kPow10[-exp10] : (double)m * kPow10[exp10];
+		if (d == 0.0 || (d >= FLT_MIN && d <= FLT_MAX && !IsFloatMidpoint(d)))
+		{
+			out = (float)(negative ? -d : d);
+			return p;
+		}
+	}
+	return ParseFloatSlow(start, out);
+}
+
+static const char* ParseInt(const char* p, int& out)
+{
+	bool negative = *p == '-';
+	if (*p == '-' || *p == '+')
+	{
+		++p;
+	}
+	if (!IsDigit(*p))
+	{
+		return nullptr;
+	}
+	int64_t v = 0;
+	for (; IsDigit(*p); ++p)
+	{
+		v = v * 10 + (*p - '0');
+		if (v > INT_MAX)
+		{
+			return nullptr;
+		}
+	}
+	out = (int)(negative ? -v : v);
+	return p;
+}
+
+static char* WriteUnsigned(char* p, uint64_t v, int minDigits)
+{
+	char digits[24];
+	int n = 0;
+	do
+	{
+		digits[n++] = (char)('0' + v % 10);
+		v /= 10;
+	} while (v || n < minDigits);
+	while (n)
+	{
+		*p++ = digits[--n];
+	}
+	return p;
+}
+
+// The fewest decimals that read back to exactly v. Candidates are checked
+// in arithmetic first and only the winner is formatted and parsed back.
+// Values too large or too small for that fall back to %.9g, which always
+// reads back.
+static char* WriteFloat(char* p, float v)
+{
+	if (v == v && fabsf(v) < 1e9f)
+	{
+		char* q = p;
+		if (std::signbit(v))
+		{
+			*q++ = '-';
+		}
+		float target = fabsf(v);
+		double a = target;
+		for (int decimals = 0; decimals <= 15 && a * kPow10[decimals] < 9e15; ++decimals)
+		{
+			double rounded = floor(a * kPow10[decimals] + 0.5);
+			if ((float)(rounded / kPow10[decimals]) != target)
+			{
+				continue;
+			}
+			uint64_t scaled = (uint64_t)rounded;
+			char* end = WriteUnsigned(q, scaled / (uint64_t)kPow10[decimals], 1);
+			if (decimals > 0)
+			{
+				*end++ = '.';
+				end = WriteUnsigned(end, scaled % (uint64_t)kPow10[decimals], decimals);
+			}
+			*end = ' ';
+			float back;
+			if (ParseFloat(p, back) == end && memcmp(&back, &v, sizeof(v)) == 0)
+			{
+				return end;
+			}
+		}
+	}
+	return p + snprintf(p, 32, "%.9g", v);
+}
+
+// Structural scan -----------------------------------------------------------
+
+struct BlockMasks {
+	uint64_t separators; // space, tab, CR and LF
+	uint64_t newlines;
+};
+
+// Classifies 64 bytes; bit i stands for p[i].
+static BlockMasks ScanBlock(const char* p)
+{
+	BlockMasks m = { 0, 0 };
+#if MOUSE_SCENE_TEXT_SSE2
+	const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t'), cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+	for (int k = 0; k < 4; ++k)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(p + 16 * k));
+		__m128i nl = _mm_cmpeq_epi8(v, lf);
+		__m128i sep = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)), _mm_or_si128(_mm_cmpeq_epi8(v, cr), nl));
+		m.separators |= (uint64_t)(uint32_t)_mm_movemask_epi8(sep) << (16 * k);
+		m.newlines |= (uint64_t)(uint32_t)_mm_movemask_epi8(nl) << (16 * k);
+	}
+#else
+	for (int i = 0; i < 64; ++i)
+	{
+		m.separators |= (uint64_t)IsSeparator(p[i]) << i;
+		m.newlines |= (uint64_t)(p[i] == '\n') << i;
+	}
+#endif
+	return m;
+}
+
+struct LineParser {
+	std::vector<Rect>* out;
+	const char** error;
+	float values[kFields - 1];
+	int sprite;
+	int fields;    // parsed on the current line
+	int line;      // 1-based
+	bool skipLine; // comment or header
+	bool header;   // header line seen
+};
+
+static bool ParseField(LineParser& lp, const char* p)
+{
+	if (lp.fields == 0 && *p == '#')
+	{
+		lp.skipLine = true;
+		return true;
+	}
+	if (!lp.header)
+	{
+		int version = 0;
+		const char* v = p + sizeof(kHeader) - 1;
+		if (strncmp(p, kHeader, sizeof(kHeader) - 1) != 0 || (*v != ' ' && *v != '\t'))
+		{
+			return FailAt(lp.error, lp.line, "not a text scene file");
+		}
+		while (*v == ' ' || *v == '\t')
+		{
+			++v;
+		}
+		if (!ParseInt(v, version) || version != kSceneTextVersion)
+		{
+			return FailAt(lp.error, lp.line, "unsupported text scene version");
+		}
+		lp.header = true;
+		lp.skipLine = true;
+		return true;
+	}
+	if (lp.fields == kFields)
+	{
+		return FailAt(lp.error, lp.line, "too many fields");
+	}
+	const char* end = lp.fields < kFields - 1 ? ParseFloat(p, lp.values[lp.fields]) : ParseInt(p, lp.sprite);
+	if (!end || !IsSeparator(*end))
+	{
+		return FailAt(lp.error, lp.line, "bad number");
+	}
+	++lp.fields;
+	return true;
+}
+
+static bool EndLine(LineParser& lp)
+{
+	if (!lp.skipLine && lp.fields > 0)
+	{
+		if (lp.fields < kFields - 1)
+		{
+			return FailAt(lp.error, lp.line, "expected x y w h r g b a [sprite]");
+		}
+		const float* v = lp.values;
+		lp.out->push_back({ v[0], v[1], v[2], v[3], ImVec4(v[4], v[5], v[6], v[7]), lp.fields == kFields ? lp.sprite : -1 });
+	}
+	lp.fields = 0;
+	lp.skipLine = false;
+	++lp.line;
+	return true;
+}
+
+// Parses whole lines in [begin, end); end follows a newline. The blocks may
+// read up to 63 bytes past end, which the caller keeps addressable. A field
+// starts at every non-separator byte that follows a separator, so the field
+// parsers are only ever called at field starts and never skip whitespace.
+static bool ParseLines(LineParser& lp, const char* begin, const char* end)
+{
+	uint64_t carry = 1; // begin starts a line
+	for (const char* block = begin; block < end; block += 64)
+	{
+		BlockMasks m = ScanBlock(block);
+		size_t valid = (size_t)(end - block);
+		uint64_t keep = valid >= 64 ? ~0ull : (1ull << valid) - 1;
+		uint64_t starts = ~m.separators & ((m.separators << 1) | carry);
+		carry = m.separators >> 63;
+		uint64_t events = (starts | m.newlines) & keep;
+		while (events)
+		{
+			const char* p = block + HitLowestBit(events);
+			events &= events - 1;
+			if (*p == '\n')
+			{
+				if (!EndLine(lp))
+				{
+					return false;
+				}
+			}
+			else if (!lp.skipLine && !ParseField(lp, p))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Files ---------------------------------------------------------------------
+
+bool SceneTextMatchesPath(const char* path)
+{
+	size_t n = strlen(path);
+	return n >= 5 && strcmp(path + n - 5, ".mtxt") == 0;
+}
+
+bool SceneTextSave(const char* path, const std::vector<Rect>& objects, const char** error)
+{
+	PROFILE_FUNCTION();
+	char temp[1024];
+	snprintf(temp, sizeof(temp), "%s.tmp", path);
+	FILE* f = fopen(temp, "wb");
+	if (!f)
+	{
+		return Fail(error, "cannot create the file");
+	}
+	// Lines are built in our own buffer, so stdio does not need one.
+	setvbuf(f, nullptr, _IONBF, 0);
+	std::vector<char> buffer(kWriteBuffer);
+	char* buf = buffer.data();
+	size_t used = (size_t)snprintf(buf, kWriteBuffer, "%s %d\n# x y w h r g b a [sprite]\n", kHeader, kSceneTextVersion);
+	bool ok = true;
+	for (size_t i = 0; i <= objects.size(); ++i)
+	{
+		if (used + kMaxLine > kWriteBuffer || i == objects.size())
+		{
+			ok = ok && fwrite(buf, 1, used, f) == used;
+			used = 0;
+		}
+		if (i == objects.size())
+		{
+			break;
+		}
+		const Rect& R = objects[i];
+		const float fields[kFields - 1] = { R.x, R.y, R.w, R.h, R.color.x, R.color.y, R.color.z, R.color.w };
+		char* p = buf + used;
+		for (int k = 0; k < kFields - 1; ++k)
+		{
+			p = WriteFloat(p, fields[k]);
+			*p++ = ' ';
+		}
+		if (R.sprite >= 0)
+		{
+			p = WriteUnsigned(p, (uint64_t)R.sprite, 1);
+		}
+		else
+		{
+			--p;
+		}
+		*p++ = '\n';
+		used = (size_t)(p - buf);
+	}
+	ok = fclose(f) == 0 && ok;
+	if (!ok || !FileReplace(temp, path))
+	{
+		remove(temp);
+		return Fail(error, ok ? "cannot replace the file" : "write failed");
+	}
+	return true;
+}
+
+bool SceneTextRead(const char* path, std::vector<Rect>& out, const char** error)
+{
+	PROFILE_FUNCTION();
+	out.clear();
+	FILE* f = fopen(path, "rb");
+	if (!f)
+	{
+		return Fail(error, "cannot open the file");
+	}
+	// One byte for a missing final newline, and a block of slack behind it.
+	std::vector<char> buffer(kReadChunk + 1 + 64);
+	char* buf = buffer.data();
+	LineParser lp = {};
+	lp.out = &out;
+	lp.error = error;
+	lp.line = 1;
+	size_t have = 0;
+	bool ok = true, eof = false;
+	while (ok && !eof)
+	{
+		have += fread(buf + have, 1, kReadChunk - have, f);
+		eof = have < kReadChunk;
+		if (eof && ferror(f))
+		{
+			ok = Fail(error, "read failed");
+			break;
+		}
+		if (eof && have > 0 && buf[have - 1] != '\n')
+		{
+			buf[have++] = '\n';
+		}
+		size_t used = have;
+		while (used > 0 && buf[used - 1] != '\n')
+		{
+			--used;
+		}
+		if (used == 0 && have > 0)
+		{
+			ok = FailAt(error, lp.line, "line too long");
+			break;
+		}
+		ok = ParseLines(lp, buf, buf + used);
+		memmove(buf, buf + used, have - used);
+		have -= used;
+	}
+	fclose(f);
+	if (ok && !lp.header)
+	{
+		ok = Fail(error, "not a text scene file");
+	}
+	if (!ok)
+	{
+		out.clear();
+	}
+	return ok;
+}
+
+bool SceneTextLoad(const char* path, const char** error)
+{
+	PROFILE_FUNCTION();
+	std::vector<Rect> loaded;
+	if (!SceneTextRead(path, loaded, error))
+	{
+		return false;
+	}
+	objects.swap(loaded);
+	SelectionResize(selection, (int)objects.size());
+	SelectionClear(selection);
+	selectedIndex = -1;
+	UndoClear();
+	MarkAllObjectsChanged(SceneChange_All);
+	return true;
+}
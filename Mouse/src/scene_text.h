@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+#include "scene.h"
+
+// Text scene files (.mtxt), for scenes that live in version control. One
+// object per line, so an edit shows up as a one-line diff:
+//
+//   mouse-scene 1
+//   # x y w h r g b a [sprite]
+//   50 60 80 80 1 0 0 1
+//   550 120 64 64 1 0.8 0.3 1 0
+//
+// Numbers are written with the fewest digits that read back to the same
+// float. Blank lines and lines starting with # are ignored; the sprite
+// column may be left out when there is none.
+//
+// Both directions stream through a fixed buffer, so neither needs the whole
+// file in memory. The reader finds line and field boundaries 64 bytes at a
+// time with SSE2 and parses numbers itself. Values it cannot round exactly go
+// through strtof instead: more than 19 digits or a mantissa above 2^53, an
+// exponent outside +-22, subnormals and values past the float range, results
+// halfway between two floats, and nan or inf.
+
+static const int kSceneTextVersion = 1;
+
+// True for paths with the .mtxt extension.
+bool SceneTextMatchesPath(const char* path);
+
+// Same contract as SceneFileSave: a temporary file renamed over path.
+bool SceneTextSave(const char* path, const std::vector<Rect>& objects, const char** error);
+
+// Parses the file into out. On failure out is left empty and error points
+// at a message naming the line; the message stays valid until the next call.
+bool SceneTextRead(const char* path, std::vector<Rect>& out, const char** error);
+
+// Replaces the scene with the file's objects and clears the selection. A
+// file that fails to parse leaves the scene untouched.
+bool SceneTextLoad(const char* path, const char** error);
@@ -0,0 +1,93 @@
+#include "selection.h"
+
+// Clears bits at or past objectCount in the last word so counts stay exact.
+static void TrimTail(SelectionSet& sel)
+{
+	int tail = sel.objectCount & 63;
+	if (tail && !sel.words.empty())
+	{
+		sel.words.back() &= (1ull << tail) - 1;
+	}
+}
+
+void SelectionResize(SelectionSet& sel, int objectCount)
+{
+	if (objectCount == sel.objectCount)
+	{
+		return;
+	}
+	sel.words.resize(HitMaskWords(objectCount), 0);
+	sel.objectCount = objectCount;
+	TrimTail(sel);
+	sel.count = HitMaskPopCount(sel.words.data(), objectCount);
+}
+
+void SelectionClear(SelectionSet& sel)
+{
+	for (uint64_t& w : sel.words)
+	{
+		w = 0;
+	}
+	sel.count = 0;
+}
+
+void SelectionAdd(SelectionSet& sel, int index)
+{
+	if (index >= 0 && index < sel.objectCount && !SelectionContains(sel, index))
+	{
+		sel.words[index >> 6] |= 1ull << (index & 63);
+		++sel.count;
+	}
+}
+
+void SelectionRemove(SelectionSet& sel, int index)
+{
+	if (SelectionContains(sel, index))
+	{
+		sel.words[index >> 6] &= ~(1ull << (index & 63));
+		--sel.count;
+	}
+}
+
+void SelectionToggle(SelectionSet& sel, int index)
+{
+	if (SelectionContains(sel, index))
+	{
+		SelectionRemove(sel, index);
+	}
+	else
+	{
+		SelectionAdd(sel, index);
+	}
+}
+
+void SelectionCombine(SelectionSet& sel, const SelectionSet& base, const uint64_t* mask, SelectionOp op)
+{
+	SelectionResize(sel, base.objectCount);
+	int words = (int)base.words.size();
+	for (int w = 0; w < words; ++w)
+	{
+		uint64_t b = base.words[w], m = mask[w];
+		switch (op)
+		{
+		case SelectionOp_Add:      sel.words[w] = b | m; break;
+		case SelectionOp_Subtract: sel.words[w] = b & ~m; break;
+		case SelectionOp_Toggle:   sel.words[w] = b ^ m; break;
+		default:                   sel.words[w] = m; break;
+		}
+	}
+	TrimTail(sel);
+	sel.count = HitMaskPopCount(sel.words.data(), sel.objectCount);
+}
+
+int SelectionFirst(const SelectionSet& sel)
+{
+	for (int w = 0; w < (int)sel.words.size(); ++w)
+	{
+		if (sel.words[w])
+		{
+			return w * 64 + HitLowestBit(sel.words[w]);
+		}
+	}
+	return -1;
+}
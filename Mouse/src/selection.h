@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "hit_test.h"
+
+// Object selection as one bit per object, in the same layout as hit-test masks.
+
+enum SelectionOp {
+	SelectionOp_Replace,
+	SelectionOp_Add,
+	SelectionOp_Subtract,
+	SelectionOp_Toggle
+};
+
+struct SelectionSet {
+	std::vector<uint64_t> words;
+	int objectCount = 0;
+	int count = 0;
+};
+
+// Keeps existing bits when growing; bits past a shrunk count are dropped.
+void SelectionResize(SelectionSet& sel, int objectCount);
+void SelectionClear(SelectionSet& sel);
+void SelectionAdd(SelectionSet& sel, int index);
+void SelectionRemove(SelectionSet& sel, int index);
+void SelectionToggle(SelectionSet& sel, int index);
+
+// sel = base <op> mask, where mask is a hit-test mask over the same object count.
+void SelectionCombine(SelectionSet& sel, const SelectionSet& base, const uint64_t* mask, SelectionOp op);
+
+// Lowest selected index, or -1.
+int SelectionFirst(const SelectionSet& sel);
+
+inline bool SelectionContains(const SelectionSet& sel, int index)
+{
+	return index >= 0 && index < sel.objectCount && ((sel.words[index >> 6] >> (index & 63)) & 1);
+}
+
+// Calls fn(index) for every selected object in ascending order.
+template <typename Fn>
+void SelectionForEach(const SelectionSet& sel, Fn fn)
+{
+	for (int w = 0; w < (int)sel.words.size(); ++w)
+	{
+		for (uint64_t bits = sel.words[w]; bits; bits &= bits - 1)
+		{
+			fn(w * 64 + HitLowestBit(bits));
+		}
+	}
+}
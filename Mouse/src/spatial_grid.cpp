@@ -0,0 +1,133 @@
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Clamps before truncating, so no floor() call is needed on either side.
+static int CellCoord(float v, float origin, float invCell, int cells)
+{
+	float t = (v - origin) * invCell;
+	if (!(t > 0.0f))
+	{
+		return 0;
+	}
+	return t >= (float)cells ? cells - 1 : (int)t;
+}
+
+// Objects with NaN bounds (or none at all) are left out of the grid.
+static bool ValidBounds(const HitColumns& b, int i)
+{
+	return b.minX[i] <= b.maxX[i] && b.minY[i] <= b.maxY[i];
+}
+
+void SpatialGridBuild(SpatialGrid& grid, const HitColumns& bounds, float cellSize, int maxCells)
+{
+	int n = bounds.count;
+	float x0 = 0.0f, y0 = 0.0f, x1 = 0.0f, y1 = 0.0f;
+	bool any = false;
+	for (int i = 0; i < n; ++i)
+	{
+		if (!ValidBounds(bounds, i))
+		{
+			continue;
+		}
+		if (!any)
+		{
+			x0 = bounds.minX[i]; y0 = bounds.minY[i]; x1 = bounds.maxX[i]; y1 = bounds.maxY[i];
+			any = true;
+			continue;
+		}
+		x0 = std::min(x0, bounds.minX[i]);
+		y0 = std::min(y0, bounds.minY[i]);
+		x1 = std::max(x1, bounds.maxX[i]);
+		y1 = std::max(y1, bounds.maxY[i]);
+	}
+
+	float w = std::max(x1 - x0, 1.0f), h = std::max(y1 - y0, 1.0f);
+	cellSize = std::max(cellSize, 1.0f);
+	if ((w / cellSize + 1.0f) * (h / cellSize + 1.0f) > (float)maxCells)
+	{
+		cellSize = std::sqrt(w * h / (float)maxCells) + 1.0f;
+	}
+	grid.originX = x0;
+	grid.originY = y0;
+	grid.cellSize = cellSize;
+	grid.cols = std::max(1, (int)(w / cellSize) + 1);
+	grid.rows = std::max(1, (int)(h / cellSize) + 1);
+	grid.objectCount = n;
+
+	// Count, prefix sum, then fill: the classic two-pass bucket layout.
+	int cells = grid.cols * grid.rows;
+	float inv = 1.0f / cellSize;
+	grid.cellStart.assign(cells + 1, 0);
+	for (int i = 0; i < n; ++i)
+	{
+		if (!ValidBounds(bounds, i))
+		{
+			continue;
+		}
+		int cx0 = CellCoord(bounds.minX[i], x0, inv, grid.cols), cx1 = CellCoord(bounds.maxX[i], x0, inv, grid.cols);
+		int cy0 = CellCoord(bounds.minY[i], y0, inv, grid.rows), cy1 = CellCoord(bounds.maxY[i], y0, inv, grid.rows);
+		for (int cy = cy0; cy <= cy1; ++cy)
+		{
+			for (int cx = cx0; cx <= cx1; ++cx)
+			{
+				++grid.cellStart[cy * grid.cols + cx + 1];
+			}
+		}
+	}
+	for (int c = 0; c < cells; ++c)
+	{
+		grid.cellStart[c + 1] += grid.cellStart[c];
+	}
+	grid.items.resize(grid.cellStart[cells]);
+	std::vector<int> cursor(grid.cellStart.begin(), grid.cellStart.end() - 1);
+	for (int i = 0; i < n; ++i)
+	{
+		if (!ValidBounds(bounds, i))
+		{
+			continue;
+		}
+		int cx0 = CellCoord(bounds.minX[i], x0, inv, grid.cols), cx1 = CellCoord(bounds.maxX[i], x0, inv, grid.cols);
+		int cy0 = CellCoord(bounds.minY[i], y0, inv, grid.rows), cy1 = CellCoord(bounds.maxY[i], y0, inv, grid.rows);
+		for (int cy = cy0; cy <= cy1; ++cy)
+		{
+			for (int cx = cx0; cx <= cx1; ++cx)
+			{
+				grid.items[cursor[cy * grid.cols + cx]++] = i;
+			}
+		}
+	}
+}
+
+void SpatialGridQueryRect(const SpatialGrid& grid, const HitColumns& bounds, float x0, float y0, float x1, float y1, HitRectMode mode, uint64_t* mask)
+{
+	if (grid.cols == 0 || x1 < x0 || y1 < y0)
+	{
+		return;
+	}
+	float inv = 1.0f / grid.cellSize;
+	int cx0 = CellCoord(x0, grid.originX, inv, grid.cols), cx1 = CellCoord(x1, grid.originX, inv, grid.cols);
+	int cy0 = CellCoord(y0, grid.originY, inv, grid.rows), cy1 = CellCoord(y1, grid.originY, inv, grid.rows);
+	bool contain = mode == HitRectMode_Contain;
+	for (int cy = cy0; cy <= cy1; ++cy)
+	{
+		float cellY0 = grid.originY + cy * grid.cellSize;
+		bool insideY = cy > 0 && cy < grid.rows - 1 && cellY0 >= y0 && cellY0 + grid.cellSize <= y1;
+		for (int cx = cx0; cx <= cx1; ++cx)
+		{
+			float cellX0 = grid.originX + cx * grid.cellSize;
+			bool inside = insideY && cx > 0 && cx < grid.cols - 1 && cellX0 >= x0 && cellX0 + grid.cellSize <= x1;
+			const int* it = grid.items.data() + grid.cellStart[cy * grid.cols + cx];
+			const int* end = grid.items.data() + grid.cellStart[cy * grid.cols + cx + 1];
+			for (; it != end; ++it)
+			{
+				int i = *it;
+				bool hit = contain
+					? x0 <= bounds.minX[i] && bounds.maxX[i] <= x1 && y0 <= bounds.minY[i] && bounds.maxY[i] <= y1
+					: inside || (bounds.minX[i] <= x1 && x0 <= bounds.maxX[i] && bounds.minY[i] <= y1 && y0 <= bounds.maxY[i]);
+				mask[i >> 6] |= (uint64_t)hit << (i & 63);
+			}
+		}
+	}
+}
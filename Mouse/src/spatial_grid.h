@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+#include "hit_test.h"
+
+// Uniform grid over object bounds for region queries. Each object is listed
+// in every cell its bounds touch; cells are stored contiguously (cellStart
+// offsets into items), so a rebuild is three linear passes and no per-cell
+// allocations.
+
+struct SpatialGrid {
+	float originX = 0.0f;
+	float originY = 0.0f;
+	float cellSize = 64.0f;
+	int cols = 0;
+	int rows = 0;
+	int objectCount = 0;
+	std::vector<int> cellStart; // cols * rows + 1 entries
+	std::vector<int> items;
+};
+
+// cellSize grows as needed to keep the grid within maxCells cells.
+void SpatialGridBuild(SpatialGrid& grid, const HitColumns& bounds, float cellSize, int maxCells = 65536);
+
+// ORs hits into mask (HitMaskWords(bounds.count) words, cleared by the caller).
+// Objects in cells that lie entirely inside the query are taken without a test in overlap mode.
+void SpatialGridQueryRect(const SpatialGrid& grid, const HitColumns& bounds, float x0, float y0, float x1, float y1, HitRectMode mode, uint64_t* mask);
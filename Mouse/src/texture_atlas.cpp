@@ -0,0 +1,219 @@
+#include "texture_atlas.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "imgui_internal.h"
+
+// imgui_draw.cpp compiles its copy of stb_rectpack as static functions, so
+// the atlas carries its own.
+#define STBRP_STATIC
+#define STBRP_ASSERT(x) do { IM_ASSERT(x); } while (0)
+#define STBRP_SORT ImQsort
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+// Images are packed with a one texel border copied from their edges, so
+// bilinear filtering at the edge of a sprite never reads its neighbour.
+static const int kPadding = 1;
+
+struct AtlasPage {
+	ImTextureData* tex;
+	stbrp_context packer;     // holds pointers into itself; pages never move
+	stbrp_node nodes[kAtlasPageSize];
+	ImVec2 whiteUV;
+	int images;
+	int usedPixels;
+};
+
+static std::vector<AtlasPage*> pages;
+static std::vector<AtlasImage> images;
+
+// Mirrors ImFontAtlasTextureBlockQueueUpload. User textures are not reset by
+// ImGui once uploaded, so stale requests are dropped here first.
+static void QueueUpload(ImTextureData* tex, int x, int y, int w, int h)
+{
+	if (tex->Status == ImTextureStatus_OK && !tex->Updates.empty())
+	{
+		tex->Updates.clear();
+		tex->UpdateRect.x = tex->UpdateRect.y = (unsigned short)~0;
+		tex->UpdateRect.w = tex->UpdateRect.h = 0;
+	}
+	ImTextureRect r = { (unsigned short)x, (unsigned short)y, (unsigned short)w, (unsigned short)h };
+	int x1 = std::max(tex->UpdateRect.w == 0 ? 0 : tex->UpdateRect.x + tex->UpdateRect.w, x + w);
+	int y1 = std::max(tex->UpdateRect.h == 0 ? 0 : tex->UpdateRect.y + tex->UpdateRect.h, y + h);
+	tex->UpdateRect.x = std::min(tex->UpdateRect.x, r.x);
+	tex->UpdateRect.y = std::min(tex->UpdateRect.y, r.y);
+	tex->UpdateRect.w = (unsigned short)(x1 - tex->UpdateRect.x);
+	tex->UpdateRect.h = (unsigned short)(y1 - tex->UpdateRect.y);
+	int usedX1 = std::max(tex->UsedRect.x + tex->UsedRect.w, x + w);
+	int usedY1 = std::max(tex->UsedRect.y + tex->UsedRect.h, y + h);
+	tex->UsedRect.x = std::min(tex->UsedRect.x, r.x);
+	tex->UsedRect.y = std::min(tex->UsedRect.y, r.y);
+	tex->UsedRect.w = (unsigned short)(usedX1 - tex->UsedRect.x);
+	tex->UsedRect.h = (unsigned short)(usedY1 - tex->UsedRect.y);
+	// A page still waiting to be created uploads all of its pixels anyway.
+	if (tex->Status == ImTextureStatus_OK || tex->Status == ImTextureStatus_WantUpdates)
+	{
+		tex->Status = ImTextureStatus_WantUpdates;
+		tex->Updates.push_back(r);
+	}
+}
+
+static bool Pack(AtlasPage& page, int w, int h, int* x, int* y)
+{
+	stbrp_rect r = {};
+	r.w = w;
+	r.h = h;
+	stbrp_pack_rects(&page.packer, &r, 1);
+	if (!r.was_packed)
+	{
+		return false;
+	}
+	*x = r.x;
+	*y = r.y;
+	page.usedPixels += w * h;
+	return true;
+}
+
+static AtlasPage* NewPage()
+{
+	AtlasPage* page = IM_NEW(AtlasPage)();
+	page->tex = IM_NEW(ImTextureData)();
+	page->tex->Create(ImTextureFormat_RGBA32, kAtlasPageSize, kAtlasPageSize);
+	page->tex->UseColors = true;
+	page->tex->RefCount = 1;
+	page->tex->Status = ImTextureStatus_WantCreate;
+	ImGui::RegisterUserTexture(page->tex);
+	stbrp_init_target(&page->packer, kAtlasPageSize, kAtlasPageSize, page->nodes, kAtlasPageSize);
+	// Images arrive one at a time, so the sort never helps; best fit wastes less than bottom-left.
+	stbrp_setup_heuristic(&page->packer, STBRP_HEURISTIC_Skyline_BF_sortHeight);
+	page->images = 0;
+	page->usedPixels = 0;
+
+	// A 2x2 white block; its center samples pure white under bilinear filtering.
+	int x = 0, y = 0;
+	Pack(*page, 2, 2, &x, &y);
+	for (int row = 0; row < 2; ++row)
+	{
+		memset(page->tex->GetPixelsAt(x, y + row), 0xFF, 2 * 4);
+	}
+	page->whiteUV = ImVec2((x + 1.0f) / kAtlasPageSize, (y + 1.0f) / kAtlasPageSize);
+	QueueUpload(page->tex, x, y, 2, 2);
+	pages.push_back(page);
+	return page;
+}
+
+// Copies the image inside its padding and extends the edge texels outwards.
+static void Blit(ImTextureData* tex, int x, int y, const ImU32* rgba, int w, int h)
+{
+	const int pitch = tex->Width;
+	ImU32* base = (ImU32*)tex->GetPixelsAt(x + kPadding, y + kPadding);
+	for (int row = 0; row < h; ++row)
+	{
+		ImU32* dst = base + row * pitch;
+		memcpy(dst, rgba + row * w, w * sizeof(ImU32));
+		for (int p = 1; p <= kPadding; ++p)
+		{
+			dst[-p] = dst[0];
+			dst[w - 1 + p] = dst[w - 1];
+		}
+	}
+	for (int p = 1; p <= kPadding; ++p)
+	{
+		memcpy(base - kPadding - p * pitch, base - kPadding, (w + 2 * kPadding) * sizeof(ImU32));
+		memcpy(base - kPadding + (h - 1 + p) * pitch, base - kPadding + (h - 1) * pitch, (w + 2 * kPadding) * sizeof(ImU32));
+	}
+}
+
+int AtlasAddImage(const ImU32* rgba, int w, int h)
+{
+	int pw = w + 2 * kPadding, ph = h + 2 * kPadding;
+	// A fresh page has the white block in its corner.
+	if (w <= 0 || h <= 0 || pw > kAtlasPageSize || ph > kAtlasPageSize || std::min(pw, ph) > kAtlasPageSize - 2)
+	{
+		return -1;
+	}
+	// Only the newest page takes new images. Back-filling gaps in older pages
+	// would pack tighter, but images added together (and usually drawn
+	// together) would then alternate pages and split the sprite batches.
+	int x = 0, y = 0;
+	if ((pages.empty() || !Pack(*pages.back(), pw, ph, &x, &y)) && !Pack(*NewPage(), pw, ph, &x, &y))
+	{
+		return -1;
+	}
+	int index = (int)pages.size() - 1;
+	AtlasPage* page = pages[index];
+	Blit(page->tex, x, y, rgba, w, h);
+	QueueUpload(page->tex, x, y, pw, ph);
+	++page->images;
+
+	AtlasImage img;
+	img.page = index;
+	img.uv0 = ImVec2((float)(x + kPadding) / kAtlasPageSize, (float)(y + kPadding) / kAtlasPageSize);
+	img.uv1 = ImVec2((float)(x + kPadding + w) / kAtlasPageSize, (float)(y + kPadding + h) / kAtlasPageSize);
+	img.w = w;
+	img.h = h;
+	images.push_back(img);
+	return (int)images.size() - 1;
+}
+
+int AtlasImageCount()
+{
+	return (int)images.size();
+}
+
+const AtlasImage& AtlasGetImage(int id)
+{
+	IM_ASSERT(id >= 0 && id < (int)images.size());
+	return images[id];
+}
+
+int AtlasPageCount()
+{
+	return (int)pages.size();
+}
+
+ImTextureRef AtlasPageTexture(int page)
+{
+	return pages[page]->tex->GetTexRef();
+}
+
+ImVec2 AtlasWhiteUV(int page)
+{
+	return pages[page]->whiteUV;
+}
+
+void AtlasShutdown()
+{
+	for (AtlasPage* page : pages)
+	{
+		ImGui::UnregisterUserTexture(page->tex);
+		IM_DELETE(page->tex);
+		IM_DELETE(page);
+	}
+	pages.clear();
+	images.clear();
+}
+
+void DrawTextureAtlasUI()
+{
+	if (!ImGui::CollapsingHeader("Texture Atlas"))
+	{
+		return;
+	}
+	ImGui::Text("Images: %d, pages: %d (%d px)", (int)images.size(), (int)pages.size(), kAtlasPageSize);
+	for (int i = 0; i < (int)pages.size(); ++i)
+	{
+		const AtlasPage& page = *pages[i];
+		float fill = 100.0f * page.usedPixels / ((float)kAtlasPageSize * kAtlasPageSize);
+		if (ImGui::TreeNode((void*)(intptr_t)i, "Page %d: %d images, %.1f%% packed", i, page.images, fill))
+		{
+			float size = std::min(ImGui::GetContentRegionAvail().x, 256.0f);
+			ImGui::Image(page.tex->GetTexRef(), ImVec2(size, size));
+			ImGui::TreePop();
+		}
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "imgui.h"
+
+// Sprite images packed into a few large RGBA pages with stb_rectpack. Each
+// page is an ImGui-managed texture: new images are copied into its pixels and
+// queued as sub-rect uploads, so the renderer backend uploads them with the
+// rest of ImGui's textures. Every page also holds a white texel, which lets
+// solid rects share a draw call with the sprites around them.
+
+static const int kAtlasPageSize = 2048;
+
+struct AtlasImage {
+	int page;
+	ImVec2 uv0, uv1;
+	int w, h;
+};
+
+// Copies a w x h RGBA image (rows of packed ImU32) into the newest page,
+// opening a new page when it is full; older pages are not back-filled.
+// Returns the image id, or -1 when the image does not fit a page.
+int AtlasAddImage(const ImU32* rgba, int w, int h);
+int AtlasImageCount();
+const AtlasImage& AtlasGetImage(int id);
+
+int AtlasPageCount();
+ImTextureRef AtlasPageTexture(int page);
+ImVec2 AtlasWhiteUV(int page);
+
+// Before ImGui::DestroyContext; the renderer backend has already released
+// the GPU textures by then.
+void AtlasShutdown();
+
+void DrawTextureAtlasUI();
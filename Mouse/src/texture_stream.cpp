@@ -0,0 +1,458 @@
+#include "texture_stream.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "image_decode.h"
+#include "profiler.h"
+
+static const int kMaxWorkers = 4;
+static const int kStagingBuffers = 3;
+static const int kPlaceholderSize = 8;
+static const int kDefaultUploadBudget = 4 * 1024 * 1024;
+
+static const char* kWorkerNames[kMaxWorkers] = { "Texture Decode 0", "Texture Decode 1", "Texture Decode 2", "Texture Decode 3" };
+
+struct StreamTexture {
+	std::string path;
+	TextureStreamState state;
+	GLuint texture;         // created when its upload starts
+	int width, height;
+	int rowsUploaded;
+	const char* error;
+};
+
+struct DecodeJob {
+	int handle;
+	std::string path;
+};
+
+struct DecodedTexture {
+	int handle;
+	DecodedImage image;
+};
+
+// Textures, both queues and the stats; shared by the main, worker and GL threads.
+static std::mutex streamMutex;
+static std::condition_variable jobCv;
+static std::vector<std::thread> workers;
+static bool stopping = false;
+static std::deque<DecodeJob> jobs;
+static std::deque<DecodedTexture> decoded; // oldest first
+static std::vector<StreamTexture> textures;
+static TextureStreamStats stats;
+static int uploadBudget = kDefaultUploadBudget;
+
+// GL thread only.
+static DecodedTexture uploading;
+static bool haveUpload = false;
+static GLuint uploadTexture = 0;
+static int uploadRow = 0;
+static GLuint placeholder = 0;
+static GLuint staging[kStagingBuffers];
+static int stagingNext = 0;
+static bool usePbo = false;
+
+static bool ReadFile(const std::string& path, std::vector<uint8_t>& out)
+{
+	FILE* f = fopen(path.c_str(), "rb");
+	if (!f)
+	{
+		return false;
+	}
+	bool ok = fseek(f, 0, SEEK_END) == 0;
+	long size = ok ? ftell(f) : -1;
+	ok = size >= 0 && fseek(f, 0, SEEK_SET) == 0;
+	if (ok)
+	{
+		out.resize((size_t)size);
+		ok = fread(out.data(), 1, out.size(), f) == out.size();
+	}
+	fclose(f);
+	return ok;
+}
+
+static void WorkerMain(int index)
+{
+	ProfilerSetThreadName(kWorkerNames[index]);
+	std::unique_lock<std::mutex> lock(streamMutex);
+	for (;;)
+	{
+		jobCv.wait(lock, [] { return stopping || !jobs.empty(); });
+		if (stopping)
+		{
+			break;
+		}
+		DecodeJob job = std::move(jobs.front());
+		jobs.pop_front();
+		textures[job.handle].state = TextureStream_Decoding;
+		lock.unlock();
+
+		DecodedTexture result;
+		result.handle = job.handle;
+		const char* error = nullptr;
+		double start = glfwGetTime();
+		{
+			PROFILE_SCOPE("Decode Texture");
+			std::vector<uint8_t> file;
+			if (!ReadFile(job.path, file))
+			{
+				error = "cannot read the file";
+			}
+			else
+			{
+				DecodeImage(file.data(), file.size(), result.image, &error);
+			}
+		}
+		double ms = (glfwGetTime() - start) * 1000.0;
+
+		lock.lock();
+		StreamTexture& t = textures[job.handle];
+		stats.decodeMs = stats.decodeMs > 0.0 ? stats.decodeMs * 0.8 + ms * 0.2 : ms;
+		if (error)
+		{
+			t.state = TextureStream_Failed;
+			t.error = error;
+			--stats.pending;
+			++stats.failed;
+		}
+		else
+		{
+			t.state = TextureStream_Uploading;
+			t.width = result.image.width;
+			t.height = result.image.height;
+			decoded.push_back(std::move(result));
+		}
+		glfwPostEmptyEvent();
+	}
+}
+
+void TextureStreamInit(int workerCount)
+{
+	// Two-tone checkerboard, sampled nearest so it stays crisp at any size.
+	uint32_t pixels[kPlaceholderSize * kPlaceholderSize];
+	for (int y = 0; y < kPlaceholderSize; ++y)
+	{
+		for (int x = 0; x < kPlaceholderSize; ++x)
+		{
+			pixels[y * kPlaceholderSize + x] = (x + y) & 1 ? IM_COL32(90, 90, 90, 255) : IM_COL32(150, 150, 150, 255);
+		}
+	}
+	GLint lastTexture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &lastTexture);
+	glGenTextures(1, &placeholder);
+	glBindTexture(GL_TEXTURE_2D, placeholder);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, kPlaceholderSize, kPlaceholderSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glBindTexture(GL_TEXTURE_2D, (GLuint)lastTexture);
+
+	// glMapBufferRange is core in 3.0; without it rows go up from client memory.
+	usePbo = GLAD_GL_VERSION_3_0 != 0;
+	if (usePbo)
+	{
+		glGenBuffers(kStagingBuffers, staging);
+	}
+
+	stopping = false;
+	if (workerCount <= 0)
+	{
+		workerCount = (int)std::thread::hardware_concurrency() - 1;
+	}
+	workerCount = std::min(std::max(workerCount, 1), kMaxWorkers);
+	for (int i = 0; i < workerCount; ++i)
+	{
+		workers.emplace_back(WorkerMain, i);
+	}
+}
+
+void TextureStreamShutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(streamMutex);
+		stopping = true;
+	}
+	jobCv.notify_all();
+	for (std::thread& t : workers)
+	{
+		t.join();
+	}
+	workers.clear();
+
+	for (StreamTexture& t : textures)
+	{
+		if (t.texture)
+		{
+			glDeleteTextures(1, &t.texture);
+		}
+	}
+	textures.clear();
+	jobs.clear();
+	decoded.clear();
+	uploading = DecodedTexture();
+	haveUpload = false;
+	if (usePbo)
+	{
+		glDeleteBuffers(kStagingBuffers, staging);
+	}
+	if (placeholder)
+	{
+		glDeleteTextures(1, &placeholder);
+		placeholder = 0;
+	}
+	stats = TextureStreamStats();
+}
+
+int TextureStreamLoad(const char* path)
+{
+	std::lock_guard<std::mutex> lock(streamMutex);
+	StreamTexture t = {};
+	t.path = path;
+	t.state = TextureStream_Queued;
+	textures.push_back(t);
+	int handle = (int)textures.size() - 1;
+	jobs.push_back({ handle, path });
+	++stats.pending;
+	jobCv.notify_one();
+	return handle;
+}
+
+int TextureStreamCount()
+{
+	std::lock_guard<std::mutex> lock(streamMutex);
+	return (int)textures.size();
+}
+
+ImTextureID TextureStreamGetTexture(int handle)
+{
+	std::lock_guard<std::mutex> lock(streamMutex);
+	bool ready = handle >= 0 && handle < (int)textures.size() && textures[handle].state == TextureStream_Ready;
+	return (ImTextureID)(intptr_t)(ready ? textures[handle].texture : placeholder);
+}
+
+TextureStreamState TextureStreamGetState(int handle)
+{
+	std::lock_guard<std::mutex> lock(streamMutex);
+	return textures[handle].state;
+}
+
+ImVec2 TextureStreamGetSize(int handle)
+{
+	std::lock_guard<std::mutex> lock(streamMutex);
+	return ImVec2((float)textures[handle].width, (float)textures[handle].height);
+}
+
+bool TextureStreamBusy()
+{
+	std::lock_guard<std::mutex> lock(streamMutex);
+	return stats.pending > 0;
+}
+
+void TextureStreamSetUploadBudget(int bytesPerFrame)
+{
+	std::lock_guard<std::mutex> lock(streamMutex);
+	uploadBudget = std::max(bytesPerFrame, 64 * 1024);
+}
+
+static GLuint CreateTexture(int w, int h)
+{
+	GLuint tex = 0;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	return tex;
+}
+
+// Copies the rows into the next staging buffer and queues the transfer. The
+// buffer is orphaned first, so the driver hands out fresh storage instead of
+// waiting for the GPU to finish reading the previous band.
+static void UploadRows(GLuint tex, int width, int y, int rows, const uint8_t* src)
+{
+	size_t bytes = (size_t)width * rows * 4;
+	glBindTexture(GL_TEXTURE_2D, tex);
+	if (usePbo)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging[stagingNext]);
+		stagingNext = (stagingNext + 1) % kStagingBuffers;
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)bytes, nullptr, GL_STREAM_DRAW);
+		void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (dst)
+		{
+			memcpy(dst, src, bytes);
+			if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER))
+			{
+				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				return;
+			}
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, src);
+}
+
+void TextureStreamPump()
+{
+	PROFILE_FUNCTION();
+	double start = glfwGetTime();
+	int budget = 0;
+	{
+		std::lock_guard<std::mutex> lock(streamMutex);
+		if (!haveUpload && decoded.empty())
+		{
+			stats.uploadedBytes = 0;
+			stats.pumpMs = 0.0;
+			return;
+		}
+		budget = uploadBudget;
+	}
+
+	GLint lastTexture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &lastTexture);
+	int spent = 0;
+	while (spent < budget)
+	{
+		int w = uploading.image.width, h = uploading.image.height;
+		if (!haveUpload)
+		{
+			{
+				std::lock_guard<std::mutex> lock(streamMutex);
+				if (decoded.empty())
+				{
+					break;
+				}
+				uploading = std::move(decoded.front());
+				decoded.pop_front();
+			}
+			w = uploading.image.width;
+			h = uploading.image.height;
+			uploadTexture = CreateTexture(w, h);
+			uploadRow = 0;
+			haveUpload = true;
+			std::lock_guard<std::mutex> lock(streamMutex);
+			textures[uploading.handle].texture = uploadTexture;
+		}
+
+		// At least one row per pump, however small the budget.
+		int rowBytes = w * 4;
+		int rows = std::min(h - uploadRow, std::max((budget - spent) / rowBytes, spent == 0 ? 1 : 0));
+		if (rows == 0)
+		{
+			break;
+		}
+		UploadRows(uploadTexture, w, uploadRow, rows, uploading.image.rgba.data() + (size_t)uploadRow * rowBytes);
+		uploadRow += rows;
+		spent += rows * rowBytes;
+
+		std::lock_guard<std::mutex> lock(streamMutex);
+		StreamTexture& t = textures[uploading.handle];
+		t.rowsUploaded = uploadRow;
+		if (uploadRow == h)
+		{
+			t.state = TextureStream_Ready;
+			--stats.pending;
+			++stats.ready;
+			uploading = DecodedTexture();
+			haveUpload = false;
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, (GLuint)lastTexture);
+
+	double ms = (glfwGetTime() - start) * 1000.0;
+	std::lock_guard<std::mutex> lock(streamMutex);
+	stats.uploadedBytes = spent;
+	stats.pumpMs = ms;
+	stats.maxPumpMs = std::max(stats.maxPumpMs, ms);
+}
+
+TextureStreamStats TextureStreamGetStats()
+{
+	std::lock_guard<std::mutex> lock(streamMutex);
+	return stats;
+}
+
+static const char* StateName(TextureStreamState state)
+{
+	switch (state)
+	{
+	case TextureStream_Queued: return "Queued";
+	case TextureStream_Decoding: return "Decoding";
+	case TextureStream_Uploading: return "Uploading";
+	case TextureStream_Ready: return "Ready";
+	default: return "Failed";
+	}
+}
+
+void DrawTextureStreamUI()
+{
+	if (!ImGui::CollapsingHeader("Texture Streaming"))
+	{
+		return;
+	}
+	static char path[256] = "";
+	ImGui::InputText("##path", path, sizeof(path));
+	ImGui::SameLine();
+	if (ImGui::Button("Load") && path[0])
+	{
+		TextureStreamLoad(path);
+	}
+	int budgetKb = uploadBudget / 1024;
+	if (ImGui::SliderInt("Upload budget (KB/frame)", &budgetKb, 64, 16384, "%d", ImGuiSliderFlags_Logarithmic))
+	{
+		TextureStreamSetUploadBudget(budgetKb * 1024);
+	}
+	TextureStreamStats s = TextureStreamGetStats();
+	ImGui::Text("Workers: %d, staging: %s", (int)workers.size(), usePbo ? "pixel buffer objects" : "client memory");
+	ImGui::Text("Ready: %d, pending: %d, failed: %d", s.ready, s.pending, s.failed);
+	ImGui::Text("Decode: %.2f ms per texture", s.decodeMs);
+	ImGui::Text("Upload: %d KB in %.3f ms last frame, %.3f ms max", s.uploadedBytes / 1024, s.pumpMs, s.maxPumpMs);
+
+	std::lock_guard<std::mutex> lock(streamMutex);
+	if (textures.empty() || !ImGui::BeginTable("StreamTextures", 3, ImGuiTableFlags_BordersV | ImGuiTableFlags_RowBg))
+	{
+		return;
+	}
+	ImGui::TableSetupColumn("", ImGuiTableColumnFlags_WidthFixed, 24.0f);
+	ImGui::TableSetupColumn("File", ImGuiTableColumnFlags_WidthStretch);
+	ImGui::TableSetupColumn("State", ImGuiTableColumnFlags_WidthFixed, 140.0f);
+	for (const StreamTexture& t : textures)
+	{
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		GLuint shown = t.state == TextureStream_Ready ? t.texture : placeholder;
+		ImGui::Image((ImTextureID)(intptr_t)shown, ImVec2(20.0f, 20.0f));
+		ImGui::TableNextColumn();
+		ImGui::TextUnformatted(t.path.c_str());
+		ImGui::TableNextColumn();
+		if (t.state == TextureStream_Failed)
+		{
+			ImGui::TextDisabled("%s", t.error);
+		}
+		else if (t.state == TextureStream_Uploading && t.height > 0)
+		{
+			ImGui::Text("%s %d%%", StateName(t.state), t.rowsUploaded * 100 / t.height);
+		}
+		else if (t.state == TextureStream_Ready)
+		{
+			ImGui::Text("%d x %d", t.width, t.height);
+		}
+		else
+		{
+			ImGui::TextUnformatted(StateName(t.state));
+		}
+	}
+	ImGui::EndTable();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "imgui.h"
+
+// Background texture loading. A load returns a handle right away; worker
+// threads read and decode the file to RGBA8 (image_decode.h), and the GL
+// thread uploads the result a band of rows at a time through a ring of pixel
+// buffer objects, never more than the per-frame upload budget. Until its
+// last row is in, a handle resolves to a checkerboard placeholder, so a
+// level can be drawn while its textures are still arriving.
+
+enum TextureStreamState {
+	TextureStream_Queued,
+	TextureStream_Decoding,
+	TextureStream_Uploading, // decoded, waiting for or in the middle of its upload
+	TextureStream_Ready,
+	TextureStream_Failed
+};
+
+// Starts the decode workers (0 picks one less than the hardware threads, up
+// to 4) and creates the placeholder and staging buffers. Needs the GL context.
+void TextureStreamInit(int workers);
+// Stops the workers and deletes the textures. On the GL thread, with the
+// render thread stopped.
+void TextureStreamShutdown();
+
+// Queues a file for loading; returns its handle.
+int TextureStreamLoad(const char* path);
+int TextureStreamCount();
+// The texture to draw for a handle: the loaded one once ready, the
+// placeholder before that or when the load failed.
+ImTextureID TextureStreamGetTexture(int handle);
+TextureStreamState TextureStreamGetState(int handle);
+// Pixel size once decoded, 0 x 0 before.
+ImVec2 TextureStreamGetSize(int handle);
+// True while loads are in flight. Workers also post an empty event when a
+// decode finishes, so an idle main loop wakes up to upload it.
+bool TextureStreamBusy();
+
+// Uploads decoded rows up to the budget. Call once per frame on the thread
+// that owns the GL context, before rendering.
+void TextureStreamPump();
+void TextureStreamSetUploadBudget(int bytesPerFrame);
+
+struct TextureStreamStats {
+	int pending;            // queued, decoding or uploading
+	int ready;
+	int failed;
+	int uploadedBytes;      // last pump
+	double pumpMs;          // last pump, CPU side
+	double maxPumpMs;
+	double decodeMs;        // read and decode per texture, smoothed
+};
+
+TextureStreamStats TextureStreamGetStats();
+void DrawTextureStreamUI();
@@ -0,0 +1,217 @@
+#include "trace.h"
+
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "profiler.h"
+
+static const size_t kTraceBufferSize = 1 << 20;
+static const size_t kMaxLogLength = 256;
+
+static char buffer[kTraceBufferSize];
+static size_t bufferUsed = 0;
+static std::mutex traceMutex;
+
+static FILE* file = nullptr;
+static bool started = false;     // first frame of the capture has begun
+static bool firstEvent = true;
+static int framesLeft = 0;
+static unsigned long long frameNumber = 0;
+static uint64_t baseTicks = 0;
+static std::vector<const char*> threadNames; // last name emitted per profiler slot
+
+static void Flush()
+{
+	if (file && bufferUsed > 0)
+	{
+		fwrite(buffer, 1, bufferUsed, file);
+	}
+	bufferUsed = 0;
+}
+
+static void Append(const char* fmt, ...)
+{
+	for (int attempt = 0; attempt < 2; ++attempt)
+	{
+		va_list args;
+		va_start(args, fmt);
+		int n = vsnprintf(buffer + bufferUsed, kTraceBufferSize - bufferUsed, fmt, args);
+		va_end(args);
+		if (n >= 0 && bufferUsed + n < kTraceBufferSize)
+		{
+			bufferUsed += n;
+			return;
+		}
+		Flush();
+	}
+}
+
+// Starts a new array element; the separator keeps the output valid JSON.
+static void BeginEvent()
+{
+	Append(firstEvent ? "\n" : ",\n");
+	firstEvent = false;
+}
+
+static void AppendEscaped(const char* s)
+{
+	char escaped[kMaxLogLength * 2 + 1];
+	size_t n = 0;
+	for (size_t i = 0; s[i] && i < kMaxLogLength; ++i)
+	{
+		unsigned char c = (unsigned char)s[i];
+		if (c == '"' || c == '\\')
+		{
+			escaped[n++] = '\\';
+			escaped[n++] = (char)c;
+		}
+		else if (c < 0x20)
+		{
+			escaped[n++] = ' ';
+		}
+		else
+		{
+			escaped[n++] = (char)c;
+		}
+	}
+	escaped[n] = '\0';
+	Append("%s", escaped);
+}
+
+static double ToMicros(uint64_t ticks)
+{
+	return ticks >= baseTicks ? ProfilerTicksToMs(ticks - baseTicks) * 1000.0 : 0.0;
+}
+
+// New slots, and slots taken over by a thread with another name (the render
+// thread restarting, decode workers), get a thread_name event.
+static void EmitThreadNames()
+{
+	uint32_t count = ProfilerGetThreadCount();
+	threadNames.resize(count, nullptr);
+	for (uint32_t t = 0; t < count; ++t)
+	{
+		const char* name = ProfilerGetThreadName(t);
+		if (threadNames[t] && strcmp(threadNames[t], name) == 0)
+		{
+			continue;
+		}
+		threadNames[t] = name;
+		BeginEvent();
+		Append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", t);
+		AppendEscaped(name);
+		Append("\"}}");
+	}
+}
+
+bool TraceStartCapture(const char* path, int frames)
+{
+	TraceStopCapture();
+	std::lock_guard<std::mutex> lock(traceMutex);
+	file = fopen(path, "wb");
+	if (!file)
+	{
+		return false;
+	}
+	bufferUsed = 0;
+	firstEvent = true;
+	started = false;
+	framesLeft = frames;
+	threadNames.clear();
+	Append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	BeginEvent();
+	Append("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Mouse Engine\"}}");
+	return true;
+}
+
+void TraceStopCapture()
+{
+	std::lock_guard<std::mutex> lock(traceMutex);
+	if (!file)
+	{
+		return;
+	}
+	Append("\n]}\n");
+	Flush();
+	fclose(file);
+	file = nullptr;
+	started = false;
+}
+
+bool TraceIsCapturing()
+{
+	return file != nullptr;
+}
+
+void TraceBeginFrame()
+{
+	std::lock_guard<std::mutex> lock(traceMutex);
+	if (file && !started)
+	{
+		started = true;
+		baseTicks = ProfilerNow();
+	}
+}
+
+void TraceEndFrame()
+{
+	{
+		std::lock_guard<std::mutex> lock(traceMutex);
+		if (!file || !started)
+		{
+			return;
+		}
+		EmitThreadNames();
+
+		int count = 0;
+		uint64_t frameStart = 0, frameEnd = 0;
+		const ProfileZone* zones = ProfilerGetLastFrame(&count, &frameStart, &frameEnd);
+		BeginEvent();
+		Append("{\"name\":\"Frame %llu\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+			frameNumber, ToMicros(frameStart), ProfilerTicksToMs(frameEnd - frameStart) * 1000.0);
+		for (int i = 0; i < count; ++i)
+		{
+			const ProfileZone& z = zones[i];
+			BeginEvent();
+			Append("{\"name\":\"");
+			AppendEscaped(z.name);
+			Append("\",\"cat\":\"zone\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				z.thread, ToMicros(z.start), ProfilerTicksToMs(z.end - z.start) * 1000.0);
+		}
+		++frameNumber;
+	}
+
+	if (--framesLeft <= 0)
+	{
+		TraceStopCapture();
+	}
+}
+
+void TraceLog(const char* message)
+{
+	std::lock_guard<std::mutex> lock(traceMutex);
+	if (!file || !started)
+	{
+		return;
+	}
+	BeginEvent();
+	Append("{\"name\":\"log\",\"cat\":\"log\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"args\":{\"msg\":\"", ToMicros(ProfilerNow()));
+	AppendEscaped(message);
+	Append("\"}}");
+}
+
+void TraceCounter(const char* name, double value)
+{
+	std::lock_guard<std::mutex> lock(traceMutex);
+	if (!file || !started)
+	{
+		return;
+	}
+	BeginEvent();
+	Append("{\"name\":\"");
+	AppendEscaped(name);
+	Append("\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%.3f}}", ToMicros(ProfilerNow()), value);
+}
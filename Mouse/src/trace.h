@@ -0,0 +1,15 @@
+#pragma once
+
+// Chrome Trace Event JSON capture (opens in chrome://tracing and ui.perfetto.dev).
+// Events are formatted into a fixed buffer that is flushed to the file as it
+// fills, so memory stays bounded however many frames are captured.
+
+bool TraceStartCapture(const char* path, int frames);
+void TraceStopCapture();
+bool TraceIsCapturing();
+
+void TraceBeginFrame();
+void TraceEndFrame(); // call after ProfilerEndFrame; emits the frame's zones
+
+void TraceLog(const char* message);
+void TraceCounter(const char* name, double value);
@@ -0,0 +1,640 @@
+#include "undo_history.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "profiler.h"
+#include "frame_arena.h"
+#include "scene_journal.h"
+
+static const size_t kDefaultBudget = 16u << 20;
+static const size_t kMinBudget = 64u << 10;
+static const size_t kMaxBudget = 1u << 30; // offsets are 32-bit
+
+enum UndoKind {
+	UndoKind_Edit,   // per object: index delta, field bits, each field before and after
+	UndoKind_Insert, // per object: index delta, every field
+	UndoKind_Remove  // same layout as Insert
+};
+
+// Finer than SceneChange, so a drag along one axis stores one float.
+enum UndoField {
+	UndoField_X = 1 << 0,
+	UndoField_Y = 1 << 1,
+	UndoField_W = 1 << 2,
+	UndoField_H = 1 << 3,
+	UndoField_Color = 1 << 4,
+	UndoField_Sprite = 1 << 5
+};
+
+struct UndoEntry {
+	uint32_t offset; // in arena
+	uint32_t bytes;
+	int count;       // objects
+	UndoKind kind;
+	const char* label;
+};
+
+struct Captured {
+	int index;
+	Rect before;
+};
+
+// entries[0, applied) can be undone, the rest redone. Their payloads sit in
+// arena in the same order, wrapping once at the end.
+static std::vector<uint8_t> arena;
+static size_t budget = kDefaultBudget;
+static std::deque<UndoEntry> entries;
+static int applied = 0;
+static size_t usedBytes = 0;
+static int expectedCount = -1;  // objects.size() as the newest command left it
+static int evicted = 0;
+static int oversized = 0;
+static int lastApplyObjects = 0;
+static double lastApplyMs = 0.0;
+
+// Open edit.
+static const char* editLabel = nullptr;
+static std::vector<Captured> captured;
+static SelectionSet capturedSet;
+
+// Scratch, capacity kept.
+static std::vector<uint8_t> encoded;
+static std::vector<int> scratchIndices;
+static std::vector<Rect> scratchRects;
+
+static double Now()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Encoding -------------------------------------------------------------------
+
+static void Put(const void* data, size_t bytes)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	encoded.insert(encoded.end(), p, p + bytes);
+}
+
+static void PutVarint(uint32_t v)
+{
+	while (v >= 0x80)
+	{
+		encoded.push_back((uint8_t)(v | 0x80));
+		v >>= 7;
+	}
+	encoded.push_back((uint8_t)v);
+}
+
+// Index deltas are small in both directions for typical selections.
+static void PutIndexDelta(int index, int& prev)
+{
+	int32_t d = index - prev;
+	PutVarint(((uint32_t)d << 1) ^ (uint32_t)(d >> 31));
+	prev = index;
+}
+
+static void PutRect(const Rect& R)
+{
+	Put(&R.x, 4);
+	Put(&R.y, 4);
+	Put(&R.w, 4);
+	Put(&R.h, 4);
+	Put(&R.color, 16);
+	Put(&R.sprite, 4);
+}
+
+static uint32_t DiffFields(const Rect& a, const Rect& b)
+{
+	// Bitwise, so -0/+0 and NaN payload changes still round-trip.
+	uint32_t fields = 0;
+	fields |= memcmp(&a.x, &b.x, 4) ? UndoField_X : 0;
+	fields |= memcmp(&a.y, &b.y, 4) ? UndoField_Y : 0;
+	fields |= memcmp(&a.w, &b.w, 4) ? UndoField_W : 0;
+	fields |= memcmp(&a.h, &b.h, 4) ? UndoField_H : 0;
+	fields |= memcmp(&a.color, &b.color, 16) ? UndoField_Color : 0;
+	fields |= a.sprite != b.sprite ? UndoField_Sprite : 0;
+	return fields;
+}
+
+static uint32_t ChangeBits(uint32_t fields)
+{
+	uint32_t what = 0;
+	what |= fields & (UndoField_X | UndoField_Y) ? SceneChange_Position : 0;
+	what |= fields & (UndoField_W | UndoField_H) ? SceneChange_Size : 0;
+	what |= fields & UndoField_Color ? SceneChange_Color : 0;
+	what |= fields & UndoField_Sprite ? SceneChange_Sprite : 0;
+	return what;
+}
+
+struct UndoReader {
+	const uint8_t* p;
+
+	void Get(void* data, size_t bytes)
+	{
+		memcpy(data, p, bytes);
+		p += bytes;
+	}
+
+	uint32_t Varint()
+	{
+		uint32_t v = 0;
+		for (int shift = 0; ; shift += 7)
+		{
+			uint8_t b = *p++;
+			v |= (uint32_t)(b & 0x7F) << shift;
+			if (!(b & 0x80))
+			{
+				return v;
+			}
+		}
+	}
+
+	int Index(int& prev)
+	{
+		uint32_t z = Varint();
+		prev += (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+		return prev;
+	}
+
+	// Reads one side of each field into R, skipping the other.
+	void Fields(Rect& R, uint32_t fields, bool after)
+	{
+		float* floats[4] = { &R.x, &R.y, &R.w, &R.h };
+		for (int f = 0; f < 4; ++f)
+		{
+			if (fields & (1u << f))
+			{
+				memcpy(floats[f], p + (after ? 4 : 0), 4);
+				p += 8;
+			}
+		}
+		if (fields & UndoField_Color)
+		{
+			memcpy(&R.color, p + (after ? 16 : 0), 16);
+			p += 32;
+		}
+		if (fields & UndoField_Sprite)
+		{
+			memcpy(&R.sprite, p + (after ? 4 : 0), 4);
+			p += 8;
+		}
+	}
+
+	void ReadRect(Rect& R)
+	{
+		Get(&R.x, 4);
+		Get(&R.y, 4);
+		Get(&R.w, 4);
+		Get(&R.h, 4);
+		Get(&R.color, 16);
+		Get(&R.sprite, 4);
+	}
+};
+
+// Ring -----------------------------------------------------------------------
+
+static size_t EntryEnd(const UndoEntry& e)
+{
+	return (size_t)e.offset + e.bytes;
+}
+
+// Where bytes fit behind the newest entry without overwriting the oldest.
+static bool FindSpace(size_t bytes, size_t& at)
+{
+	if (entries.empty())
+	{
+		at = 0;
+		return bytes <= arena.size();
+	}
+	size_t head = entries.front().offset, tail = EntryEnd(entries.back());
+	if (tail > head)
+	{
+		if (arena.size() - tail >= bytes)
+		{
+			at = tail;
+			return true;
+		}
+		at = 0;
+		return head >= bytes;
+	}
+	at = tail;
+	return head - tail >= bytes;
+}
+
+static void DropOldest()
+{
+	usedBytes -= entries.front().bytes;
+	entries.pop_front();
+	applied = std::max(applied - 1, 0);
+	++evicted;
+}
+
+static void DropRedo()
+{
+	while ((int)entries.size() > applied)
+	{
+		usedBytes -= entries.back().bytes;
+		entries.pop_back();
+	}
+}
+
+// Moves encoded into the ring as the newest command, evicting as needed.
+static void Push(UndoKind kind, const char* label, int count)
+{
+	DropRedo();
+	if (arena.size() != budget)
+	{
+		arena.assign(budget, 0);
+		entries.clear();
+		applied = 0;
+		usedBytes = 0;
+	}
+	size_t at = 0;
+	while (!FindSpace(encoded.size(), at) && !entries.empty())
+	{
+		DropOldest();
+	}
+	if (encoded.size() > arena.size())
+	{
+		// Older commands are gone and this one cannot be kept, so nothing
+		// before it can be undone either.
+		++oversized;
+		return;
+	}
+	memcpy(arena.data() + at, encoded.data(), encoded.size());
+	entries.push_back({ (uint32_t)at, (uint32_t)encoded.size(), count, kind, label });
+	usedBytes += encoded.size();
+	applied = (int)entries.size();
+}
+
+// A scene replaced behind our back (a load, a recovered journal) leaves the
+// recorded indices meaningless.
+static void DropIfStale()
+{
+	if (!entries.empty() && (int)objects.size() != expectedCount)
+	{
+		UndoClear();
+	}
+	expectedCount = (int)objects.size();
+}
+
+// Edits ----------------------------------------------------------------------
+
+static void CloseEdit()
+{
+	if (!editLabel)
+	{
+		return;
+	}
+	PROFILE_SCOPE("UndoCloseEdit");
+	encoded.clear();
+	int prev = 0, count = 0;
+	for (const Captured& c : captured)
+	{
+		SelectionRemove(capturedSet, c.index);
+		if (c.index >= (int)objects.size())
+		{
+			continue;
+		}
+		const Rect& now = objects[c.index];
+		uint32_t fields = DiffFields(c.before, now);
+		if (!fields)
+		{
+			continue;
+		}
+		PutIndexDelta(c.index, prev);
+		encoded.push_back((uint8_t)fields);
+		// Interleaved per field so UndoReader::Fields can pick a side with one offset.
+		Rect sides[2] = { c.before, now };
+		if (fields & UndoField_X) { Put(&sides[0].x, 4); Put(&sides[1].x, 4); }
+		if (fields & UndoField_Y) { Put(&sides[0].y, 4); Put(&sides[1].y, 4); }
+		if (fields & UndoField_W) { Put(&sides[0].w, 4); Put(&sides[1].w, 4); }
+		if (fields & UndoField_H) { Put(&sides[0].h, 4); Put(&sides[1].h, 4); }
+		if (fields & UndoField_Color) { Put(&sides[0].color, 16); Put(&sides[1].color, 16); }
+		if (fields & UndoField_Sprite) { Put(&sides[0].sprite, 4); Put(&sides[1].sprite, 4); }
+		++count;
+	}
+	captured.clear();
+	const char* label = editLabel;
+	editLabel = nullptr;
+	if (count > 0)
+	{
+		Push(UndoKind_Edit, label, count);
+	}
+}
+
+void UndoBeginEdit(const char* label)
+{
+	if (editLabel && strcmp(editLabel, label) == 0)
+	{
+		return;
+	}
+	CloseEdit();
+	DropIfStale();
+	editLabel = label;
+	SelectionResize(capturedSet, (int)objects.size());
+}
+
+void UndoCapture(int index, const Rect& before)
+{
+	if (!editLabel || index < 0 || index >= capturedSet.objectCount || SelectionContains(capturedSet, index))
+	{
+		return;
+	}
+	SelectionAdd(capturedSet, index);
+	captured.push_back({ index, before });
+}
+
+void UndoCapture(int index)
+{
+	if (index >= 0 && index < (int)objects.size())
+	{
+		UndoCapture(index, objects[index]);
+	}
+}
+
+void UndoEndEdit(const char* label)
+{
+	if (editLabel && strcmp(editLabel, label) == 0)
+	{
+		CloseEdit();
+	}
+}
+
+// Inserts and removes --------------------------------------------------------
+
+static void EncodeObjects(const int* indices, const Rect* values, int count)
+{
+	encoded.clear();
+	int prev = 0;
+	for (int k = 0; k < count; ++k)
+	{
+		PutIndexDelta(indices[k], prev);
+		PutRect(values ? values[k] : objects[indices[k]]);
+	}
+}
+
+void UndoRecordInsert(const char* label, const int* indices, const Rect* values, int count)
+{
+	CloseEdit();
+	DropIfStale();
+	if (count <= 0)
+	{
+		return;
+	}
+	EncodeObjects(indices, values, count);
+	Push(UndoKind_Insert, label, count);
+	expectedCount += count;
+}
+
+void UndoRecordRemove(const char* label, const int* indices, int count)
+{
+	CloseEdit();
+	DropIfStale();
+	if (count <= 0)
+	{
+		return;
+	}
+	EncodeObjects(indices, nullptr, count);
+	Push(UndoKind_Remove, label, count);
+	expectedCount -= count;
+}
+
+// Applying -------------------------------------------------------------------
+
+static void DecodeObjects(const UndoEntry& e)
+{
+	scratchIndices.resize(e.count);
+	scratchRects.resize(e.count);
+	UndoReader r = { arena.data() + e.offset };
+	int prev = 0;
+	for (int k = 0; k < e.count; ++k)
+	{
+		scratchIndices[k] = r.Index(prev);
+		r.ReadRect(scratchRects[k]);
+	}
+}
+
+// Puts the entry's objects back and selects them.
+static void ApplyInsert(const UndoEntry& e)
+{
+	DecodeObjects(e);
+	SceneJournalRecordInsert(scratchIndices.data(), scratchRects.data(), e.count);
+	InsertRects(objects, scratchIndices.data(), scratchRects.data(), e.count);
+	MarkAllObjectsChanged(SceneChange_Structure);
+	SelectionResize(selection, (int)objects.size());
+	SelectionClear(selection);
+	for (int i : scratchIndices)
+	{
+		SelectionAdd(selection, i);
+	}
+	selectedIndex = scratchIndices[0];
+}
+
+static void ApplyRemove(const UndoEntry& e)
+{
+	DecodeObjects(e);
+	SceneJournalRecordRemove(scratchIndices.data(), e.count);
+	EraseRects(objects, scratchIndices.data(), e.count);
+	MarkAllObjectsChanged(SceneChange_Structure);
+	SelectionResize(selection, (int)objects.size());
+	SelectionClear(selection);
+	selectedIndex = -1;
+}
+
+static void ApplyEdit(const UndoEntry& e, bool after)
+{
+	UndoReader r = { arena.data() + e.offset };
+	int prev = 0;
+	for (int k = 0; k < e.count; ++k)
+	{
+		int i = r.Index(prev);
+		uint32_t fields = *r.p++;
+		r.Fields(objects[i], fields, after);
+		MarkObjectChanged(i, ChangeBits(fields));
+	}
+}
+
+static void Apply(const UndoEntry& e, bool redo)
+{
+	double t0 = Now();
+	if (e.kind == UndoKind_Edit)
+	{
+		ApplyEdit(e, redo);
+	}
+	else if ((e.kind == UndoKind_Insert) == redo)
+	{
+		ApplyInsert(e);
+	}
+	else
+	{
+		ApplyRemove(e);
+	}
+	expectedCount = (int)objects.size();
+	lastApplyObjects = e.count;
+	lastApplyMs = Now() - t0;
+}
+
+bool UndoCanUndo()
+{
+	return applied > 0;
+}
+
+bool UndoCanRedo()
+{
+	return applied < (int)entries.size();
+}
+
+const char* UndoNextUndoLabel()
+{
+	return applied > 0 ? entries[applied - 1].label : nullptr;
+}
+
+const char* UndoNextRedoLabel()
+{
+	return UndoCanRedo() ? entries[applied].label : nullptr;
+}
+
+bool UndoLast()
+{
+	PROFILE_FUNCTION();
+	CloseEdit();
+	DropIfStale();
+	if (applied == 0)
+	{
+		return false;
+	}
+	Apply(entries[--applied], false);
+	return true;
+}
+
+bool RedoNext()
+{
+	PROFILE_FUNCTION();
+	CloseEdit();
+	DropIfStale();
+	if (!UndoCanRedo())
+	{
+		return false;
+	}
+	Apply(entries[applied++], true);
+	return true;
+}
+
+void UndoClear()
+{
+	for (const Captured& c : captured)
+	{
+		SelectionRemove(capturedSet, c.index);
+	}
+	captured.clear();
+	editLabel = nullptr;
+	entries.clear();
+	applied = 0;
+	usedBytes = 0;
+	expectedCount = (int)objects.size();
+}
+
+void UndoSetMemoryBudget(size_t bytes)
+{
+	bytes = std::min(std::max(bytes, kMinBudget), kMaxBudget);
+	if (bytes == budget)
+	{
+		return;
+	}
+	budget = bytes;
+	if (arena.empty())
+	{
+		return;
+	}
+	// Keep the newest commands that fit, packed from the start. Dropping an
+	// entry that can still be redone would leave later redos on a missing
+	// step, so in that case everything goes.
+	size_t keep = 0;
+	int first = (int)entries.size();
+	while (first > 0 && keep + entries[first - 1].bytes <= bytes)
+	{
+		keep += entries[--first].bytes;
+	}
+	if (first > applied)
+	{
+		UndoClear();
+		first = 0;
+	}
+	std::vector<uint8_t> packed(bytes, 0);
+	size_t at = 0;
+	for (int k = first; k < (int)entries.size(); ++k)
+	{
+		UndoEntry& e = entries[k];
+		memcpy(packed.data() + at, arena.data() + e.offset, e.bytes);
+		e.offset = (uint32_t)at;
+		at += e.bytes;
+	}
+	while (first-- > 0)
+	{
+		DropOldest();
+	}
+	arena.swap(packed);
+}
+
+UndoStats UndoGetStats()
+{
+	UndoStats s;
+	s.commands = (int)entries.size();
+	s.undoable = applied;
+	s.usedBytes = usedBytes;
+	s.budgetBytes = budget;
+	s.evicted = evicted;
+	s.oversized = oversized;
+	s.lastApplyObjects = lastApplyObjects;
+	s.lastApplyMs = lastApplyMs;
+	return s;
+}
+
+void DrawUndoUI()
+{
+	if (!ImGui::CollapsingHeader("Undo History"))
+	{
+		return;
+	}
+	UndoStats s = UndoGetStats();
+	ImGui::BeginDisabled(playMode || !UndoCanUndo());
+	if (ImGui::Button("Undo"))
+	{
+		UndoLast();
+	}
+	ImGui::EndDisabled();
+	ImGui::SameLine();
+	ImGui::BeginDisabled(playMode || !UndoCanRedo());
+	if (ImGui::Button("Redo"))
+	{
+		RedoNext();
+	}
+	ImGui::EndDisabled();
+	const char* undoLabel = UndoNextUndoLabel();
+	const char* redoLabel = UndoNextRedoLabel();
+	ImGui::SameLine();
+	ImGui::TextDisabled("%s / %s", undoLabel ? undoLabel : "-", redoLabel ? redoLabel : "-");
+
+	ImGui::Text("%d commands, %d undoable", s.commands, s.undoable);
+	ImGui::ProgressBar(s.budgetBytes ? (float)s.usedBytes / (float)s.budgetBytes : 0.0f, ImVec2(-1.0f, 0.0f),
+		FrameFormat("%.1f / %.0f KB", s.usedBytes / 1024.0, s.budgetBytes / 1024.0));
+	if (s.lastApplyObjects > 0)
+	{
+		ImGui::Text("Last: %d objects in %.3f ms", s.lastApplyObjects, s.lastApplyMs);
+	}
+	if (s.evicted > 0 || s.oversized > 0)
+	{
+		ImGui::TextDisabled("%d dropped for space, %d too large to keep", s.evicted, s.oversized);
+	}
+	int mb = (int)(budget >> 20);
+	if (ImGui::SliderInt("Budget", &mb, 1, 256, "%d MB"))
+	{
+		UndoSetMemoryBudget((size_t)mb << 20);
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+
+#include "scene.h"
+
+// Undo and redo for editor operations. A command stores only what it changed:
+// for edits, the fields that differ per touched object (before and after);
+// for inserts and removes, the affected objects. Undoing or redoing a command
+// touches exactly those objects, so a move of 10,000 objects in a 1M-object
+// scene costs 10,000 records either way. Inserts and removes also shift the
+// later objects, once per command.
+//
+// Commands are packed into one byte ring of a fixed budget; when a new
+// command does not fit, the oldest ones are dropped.
+//
+// Labels name the operation in the UI and must be string literals.
+
+// Continuous edits (a drag, a held Inspector field) become one command.
+// UndoBeginEdit opens an edit, or keeps the open one when it has the same
+// label. Capture each object before its first change in the edit; the second
+// form takes the old value for widgets that already wrote in place.
+// UndoEndEdit closes the open edit if it has this label and pushes whatever
+// differs from the captured values.
+void UndoBeginEdit(const char* label);
+void UndoCapture(int index);
+void UndoCapture(int index, const Rect& before);
+void UndoEndEdit(const char* label);
+
+// Inserts and removes. Call before changing objects, with the same arguments
+// as SceneJournalRecordInsert/Remove.
+void UndoRecordInsert(const char* label, const int* indices, const Rect* values, int count);
+void UndoRecordRemove(const char* label, const int* indices, int count);
+
+bool UndoCanUndo();
+bool UndoCanRedo();
+// Label of the command the next undo or redo applies, or nullptr.
+const char* UndoNextUndoLabel();
+const char* UndoNextRedoLabel();
+bool UndoLast();
+bool RedoNext();
+
+// Forgets every command. Called when the scene is replaced.
+void UndoClear();
+// Drops the oldest commands that no longer fit.
+void UndoSetMemoryBudget(size_t bytes);
+
+struct UndoStats {
+	int commands;
+	int undoable;
+	size_t usedBytes;
+	size_t budgetBytes;
+	int evicted;           // dropped to make room
+	int oversized;         // larger than the whole budget, not kept
+	int lastApplyObjects;
+	double lastApplyMs;
+};
+
+UndoStats UndoGetStats();
+void DrawUndoUI();